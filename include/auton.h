@@ -0,0 +1,91 @@
+
+/*
+ * auton.h
+ * autonomous routines, worked out ahead of time and picked on the brain
+ * NOTE: a routine is a short list of steps, prepare() turns it into one
+ * entry per drive tick (forward rpm and heading) while the robot is
+ * disabled, so when auton starts all that is left is playing it back
+*/
+
+#ifndef AUTON_H
+#define AUTON_H
+
+#include <stdint.h>
+
+#include "pose.h"
+
+// longest routine (15 s at the drive rate)
+#define AUTON_MAX_TICKS 1500
+
+
+enum auton_step_type {
+  AUTON_DRIVE = 0,       // value is meters, negative backs up
+  AUTON_DRIVE_TIME = 1,  // value is seconds at full speed, forward only
+  AUTON_TURN = 2,        // value is degrees, clockwise positive
+  AUTON_WAIT = 3         // value is seconds
+};
+
+struct auton_step {
+  auton_step_type type;
+  double value;
+};
+
+struct auton_routine {
+  const char *name;
+  pose start;                // where it starts on the field
+  const auton_step *steps;
+  uint32_t count;
+};
+
+// one drive tick of a prepared routine
+struct auton_tick {
+  float forward;   // rpm
+  float heading;   // degrees from the start heading, clockwise
+};
+
+
+class auton_plan {
+  private:
+    auton_tick _ticks[AUTON_MAX_TICKS];
+    uint32_t _count;
+    const auton_routine *_routine;
+    double _max_rpm;
+    bool _truncated;
+
+    void add(double forward, double heading);
+
+  public:
+    auton_plan(void);
+
+    // work out every tick of a routine, slow (do it while disabled)
+    // runs start to finish without yielding, so no other task ever sees
+    // half a plan. the plan is empty if max_rpm isnt above 0
+    void prepare(const auton_routine *routine, double max_rpm);
+
+    const auton_routine *routine(void) const { return _routine; }
+    double max_rpm(void) const { return _max_rpm; }
+    uint32_t count(void) const { return _count; }
+    const auton_tick &tick(uint32_t i) const { return _ticks[i]; }
+
+    // the routine was longer than AUTON_MAX_TICKS and got cut short
+    bool truncated(void) const { return _truncated; }
+};
+
+
+// touch buttons on the brain screen, one per routine
+class auton_selector {
+  private:
+    const auton_routine *_routines;
+    uint32_t _count;
+    int32_t _presses;
+
+  public:
+    auton_selector(const auton_routine *routines, uint32_t count);
+
+    // check for a new press, returns the routine it landed on or -1
+    int32_t poll(void);
+
+    void draw(int32_t selected, const auton_plan &plan);
+};
+
+#endif // AUTON_H
@@ -0,0 +1,73 @@
+
+/*
+ * competition_manager.h
+ * disabled / auton / driver as explicit states on one control tick
+ * NOTE: every mode gets a prepare hook that runs on every disabled tick
+ * (and once before the first tick), so everything slow happens before the
+ * field enables us. on the tick that sees the enable, the start and tick
+ * hooks run right away, so the first command goes out within one tick of
+ * the status change
+*/
+
+#ifndef COMPETITION_MANAGER_H
+#define COMPETITION_MANAGER_H
+
+#include <stdint.h>
+
+#include "latency.h"
+
+
+enum comp_state {
+  COMP_DISABLED = 0,
+  COMP_AUTON = 1,
+  COMP_DRIVER = 2
+};
+#define COMP_STATES 3
+
+// what a state does, any hook can be NULL
+struct comp_mode {
+  void (*prepare)(void);  // while disabled, every tick (keep it cheap when nothing changed)
+  void (*start)(void);    // on entering, right before the first tick
+  void (*tick)(void);     // every control tick in the state
+  void (*stop)(void);     // on leaving
+};
+
+
+class competition_manager {
+  private:
+    comp_mode _modes[COMP_STATES];
+    comp_state _state;
+    bool _ready;
+    bool _halted;
+    uint32_t _ticks;          // in the current state
+    uint32_t _transitions;
+
+    // how long start plus the first tick took (us)
+    latency_hist _response;
+
+  public:
+    competition_manager(void);
+
+    void on(comp_state state, const comp_mode &mode);
+
+    // one control tick: read the field, change state if it changed, run hooks
+    void step(void);
+
+    // leave the current mode (its stop hook runs) and stay disabled no
+    // matter what the field says, step() does nothing after this
+    void halt(void);
+
+    // state from vexCompetitionStatus bits
+    static comp_state decode(uint32_t status);
+
+    comp_state state(void) const { return _state; }
+    uint32_t ticks(void) const { return _ticks; }
+    uint32_t transitions(void) const { return _transitions; }
+    bool halted(void) const { return _halted; }
+    const latency_hist *response(void) const { return &_response; }
+};
+
+// name of a state, for screens and logs
+const char *comp_state_name(comp_state state);
+
+#endif // COMPETITION_MANAGER_H
@@ -0,0 +1,74 @@
+
+/*
+ * controller_display.h
+ * the controller's 3x19 screen, written from a shadow copy
+ * NOTE: vexControllerTextSet goes over the radio and the controller only
+ * takes one write about every 50 ms, anything sooner is dropped. so
+ * print() only fills in the shadow (cheap, any task), and service() sends
+ * at most one write per period: the changed part of the row that most
+ * needs it. rows that keep losing get bumped so nothing starves. a rumble
+ * is a write too (line 3), so it goes through here and jumps the queue
+*/
+
+#ifndef CONTROLLER_DISPLAY_H
+#define CONTROLLER_DISPLAY_H
+
+#include <stdint.h>
+
+#include "vex.h"
+
+#define CONTROLLER_ROWS 3
+#define CONTROLLER_COLS 19
+
+// shortest gap (ms) the controller takes writes at
+#define CONTROLLER_TEXT_PERIOD 50
+
+// longest rumble pattern the controller plays
+#define CONTROLLER_RUMBLE_MAX 8
+
+
+class controller_display {
+  private:
+    V5_ControllerId _id;
+    char _want[CONTROLLER_ROWS][CONTROLLER_COLS];
+    char _sent[CONTROLLER_ROWS][CONTROLLER_COLS];   // what the screen shows (as far as we know)
+    uint8_t _priority[CONTROLLER_ROWS];
+    uint32_t _waiting[CONTROLLER_ROWS];    // writes a changed row has been passed over for
+    char _rumble[CONTROLLER_RUMBLE_MAX + 1];  // next pattern to send, empty if none
+    bool _connected;
+    bool _written;
+    uint32_t _last_write;
+
+    uint32_t _prints;      // prints that changed something
+    uint32_t _writes;
+    uint32_t _rejected;    // writes the controller didnt take
+
+    // changed columns of a row, false if it matches the screen
+    bool changed(int32_t row, int32_t *first, int32_t *last) const;
+
+  public:
+    controller_display(V5_ControllerId id);
+
+    // higher goes first when more than one row changed
+    void priority(int32_t row, uint8_t priority);
+
+    // replace a row (0 based), cut or padded to the width
+    void print(int32_t row, const char *format, ...);
+
+    // rumble on the next write (dots, dashes and spaces), replaces one
+    // that hasnt gone out yet
+    void rumble(const char *pattern);
+
+    // send one write if the link is free and something changed
+    // now is vexSystemTimeGet ms, returns true if a write went out
+    bool service(uint32_t now);
+
+    // something is waiting to go out
+    bool dirty(void) const;
+
+    uint32_t prints(void) const { return _prints; }
+    uint32_t writes(void) const { return _writes; }
+    uint32_t rejected(void) const { return _rejected; }
+};
+
+#endif // CONTROLLER_DISPLAY_H
@@ -0,0 +1,129 @@
+
+/*
+ * crash_recorder.h
+ * the last few seconds of control state, kept in memory and dumped to the
+ * sd card when something goes wrong
+ * NOTE: the ring is a fixed array filled once a drive tick by the control
+ * task (a copy, no locks, no allocation). a dump writes a header, where
+ * every timed task was, then the ring oldest first, all raw little endian
+ * structs (tools/crash_decode reads them back, so this header is shared
+ * with it, keep it to plain c types). VEXos handles data aborts itself and
+ * never runs user code after one, so a checkpoint of the ring is rewritten
+ * every few seconds as well, that is what is left after one of those
+*/
+
+#ifndef CRASH_RECORDER_H
+#define CRASH_RECORDER_H
+
+#include <stdint.h>
+
+#include "motor_cache.h"
+
+// drive ticks kept (5 s at the drive rate)
+#define CRASH_RING_TICKS 500
+
+// records a checkpoint writes between pauses
+#define CRASH_WRITE_CHUNK 50
+
+// motor ports a record has room for
+#define CRASH_MOTORS 8
+
+// file layout
+#define CRASH_MAGIC 0x48535243 // "CRSH"
+#define CRASH_VERSION 1
+#define CRASH_TASK_NAME 12
+
+
+// why the dump was written
+enum crash_reason {
+  CRASH_ABORT = 1,        // abort() (a failed assert ends up here too)
+  CRASH_TERMINATE = 2,    // an exception nobody caught
+  CRASH_ESTOP = 3,        // the driver hit the kill button
+  CRASH_CHECKPOINT = 4    // nothing wrong, the periodic copy
+};
+
+// flags in a record
+#define CRASH_FLAG_ESTOP 0x01
+#define CRASH_FLAG_FLYWHEEL 0x02  // flywheel switched on
+#define CRASH_FLAG_HEADING 0x04   // heading hold on
+
+// file header
+struct __attribute__((packed)) crash_header {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t reason;         // crash_reason
+  uint8_t motors;         // ports in use below
+  uint8_t tasks;          // crash_task entries after the header
+  uint32_t time;          // ms, when the dump was written
+  uint32_t records;       // crash_record entries after the tasks
+  uint16_t record_size;   // sizeof(crash_record), so a stale decoder can tell
+  uint8_t ports[CRASH_MOTORS];
+};
+
+// where one timed task (latency.h) was when the dump was written
+struct __attribute__((packed)) crash_task {
+  char name[CRASH_TASK_NAME];
+  uint32_t period_us;
+  uint32_t since_us;      // since its last tick started, a stuck task is big here
+  uint32_t run_p99;       // us
+  uint32_t run_max;
+  uint32_t late_max;
+};
+
+// one drive tick
+struct __attribute__((packed)) crash_record {
+  uint32_t time;          // ms
+  uint8_t mode;           // comp_state
+  uint8_t flags;          // CRASH_FLAG_*
+  int16_t left;           // commanded rpm
+  int16_t right;
+  int16_t x;              // pose, mm
+  int16_t y;
+  int16_t theta;          // pose, degrees * 10
+  int16_t flywheel_target; // rpm, 0 when off
+  int16_t flywheel_rpm;   // rpm * 10
+  int16_t flywheel_mv;
+  uint16_t battery;       // mV
+  uint16_t tick_us;       // how long the tick ran
+  int16_t current[CRASH_MOTORS];     // mA, same order as the header's ports
+  uint8_t temperature[CRASH_MOTORS]; // celsius
+};
+
+
+class crash_recorder {
+  private:
+    const motor_cache *_motors;
+    crash_record _ring[CRASH_RING_TICKS];
+    crash_record _copy[CRASH_RING_TICKS];   // what a checkpoint is writing, oldest first
+    uint32_t _next;         // slot the next record goes in
+    uint32_t _count;
+
+  public:
+    // the motor columns come from the cache (its first CRASH_MOTORS ports)
+    crash_recorder(const motor_cache *motors);
+
+    // control task only, fills in the motor columns and copies it in
+    void add(const crash_record &record);
+    uint32_t count(void) const { return _count; }
+
+    // write everything out, returns records written, -1 if the file cant
+    // be opened. safe from any task, it never yields so the control task
+    // cant add to the ring halfway through
+    int32_t dump(const char *filename, crash_reason reason) const;
+
+    // the periodic checkpoint, from the one task that takes them: copies
+    // the ring, then writes the copy CRASH_WRITE_CHUNK records at a time
+    // and calls pause before each piece so the sd card never holds up a
+    // drive tick for the whole file. returns like dump
+    int32_t checkpoint(const char *filename, void (*pause)(void));
+};
+
+// hook abort() and std::terminate so they dump to filename before the
+// program goes down, call once at startup
+void crash_install(const crash_recorder *recorder, const char *filename);
+
+// copy a dump left by the last run somewhere the next checkpoint wont
+// write over, returns bytes copied, -1 if there was nothing to keep
+int32_t crash_keep(const char *from, const char *to);
+
+#endif // CRASH_RECORDER_H
@@ -0,0 +1,73 @@
+
+/*
+ * current_arbiter.h
+ * one current budget spread over every motor's current limit, each tick
+ * NOTE: the motors are in groups that are always commanded together (the
+ * drive, the flywheel) and every motor in a group gets the same limit.
+ * each tick reads what the groups actually drew (from the motor cache).
+ * every motor keeps a floor, then the groups are served in priority order
+ * twice over: a step over what they draw now (more for a group drawing all
+ * its limit lets it, it is being held back), then some room over that, so
+ * current one group only might need never comes out of what another is
+ * using. whatever is left is shared out evenly. the limits only go to the
+ * motors when they change. one task updates, any task can read the results
+ * without waiting on it
+*/
+
+#ifndef CURRENT_ARBITER_H
+#define CURRENT_ARBITER_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "motor_cache.h"
+
+// groups one arbiter spreads over
+#define ARBITER_MAX_GROUPS 4
+
+// levels of demand served one after the other, see update()
+#define ARBITER_TIERS 2
+
+
+struct arbiter_group {
+  const char *name;
+  const int32_t *ports;
+  uint32_t count;
+  uint32_t priority;      // 0 is served first
+};
+
+
+class current_arbiter {
+  private:
+    arbiter_group _groups[ARBITER_MAX_GROUPS];
+    uint32_t _count;
+    int32_t _budget;                          // mA, every motor together
+    uint32_t _order[ARBITER_MAX_GROUPS];      // groups by priority
+    int32_t _sent[ARBITER_MAX_GROUPS];        // limit the motors have now, -1 for none yet
+
+    // what the readers see, per motor in the group (mA)
+    std::atomic<int32_t> _limit[ARBITER_MAX_GROUPS];
+    std::atomic<int32_t> _demand[ARBITER_MAX_GROUPS];
+    std::atomic<int32_t> _drawn[ARBITER_MAX_GROUPS];
+    std::atomic<uint32_t> _sequence;
+
+  public:
+    // budget in mA, the groups are copied (their ports arent)
+    current_arbiter(const arbiter_group *groups, uint32_t count, int32_t budget);
+
+    // read what the groups drew and send new limits, once a tick after the
+    // cache refresh (every port needs MOTOR_CURRENT)
+    void update(const motor_cache &motors);
+
+    // any task, per motor in the group (mA)
+    int32_t limit(uint32_t group) const;
+    int32_t demand(uint32_t group) const;
+    int32_t drawn(uint32_t group) const;
+
+    uint32_t count(void) const { return _count; }
+    const char *name(uint32_t group) const { return group < _count ? _groups[group].name : ""; }
+    int32_t budget(void) const { return _budget; }
+    uint32_t sequence(void) const { return _sequence.load(std::memory_order_acquire); }
+};
+
+#endif // CURRENT_ARBITER_H
@@ -0,0 +1,86 @@
+
+/*
+ * drivetrain.h
+ * both sides of the drive commanded as one unit
+ * NOTE: talks to the motors by port through the c api, the vex::motor
+ * objects in main.cpp still own the gearing and reverse setup
+*/
+
+#ifndef DRIVETRAIN_H
+#define DRIVETRAIN_H
+
+#include <stdint.h>
+
+#include "vex.h"
+#include "latency.h"
+#include "motor_cache.h"
+#include "slew.h"
+
+// motors on each side of the drive
+#define DRIVE_MOTORS_PER_SIDE 2
+
+
+// how the sticks/buttons map to the two sides
+enum drive_mode {
+  DRIVE_TANK = 0,      // left and right given directly
+  DRIVE_ARCADE = 1,    // forward + turn
+  DRIVE_CURVATURE = 2  // forward + curvature, turn rate scales with speed
+};
+
+
+class drivetrain {
+  private:
+    int32_t _left[DRIVE_MOTORS_PER_SIDE];
+    int32_t _right[DRIVE_MOTORS_PER_SIDE];
+    double _max_rpm;
+    int32_t _left_rpm;
+    int32_t _right_rpm;
+
+    // time from the first motor command to the last one (us)
+    latency_hist _skew;
+
+    // output shaping, off until shape() is called
+    slew_group _left_slew;
+    slew_group _right_slew;
+    const motor_cache *_motors;
+
+    double side_rpm(const int32_t *ports, const slew_group &slew) const;
+
+  public:
+    drivetrain(int32_t left_a, int32_t left_b, int32_t right_a, int32_t right_b, double max_rpm);
+
+    // all three modes end up here, velocities in rpm
+    void tank(double left, double right);
+
+    // forward and turn in rpm, scaled down together if a side would saturate
+    void arcade(double forward, double turn);
+
+    // curve is -1..1 and means how hard to turn per unit of forward speed,
+    // quick_turn lets the robot spin in place (curve is used as a turn rate)
+    void curvature(double forward, double curve, bool quick_turn);
+
+    // stop every drive motor with the given brake mode
+    void stop(V5MotorBrakeMode mode);
+
+    void set_max_rpm(double max_rpm);
+
+    // ramp every command through acceleration and jerk limits and a share
+    // of the current budget (which can be NULL). the current estimate uses
+    // the real side speeds if the cache reads MOTOR_VELOCITY on the first
+    // motor of each side, otherwise it takes the last command as the speed.
+    // stop() still stops at once. call once, each call joins the budget
+    void shape(const slew_limits &limits, current_budget *budget, const motor_cache *motors);
+
+    // last commanded rpm on each side (after shaping)
+    int32_t left_rpm(void) const { return _left_rpm; }
+    int32_t right_rpm(void) const { return _right_rpm; }
+
+    // wheel position on each side in degrees, averaged over the side
+    // (from this tick's cache, the drive ports need MOTOR_POSITION)
+    double left_position(const motor_cache &motors) const;
+    double right_position(const motor_cache &motors) const;
+
+    const latency_hist *skew(void) const { return &_skew; }
+};
+
+#endif // DRIVETRAIN_H
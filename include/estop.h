@@ -0,0 +1,68 @@
+
+/*
+ * estop.h
+ * emergency stop that leaves the program running
+ * NOTE: the port list is fixed when the robot is set up, so a trigger is
+ * nothing but a brake mode and a zero velocity per port, done in whatever
+ * task saw the button. it latches until the program restarts, the
+ * control task keeps the motors stopped and the rest (telemetry, logs,
+ * the screen) carries on
+*/
+
+#ifndef ESTOP_H
+#define ESTOP_H
+
+#include <stdint.h>
+
+#include "vex.h"
+#include "latency.h"
+
+// most motors one e-stop will stop (one per smart port)
+#define ESTOP_MAX_MOTORS 21
+
+
+// a motor and how it should stop
+struct estop_motor {
+  int32_t port;
+  V5MotorBrakeMode mode;
+};
+
+
+class estop {
+  private:
+    estop_motor _motors[ESTOP_MAX_MOTORS];
+    uint32_t _count;
+    bool _active;
+    bool _reported;
+    uint32_t _triggers;
+
+    // button edge to the last stop command (us), first trigger only
+    uint32_t _stop_us;
+    uint64_t _edge;
+
+    void stop_all(void);
+
+  public:
+    estop(const estop_motor *motors, uint32_t count);
+
+    // stop everything now, safe to call from any task and more than once.
+    // edge is when the press was seen (us, vexSystemHighResTimeGet), the
+    // caller takes it first thing in the button event so the stop time
+    // covers everything between the press and the motors
+    void trigger(uint64_t edge);
+
+    // every control tick while active, puts the stop back in case
+    // anything else commanded a motor since
+    void hold(void);
+
+    // once after a trigger: e-stop record and stats out over telemetry,
+    // and a line on the console and the screen. returns false if there
+    // was nothing new to report
+    bool report(void);
+
+    bool active(void) const { return _active; }
+    uint32_t triggers(void) const { return _triggers; }
+    uint32_t stop_us(void) const { return _stop_us; }
+};
+
+#endif // ESTOP_H
@@ -0,0 +1,58 @@
+
+/*
+ * flywheel.h
+ * flywheel speed control on motor voltage
+ * NOTE: the motor's own velocity loop is tuned for a drive, not for
+ * something with this much inertia that loses speed every shot. this
+ * runs on our velocity estimate instead: feedforward on the target plus
+ * pi on the error, sent as a voltage once per drive tick
+*/
+
+#ifndef FLYWHEEL_H
+#define FLYWHEEL_H
+
+#include <stdint.h>
+
+#include "slew.h"
+
+
+// mV per rpm of target, per rpm of error, per rpm s of error
+struct flywheel_gains {
+  double kf;
+  double kp;
+  double ki;
+};
+
+
+class flywheel_control {
+  private:
+    const flywheel_gains *_gains;
+    double _integral;
+    uint64_t _last_us;
+    double _error;
+    int32_t _output;
+    slew_group _slew;
+
+  public:
+    flywheel_control(void);
+
+    // fixed gains instead of the flywheel_k* parameters (for the
+    // autotuner), NULL to go back
+    void set_gains(const flywheel_gains *gains);
+
+    // ramp the voltage through acceleration and jerk limits (mV/s, mV/s/s)
+    // and a share of the current budget (which can be NULL), call once
+    void shape(const slew_limits &limits, current_budget *budget);
+
+    // forget the integral, call when the flywheel is switched on
+    void reset(void);
+
+    // voltage (mV) to hold target rpm given what it is doing now, one
+    // call per tick
+    int32_t update(double target, double rpm);
+
+    double error(void) const { return _error; }     // rpm, target - actual
+    int32_t output(void) const { return _output; }  // mV, last update
+};
+
+#endif // FLYWHEEL_H
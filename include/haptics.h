@@ -0,0 +1,66 @@
+
+/*
+ * haptics.h
+ * robot events as controller rumbles
+ * NOTE: post() is cheap and can be called every tick while something is
+ * true, an event already waiting or still cooling down from its last
+ * rumble is dropped. service() hands out one pattern at a time, the most
+ * important one waiting, and nothing new until the last one has played,
+ * so the radio sees at most one rumble write per pattern
+*/
+
+#ifndef HAPTICS_H
+#define HAPTICS_H
+
+#include <stdint.h>
+
+// how long the controller takes to play each symbol (ms, roughly)
+#define HAPTIC_DOT_MS 150
+#define HAPTIC_DASH_MS 400
+#define HAPTIC_SPACE_MS 150
+#define HAPTIC_GAP_MS 50     // after every symbol
+
+// most event types a table can have
+#define HAPTIC_MAX_EVENTS 16
+
+
+struct haptic_pattern {
+  const char *pattern;   // controller::rumble style, at most 8 symbols
+  uint8_t priority;      // higher plays first
+  uint32_t cooldown;     // ms after it plays before it can be posted again
+};
+
+
+class haptics {
+  private:
+    const haptic_pattern *_table;
+    uint32_t _count;
+    uint32_t _waiting;                     // bit per event
+    uint32_t _played_at[HAPTIC_MAX_EVENTS];
+    bool _played[HAPTIC_MAX_EVENTS];
+    uint32_t _busy_until;
+
+    uint32_t _posts;
+    uint32_t _dropped;
+    uint32_t _plays;
+
+  public:
+    // table is indexed by event number
+    haptics(const haptic_pattern *table, uint32_t count);
+
+    // something happened (now is ms), returns false if it was dropped
+    bool post(uint32_t event, uint32_t now);
+
+    // next pattern to rumble, NULL if nothing is waiting or the last one
+    // is still playing
+    const char *service(uint32_t now);
+
+    // how long a pattern takes to play (ms)
+    static uint32_t duration(const char *pattern);
+
+    uint32_t posts(void) const { return _posts; }
+    uint32_t dropped(void) const { return _dropped; }
+    uint32_t plays(void) const { return _plays; }
+};
+
+#endif // HAPTICS_H
@@ -0,0 +1,72 @@
+
+/*
+ * heading.h
+ * heading hold for straight drives
+ * NOTE: runs inside the drive tick, it does not have its own task
+*/
+
+#ifndef HEADING_H
+#define HEADING_H
+
+#include <stdint.h>
+
+#include "drivetrain.h"
+
+
+// rpm of turn per degree of error, per degree s, per degree/s
+struct heading_gains {
+  double kp;
+  double ki;
+  double kd;
+};
+
+
+class heading_hold {
+  private:
+    int32_t _imu_port;
+    double (*_source)(void);
+    const heading_gains *_gains;
+
+    bool _active;
+    double _target;
+    double _integral;
+    double _last_heading;
+    uint64_t _last_us;
+    double _error;
+
+    double read(void);
+
+  public:
+    // imu on a smart port (vexImuHeadingGet)
+    heading_hold(int32_t imu_port);
+
+    // any other heading source in degrees, clockwise positive
+    // (e.g. a triport gyro wrapped in a function)
+    void set_source(double (*source)(void));
+
+    // fixed gains instead of the heading_k* parameters (the autotuner runs
+    // many of these at once with different gains), NULL to go back
+    void set_gains(const heading_gains *gains);
+
+    // lock onto a heading, or onto wherever we are pointing now
+    void hold(double heading);
+    void hold_current(void);
+
+    // move the target without starting over (for profiled turns), starts
+    // holding if we werent
+    void retarget(double heading);
+    void release(void);
+    bool active(void) const { return _active; }
+
+    // drive forward (rpm) while holding the heading, one call per drive tick
+    // when not holding this is just a straight tank command
+    void drive(drivetrain &dt, double forward);
+
+    // last heading error in degrees (target - heading, wrapped)
+    double error(void) const { return _error; }
+};
+
+// wrap an angle into -180..180
+double heading_wrap(double degrees);
+
+#endif // HEADING_H
@@ -0,0 +1,89 @@
+
+/*
+ * latency.h
+ * control loop timing probes
+ * NOTE: each histogram has exactly one writer (the task that owns it)
+ * so the hot path never takes a lock or allocates
+*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <atomic>
+
+// histogram layout (HDR style log buckets)
+// values below 8us get their own bucket, after that every power of
+// two is split into 8 sub buckets so the error is at most 12.5%
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB_COUNT (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_EXP 24 // anything over ~16 seconds gets clamped
+#define LATENCY_BUCKETS ((LATENCY_MAX_EXP - LATENCY_SUB_BITS + 2) * LATENCY_SUB_COUNT)
+
+// how many tasks can register for timing
+#define LATENCY_MAX_TASKS 8
+
+
+// one histogram of microsecond samples
+struct latency_hist {
+  std::atomic<uint32_t> counts[LATENCY_BUCKETS];
+  std::atomic<uint32_t> total;
+  std::atomic<uint32_t> max;
+};
+
+// per task timing (how long a tick runs and how late it starts)
+struct latency_task {
+  const char *name;
+  uint32_t period_us;
+  uint64_t next_us;
+  latency_hist run;
+  latency_hist late;
+};
+
+
+// register a periodic task, call once at startup (not on the hot path)
+// returns NULL when the table is full
+latency_task *latency_register(const char *name, uint32_t period_ms);
+
+// mark the start of a tick, records how late it started
+// returns the start timestamp to hand to latency_tick_end
+uint64_t latency_tick_begin(latency_task *task);
+
+// mark the end of a tick, records how long it ran
+void latency_tick_end(latency_task *task, uint64_t start);
+
+// add one sample to a histogram
+void latency_record(latency_hist *hist, uint32_t us);
+
+// clear a histogram (only safe from the owning task)
+void latency_reset(latency_hist *hist);
+
+// value (in us) that p percent of the samples are at or under
+uint32_t latency_percentile(const latency_hist *hist, double p);
+
+// the registered tasks, for anything that reports on them
+int32_t latency_task_count(void);
+const latency_task *latency_task_at(int32_t index);
+
+
+// scoped probe, times whatever block it lives in
+// latency_probe probe(&task->run);
+class latency_probe {
+  private:
+    latency_hist *_hist;
+    uint64_t _start;
+
+  public:
+    latency_probe(latency_hist *hist);
+    ~latency_probe();
+};
+
+
+// reporting
+// these format from whatever the counters hold right now, the numbers
+// can be a sample or two behind the writer but never torn
+void latency_print(void);                 // serial console
+void latency_draw(int32_t line);          // brain screen, starting at line
+int32_t latency_log(const char *filename); // append to a file on the sd card
+
+#endif // LATENCY_H
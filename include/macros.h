@@ -6,7 +6,7 @@
 
 
 // flywheel speed (in rpm)
-// 600 is the max rpm of the vex motors
+// 600 is the max rpm of the flywheel's 6:1 cartridge
 #define FLYWHEEL_RPM 600
 
 // drivetrain speed (in rpm)
@@ -16,3 +16,183 @@
 // wait time (in seconds)
 // amount of time to wait for automation
 #define WAIT_TIME 3 
+
+// latency log file on the sd card
+#define LATENCY_LOG_FILE "latency.txt"
+
+// usb serial channel telemetry goes out on
+// (1 is the user channel, the same one printf uses, so the robot code
+// never calls printf: console text goes out framed, telemetry_printf)
+#define TELEMETRY_CHANNEL 1
+
+// how often the telemetry task sends (in ms)
+#define TELEMETRY_PERIOD 20
+
+// cpu profile window (ms), each task's share is worked out and streamed
+// once a window
+#define PROFILE_WINDOW 1000
+
+// tunable parameter file on the sd card, and the biggest one we will read
+#define PARAMS_FILE "params.ini"
+#define PARAMS_FILE_MAX 1024
+
+// usb serial channel the parameter console listens on (replies go back
+// as telemetry text frames, it shares the channel with the stream)
+#define PARAMS_CONSOLE_CHANNEL 1
+
+// how often the console task checks for input (in ms)
+#define PARAMS_CONSOLE_PERIOD 50
+
+// drive control loop period, and how long after its release (in ms) a
+// tick has to be done by before it counts as an overrun (and the best
+// effort tasks start giving up runs to it)
+#define DRIVE_PERIOD 10
+#define DRIVE_DEADLINE 5
+
+// task priorities, when more than one task is ready vexos runs the highest
+// first. the drive tick goes ahead of everything, the best effort tasks
+// (telemetry, the controller screen, crash checkpoints) after the rest
+#define TASK_PRIORITY_CONTROL 15
+#define TASK_PRIORITY_BEST_EFFORT 3
+
+// default drive mode (0 = tank on the buttons, 1 = arcade, 2 = curvature)
+#define DRIVE_MODE 0
+
+// forward stick (in percent) under which curvature drive turns in place
+#define DRIVE_QUICKTURN_DEADBAND 5
+
+// how many commands the drive skew benchmark times
+#define SKEW_BENCH_SAMPLES 200
+
+// heading hold gains (rpm of turn per degree of error)
+#define HEADING_KP 4.0
+#define HEADING_KI 2.0
+#define HEADING_KD 0.1
+
+// most turn (in rpm) heading hold will add on top of the drive
+#define HEADING_MAX_CORRECTION 40
+
+// flywheel gains, the motor runs on voltage (mV per rpm of target, per
+// rpm of error, and per rpm s of error)
+// kf is 12 V over the 600 rpm a 6:1 cartridge does with no load
+#define FLYWHEEL_KF 20.0
+#define FLYWHEEL_KP 30.0
+#define FLYWHEEL_KI 20.0
+
+// most the flywheel integral can add (mV)
+#define FLYWHEEL_MAX_INTEGRAL 4000
+
+// output shaping: drive acceleration (rpm/s) and jerk (rpm/s/s), the
+// flywheel's voltage ramp (mV/s) and its jerk (mV/s/s), and the current
+// (mA) every shaped motor shares, the brain's total for the motor ports.
+// NOTE: with 5 motors at MOTOR_STALL_CURRENT that is 12.5 A, under the
+// budget, so on this robot neither the ramps nor the arbiter ever cut a
+// motor's current (every limit stays at 2500). it only starts to bite past
+// 8 motors, or with a smaller budget (slew_sim and push_sim run one)
+#define DRIVE_SLEW_ACCEL 400.0
+#define DRIVE_SLEW_JERK 4000.0
+#define FLYWHEEL_SLEW_ACCEL 24000.0
+#define FLYWHEEL_SLEW_JERK 480000.0
+#define CURRENT_BUDGET 20000
+
+// one v5 motor stalled (mA), and the free speeds (rpm) of the drive and
+// flywheel cartridges
+#define MOTOR_STALL_CURRENT 2500
+#define DRIVE_FREE_RPM 200
+#define FLYWHEEL_FREE_RPM 600
+
+// how fast (rpm/s) the drive could speed up on stall current, with the
+// robot's weight on the wheels
+#define DRIVE_STALL_ACCEL 2300.0
+
+// current arbiter: what every motor keeps whatever else wants current
+// (mA), how much a group's limit grows a tick while it draws all of it,
+// the room (mA) a group asks for over what it draws, and the step (mA)
+// limits move in
+#define ARBITER_FLOOR 200
+#define ARBITER_GROWTH 1.25
+#define ARBITER_HEADROOM 300
+#define ARBITER_STEP 50
+
+// longest gap (s) a shaped group steps across at once, so a pause in the
+// commands doesnt turn into a jump
+#define SLEW_MAX_DT 0.05
+
+// raw encoder counts per output revolution on an 18:1 and a 6:1 cartridge
+#define MOTOR_COUNTS_18 900.0
+#define MOTOR_COUNTS_6 300.0
+
+// velocity estimation tuning
+// adaptive window: how far (in counts) a sample can sit off the fitted line,
+// plus how far off (in us) a timestamp can be
+// kalman: expected acceleration (counts/s/s) and position noise (counts squared)
+#define VELOCITY_WINDOW_NOISE 1.5
+#define VELOCITY_WINDOW_JITTER 1000.0
+#define VELOCITY_KALMAN_ACCEL 20000.0
+#define VELOCITY_KALMAN_MEASURE 4.0
+
+// how often (ms) to check the vision sensor is still there
+#define VISION_CHECK_PERIOD 500
+
+// drive geometry (4in wheels, 12in between the wheel centers)
+#define DRIVE_WHEEL_DIAMETER 0.1016
+#define DRIVE_TRACK_WIDTH 0.305
+
+// vision sensor image width (pixels) and horizontal field of view (degrees)
+#define VISION_WIDTH 316
+#define VISION_FOV 61.0
+
+// pose filter noise: wheel (m squared per m of travel), imu heading and
+// vision bearing (rad, 1 sigma), and the gate for bearings (sigma squared)
+#define POSE_WHEEL_NOISE 0.002
+#define POSE_IMU_NOISE 0.01
+#define POSE_BEARING_NOISE 0.03
+#define POSE_GATE 9.0
+
+// time (us) one pose filter step may take in the drive tick
+#define POSE_BUDGET_US 50
+#define POSE_LOG_FILE "pose.csv"
+
+// how often (ms) the pose log task looks for a finished auton run to save
+#define POSE_LOG_CHECK_PERIOD 100
+
+// vision frames (ms): sensor frame period, how early to start checking for
+// the next one, and how often to check once we are waiting on it
+#define VISION_FRAME_PERIOD 20
+#define VISION_FRAME_MARGIN 4
+#define VISION_POLL_PERIOD 2
+
+// autonomous: routines the selector has room for, routine picked at power
+// on, drive accel (m/s/s), turn rate
+// (deg/s) and accel (deg/s/s), and time (ms) to settle after a turn
+#define AUTON_MAX_ROUTINES 8
+#define AUTON_DEFAULT 0
+#define AUTON_ACCEL 1.5
+#define AUTON_TURN_RATE 90.0
+#define AUTON_TURN_ACCEL 360.0
+#define AUTON_SETTLE 200
+
+// how often (ms) the selector looks at the screen while disabled
+#define AUTON_SELECT_PERIOD 50
+
+// how often (ms) the timer task moves the timer wheel along
+#define TIMER_WHEEL_PERIOD 1
+
+// rumbles: how close (rpm) the flywheel has to be to count as ready, motor
+// temperature (celsius) and battery (percent) to warn at, and how long
+// (ms) before the same warning can rumble again
+#define FLYWHEEL_READY_BAND 15
+#define RUMBLE_MOTOR_TEMP 55
+#define RUMBLE_BATTERY_PERCENT 20
+#define RUMBLE_TEMP_COOLDOWN 10000
+#define RUMBLE_BATTERY_COOLDOWN 30000
+
+// crash dumps on the sd card: written when the program aborts or the kill
+// button is hit, and the checkpoint rewritten every so often (ms) in case
+// it goes down some way we never hear about (the last run's checkpoint is
+// kept as the previous one at startup)
+#define CRASH_FILE "crash.bin"
+#define CRASH_ESTOP_FILE "estop.bin"
+#define CRASH_CHECKPOINT_FILE "crash_last.bin"
+#define CRASH_PREVIOUS_FILE "crash_prev.bin"
+#define CRASH_CHECKPOINT_PERIOD 5000
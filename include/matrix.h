@@ -0,0 +1,94 @@
+
+/*
+ * matrix.h
+ * small fixed size matrices for the filters
+ * NOTE: sizes are template arguments so everything lives on the stack or
+ * inside the owning object, nothing here ever allocates
+*/
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stdint.h>
+
+
+template<int R, int C>
+struct matrix {
+  double m[R][C];
+
+  double &operator()(int r, int c) { return m[r][c]; }
+  double operator()(int r, int c) const { return m[r][c]; }
+
+  static matrix zero(void) {
+    matrix out;
+    for (int r = 0; r < R; r++)
+      for (int c = 0; c < C; c++)
+        out.m[r][c] = 0;
+    return out;
+  }
+
+  static matrix identity(void) {
+    matrix out = zero();
+    for (int i = 0; i < R && i < C; i++)
+      out.m[i][i] = 1;
+    return out;
+  }
+
+  matrix<C, R> transpose(void) const {
+    matrix<C, R> out;
+    for (int r = 0; r < R; r++)
+      for (int c = 0; c < C; c++)
+        out.m[c][r] = m[r][c];
+    return out;
+  }
+
+  matrix operator+(const matrix &b) const {
+    matrix out;
+    for (int r = 0; r < R; r++)
+      for (int c = 0; c < C; c++)
+        out.m[r][c] = m[r][c] + b.m[r][c];
+    return out;
+  }
+
+  matrix operator-(const matrix &b) const {
+    matrix out;
+    for (int r = 0; r < R; r++)
+      for (int c = 0; c < C; c++)
+        out.m[r][c] = m[r][c] - b.m[r][c];
+    return out;
+  }
+
+  matrix operator*(double k) const {
+    matrix out;
+    for (int r = 0; r < R; r++)
+      for (int c = 0; c < C; c++)
+        out.m[r][c] = m[r][c] * k;
+    return out;
+  }
+
+  template<int K>
+  matrix<R, K> operator*(const matrix<C, K> &b) const {
+    matrix<R, K> out;
+    for (int r = 0; r < R; r++) {
+      for (int k = 0; k < K; k++) {
+        double sum = 0;
+        for (int c = 0; c < C; c++)
+          sum += m[r][c] * b.m[c][k];
+        out.m[r][k] = sum;
+      }
+    }
+    return out;
+  }
+
+  // average with the transpose, rounding slowly breaks covariance symmetry
+  void symmetrize(void) {
+    for (int r = 0; r < R; r++) {
+      for (int c = r + 1; c < C; c++) {
+        double v = (m[r][c] + m[c][r]) / 2;
+        m[r][c] = m[c][r] = v;
+      }
+    }
+  }
+};
+
+#endif // MATRIX_H
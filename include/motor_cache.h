@@ -0,0 +1,101 @@
+
+/*
+ * motor_cache.h
+ * every motor reading the robot uses, taken once per tick
+ * NOTE: each port says up front which fields it needs, refresh() reads
+ * exactly those (field by field, so each array fills front to back) and
+ * everything else in the tick reads the arrays. the device calls per tick
+ * are fixed when the cache is built, see calls(). one task refreshes,
+ * anyone can read (vex tasks are cooperative, nobody sees half a refresh)
+*/
+
+#ifndef MOTOR_CACHE_H
+#define MOTOR_CACHE_H
+
+#include <stdint.h>
+
+#include "vex.h"
+
+// most motors one cache holds (one per smart port)
+#define MOTOR_CACHE_MAX 21
+
+
+// what to read from a motor
+enum motor_field {
+  MOTOR_POSITION = 1 << 0,     // degrees
+  MOTOR_RAW = 1 << 1,          // raw counts and the device's ms timestamp
+  MOTOR_VELOCITY = 1 << 2,     // rpm
+  MOTOR_CURRENT = 1 << 3,      // mA
+  MOTOR_VOLTAGE = 1 << 4,      // mV
+  MOTOR_TEMPERATURE = 1 << 5,  // celsius
+  MOTOR_TORQUE = 1 << 6,       // Nm
+  MOTOR_EFFICIENCY = 1 << 7    // percent
+};
+
+struct motor_read {
+  int32_t port;
+  uint32_t fields;   // motor_field bits
+};
+
+
+class motor_cache {
+  private:
+    int32_t _ports[MOTOR_CACHE_MAX];
+    uint32_t _fields[MOTOR_CACHE_MAX];
+    uint32_t _count;
+    int8_t _slot[V5_MAX_DEVICE_PORTS];   // port to array index, -1 if not cached
+    uint32_t _calls;
+
+    uint64_t _timestamp;
+    uint32_t _duration;
+    uint32_t _sequence;
+
+    double _position[MOTOR_CACHE_MAX];
+    int32_t _raw[MOTOR_CACHE_MAX];
+    uint32_t _raw_time[MOTOR_CACHE_MAX];
+    double _velocity[MOTOR_CACHE_MAX];
+    int32_t _current[MOTOR_CACHE_MAX];
+    int32_t _voltage[MOTOR_CACHE_MAX];
+    double _temperature[MOTOR_CACHE_MAX];
+    double _torque[MOTOR_CACHE_MAX];
+    double _efficiency[MOTOR_CACHE_MAX];
+
+  public:
+    motor_cache(const motor_read *reads, uint32_t count);
+
+    // one pass over every port, call once at the top of the tick
+    void refresh(void);
+
+    // array index of a port, -1 if it isnt cached
+    int32_t slot(int32_t port) const;
+
+    // whether a port reads all of these fields
+    bool has(int32_t port, uint32_t fields) const;
+
+    // by port, 0 for a port or field that isnt cached
+    double position(int32_t port) const;
+    int32_t raw(int32_t port) const;
+    uint32_t raw_time(int32_t port) const;
+    double velocity(int32_t port) const;
+    int32_t current(int32_t port) const;
+    int32_t voltage(int32_t port) const;
+    double temperature(int32_t port) const;
+    double torque(int32_t port) const;
+    double efficiency(int32_t port) const;
+
+    // the arrays themselves, by slot, for going over every motor
+    uint32_t count(void) const { return _count; }
+    const int32_t *ports(void) const { return _ports; }
+    const double *velocities(void) const { return _velocity; }
+    const int32_t *currents(void) const { return _current; }
+    const double *temperatures(void) const { return _temperature; }
+
+    // device calls one refresh makes
+    uint32_t calls(void) const { return _calls; }
+
+    uint64_t timestamp(void) const { return _timestamp; }   // us, before the first read
+    uint32_t duration(void) const { return _duration; }     // us the pass took
+    uint32_t sequence(void) const { return _sequence; }
+};
+
+#endif // MOTOR_CACHE_H
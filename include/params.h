@@ -0,0 +1,93 @@
+
+/*
+ * params.h
+ * tunable parameters
+ * NOTE: the defaults still live in macros.h, this just lets us change them
+ * from the sd card (params.ini) or the serial console without a rebuild
+*/
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "macros.h"
+
+
+// every tunable parameter
+// X(name, type, default, min, max)
+#define PARAM_LIST(X) \
+  X(flywheel_rpm,     int32_t, FLYWHEEL_RPM,     0, 600) \
+  X(drivetrain_speed, int32_t, DRIVETRAIN_SPEED, 0, 200) \
+  X(wait_time,        float,   WAIT_TIME,        0, 15) \
+  X(drive_mode,       int32_t, DRIVE_MODE,       0, 2) \
+  X(heading_kp,       float,   HEADING_KP,       0, 50) \
+  X(heading_ki,       float,   HEADING_KI,       0, 50) \
+  X(heading_kd,       float,   HEADING_KD,       0, 10) \
+  X(flywheel_kf,      float,   FLYWHEEL_KF,      0, 100) \
+  X(flywheel_kp,      float,   FLYWHEEL_KP,      0, 500) \
+  X(flywheel_ki,      float,   FLYWHEEL_KI,      0, 500) \
+  X(auton,            int32_t, AUTON_DEFAULT,    0, AUTON_MAX_ROUTINES - 1)
+
+
+// one parameter
+// reads are a single relaxed load so control loops can call get() every tick,
+// writes are a single store so a reader sees either the old or the new value
+template <class T>
+class param {
+  private:
+    std::atomic<T> _value;
+    T _default;
+    T _min;
+    T _max;
+
+  public:
+    param(T value, T min, T max) : _value(value), _default(value), _min(min), _max(max) {}
+
+    T get() const {
+      return _value.load(std::memory_order_relaxed);
+    }
+
+    // returns false (and changes nothing) if the value is out of range
+    bool set(T value) {
+      if (!(value >= _min && value <= _max)) {
+        return false;
+      }
+      _value.store(value, std::memory_order_relaxed);
+      return true;
+    }
+
+    void reset() {
+      _value.store(_default, std::memory_order_relaxed);
+    }
+};
+
+#define PARAM_DECLARE(name, type, value, min, max) extern param<type> param_##name;
+PARAM_LIST(PARAM_DECLARE)
+#undef PARAM_DECLARE
+
+
+// bumped after every successful update, so loops that cache derived
+// values (gains, profiles) know when to recompute
+uint32_t params_version(void);
+
+// set a parameter by name from text, returns false on unknown name or bad value
+bool params_set(const char *name, const char *value);
+
+// format a parameter by name, returns false on unknown name
+bool params_get(const char *name, char *out, uint32_t len);
+
+// parse an ini style buffer (name = value, # or ; comments, [sections] ignored)
+// returns the number of parameters that were set
+int32_t params_parse(const char *text, uint32_t len);
+
+// load/save the parameter file on the sd card
+int32_t params_load(const char *filename);
+int32_t params_save(const char *filename);
+
+// serial console, call from a background task, replies go out as telemetry text
+// understands: set <name> <value> | get <name> | list | save | load | reset
+void params_console_poll(void);
+
+#endif // PARAMS_H
@@ -0,0 +1,105 @@
+
+/*
+ * periodic.h
+ * fixed rate tasks with a deadline, and shedding the ones that can wait
+ * NOTE: a task is released every period and should be done within its
+ * deadline of the release. how late each run starts and how long it runs
+ * go in the task's latency entry (so the latency report and crash dumps
+ * have them) and its cpu in its profile entry. a control task finishing
+ * past its deadline means the cpu is overloaded: from then on the best
+ * effort tasks (screens, telemetry, sd card writes) only run every 2nd,
+ * 4th .. release, up to PERIODIC_MAX_STRETCH, and get back one halving at
+ * a time after PERIODIC_RECOVER_TICKS control runs on time. control tasks
+ * are never shed
+*/
+
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "latency.h"
+#include "profile.h"
+
+// how many tasks can register
+#define PERIODIC_MAX_TASKS 8
+
+// best effort tasks run at most once every this many releases
+#define PERIODIC_MAX_STRETCH 16
+
+// control runs on time before the best effort tasks get twice the runs back
+#define PERIODIC_RECOVER_TICKS 50
+
+
+enum periodic_kind {
+  PERIODIC_CONTROL = 0,       // always runs, its misses shed the rest
+  PERIODIC_BEST_EFFORT = 1    // runs when there is room
+};
+
+
+class periodic_task {
+  private:
+    const char *_name;
+    uint32_t _period;           // ms
+    uint32_t _deadline;         // ms after the release
+    periodic_kind _kind;
+    void (*_tick)(void);
+
+    latency_task *_timing;
+    profile_task *_cpu;
+
+    uint32_t _release;          // ms, the next release
+    uint32_t _releases;
+    uint64_t _start;            // us, when the current run started
+    uint64_t _due;              // us, and when it has to be done by
+
+    std::atomic<uint32_t> _runs;
+    std::atomic<uint32_t> _overruns;  // runs that finished past the deadline
+    std::atomic<uint32_t> _shed;      // releases given up to the control tasks
+    std::atomic<uint32_t> _skipped;   // releases that went by while it was still late
+
+  public:
+    periodic_task(const char *name, uint32_t period, uint32_t deadline, periodic_kind kind, void (*tick)(void));
+
+    // register the timing and cpu entries and release the first run now,
+    // call once at startup before the task is started
+    void start(void);
+
+    // the task body, never returns: sleeps until each release and runs
+    // the tick unless it is shed
+    void run(void);
+
+    // one release by hand (run() is just these in a loop), begin returns
+    // false when the release is shed and end mustnt be called
+    uint32_t release(void) const { return _release; }
+    bool begin(void);
+    void end(void);
+
+    // from inside the tick, let anything else that is due run before
+    // carrying on (between the pieces of a long sd card write). the time
+    // away still counts towards this run's length but not its cpu
+    void yield(void);
+
+    const char *name(void) const { return _name; }
+    uint32_t period(void) const { return _period; }
+    uint32_t deadline(void) const { return _deadline; }
+    periodic_kind kind(void) const { return _kind; }
+    uint64_t started(void) const { return _start; }     // us, this run
+    const latency_task *timing(void) const { return _timing; }
+
+    uint32_t runs(void) const { return _runs.load(std::memory_order_relaxed); }
+    uint32_t overruns(void) const { return _overruns.load(std::memory_order_relaxed); }
+    uint32_t shed(void) const { return _shed.load(std::memory_order_relaxed); }
+    uint32_t skipped(void) const { return _skipped.load(std::memory_order_relaxed); }
+};
+
+
+// best effort tasks run once every this many releases right now (1 is
+// every release)
+uint32_t periodic_stretch(void);
+
+// one line per task to the serial console
+void periodic_print(void);
+
+#endif // PERIODIC_H
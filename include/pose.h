@@ -0,0 +1,137 @@
+
+/*
+ * pose.h
+ * field position from wheel odometry, imu heading and vision landmarks
+ * NOTE: extended kalman filter on (x, y, theta), runs inside the drive
+ * tick. the whole step (predict, heading and one bearing update) is a few
+ * hundred flops on 3x3 matrices, budget is POSE_BUDGET_US per tick on the
+ * brain and the "pose" latency entry shows what it really takes
+*/
+
+#ifndef POSE_H
+#define POSE_H
+
+#include <stdint.h>
+
+#include "matrix.h"
+
+// drive ticks kept for replay (30 s at the drive rate)
+#define POSE_LOG_SAMPLES 3000
+
+// csv lines a save writes between pauses
+#define POSE_LOG_CHUNK 100
+
+
+// field frame, meters from the corner, theta in radians counter clockwise
+// from the +x wall (so unlike the imu, left turns are positive)
+struct pose {
+  double x;
+  double y;
+  double theta;
+};
+
+// something the vision sensor can see that doesnt move
+struct landmark {
+  uint8_t signature;  // vision signature id or color code, as the sensor reports it
+  double x;
+  double y;
+};
+
+// one drive tick of raw inputs, exactly what the filter is fed
+// (logged on the robot and replayed by tools/pose_replay)
+struct pose_sample {
+  uint32_t time;       // ms
+  float left;          // wheel degrees, average of the side
+  float right;
+  float heading;       // imu degrees, clockwise
+  uint8_t signature;   // landmark seen this tick, 0 for none
+  int16_t x_center;    // its center in pixels
+};
+
+
+class pose_filter {
+  private:
+    const landmark *_landmarks;
+    uint32_t _landmark_count;
+
+    matrix<3, 1> _x;
+    matrix<3, 3> _p;
+
+    // the first sample after a reset only sets these
+    bool _have_wheels;
+    double _last_left;
+    double _last_right;
+    bool _have_imu;
+    double _imu_offset;
+
+    uint32_t _accepted;
+    uint32_t _rejected;
+
+    // one scalar measurement, returns false if it failed the gate
+    bool correct(const matrix<1, 3> &h, double innovation, double noise, bool gate);
+
+  public:
+    pose_filter(const landmark *landmarks, uint32_t count);
+
+    // start over from a known pose (e.g. the auton start tile)
+    void reset(const pose &start);
+
+    // wheel positions in degrees, as read (not deltas)
+    void predict(double left_deg, double right_deg);
+
+    // imu heading in degrees, clockwise, any wrap
+    void update_heading(double imu_deg);
+
+    // bearing (radians, left positive) to something with this signature
+    // matched against the nearest landmark, returns false if nothing
+    // plausible is there (a false detection, or something in the way)
+    bool update_bearing(uint8_t signature, double bearing);
+
+    // everything above from one logged tick
+    void step(const pose_sample &sample);
+
+    pose get(void) const;
+
+    // 1 sigma position (m) and heading (rad) uncertainty
+    double sigma_xy(void) const;
+    double sigma_theta(void) const;
+
+    uint32_t accepted(void) const { return _accepted; }
+    uint32_t rejected(void) const { return _rejected; }
+};
+
+
+// bearing (radians, left positive) of a vision object from its center x
+double vision_bearing(int32_t x_center);
+
+
+// fixed size record of pose_samples for replay on the host
+class pose_log {
+  private:
+    pose_sample _samples[POSE_LOG_SAMPLES];
+    uint32_t _count;
+    pose _start;
+    bool _closed;
+
+  public:
+    pose_log(void) { _count = 0; _start = { 0, 0, 0 }; _closed = false; }
+
+    // throw away what we have and note where the new run starts
+    void start(const pose &start) { _count = 0; _start = start; _closed = false; }
+
+    // drops samples once full or closed, the start of a run is what matters
+    void add(const pose_sample &sample);
+    uint32_t count(void) const { return _count; }
+
+    // the run is over, nothing more goes in until the next start (so a
+    // save that comes later still writes just the run)
+    void close(void) { _closed = true; }
+
+    // csv on the sd card with the start pose and landmarks at the top,
+    // calls pause every POSE_LOG_CHUNK lines so the task saving it can
+    // let the drive tick in. returns samples written, -1 if the file cant
+    // be opened
+    int32_t save(const char *filename, const landmark *landmarks, uint32_t count, void (*pause)(void));
+};
+
+#endif // POSE_H
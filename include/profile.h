@@ -0,0 +1,80 @@
+
+/*
+ * profile.h
+ * how much of the cpu each task takes, and its longest run
+ * NOTE: vex tasks are cooperative, a task has the cpu from when it wakes
+ * up until it sleeps or yields, so marking those two points counts its
+ * time exactly (no sampling needed). each task marks its own runs, one
+ * update a window turns the totals into a share of the window. whatever
+ * isnt in a task here (vexos, the event dispatch, anything unmarked) is
+ * reported as other
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// how many tasks can register (main uses 8, the rest is headroom)
+#define PROFILE_MAX_TASKS 16
+
+
+struct profile_task {
+  const char *name;
+
+  // written by the task itself
+  uint64_t entered;                   // us, when the current run started
+  uint32_t depth;                     // nested enters, only the outer one counts
+  uint32_t window;                    // the window longest belongs to
+  std::atomic<uint32_t> busy;         // us run, all time (wraps, only differences are used)
+  std::atomic<uint32_t> runs;
+  std::atomic<uint32_t> longest;      // us, longest run this window
+  std::atomic<uint32_t> longest_ever;
+
+  // written by the update
+  uint32_t last_busy;
+  uint32_t last_runs;
+  std::atomic<uint32_t> permille;     // of the cpu last window
+  std::atomic<uint32_t> worst;        // us, longest run last window
+};
+
+
+// register a task, call once at startup (not on the hot path)
+// returns NULL when the table is full
+profile_task *profile_register(const char *name);
+
+// the task has the cpu (right after it wakes up) / is giving it up (right
+// before it sleeps or yields), a NULL task (the table was full) is ignored
+void profile_enter(profile_task *task);
+void profile_leave(profile_task *task);
+
+// close the window and work out every task's share, once a window from
+// any task
+void profile_update(void);
+
+// the registered tasks, the last window's unmarked share (permille) and
+// what the marking itself cost (hundredths of a percent)
+int32_t profile_task_count(void);
+const profile_task *profile_task_at(int32_t index);
+uint32_t profile_other(void);
+uint32_t profile_overhead(void);
+
+
+// scoped run, for code that runs on someone else's task (event handlers)
+// profile_scope scope(events);
+class profile_scope {
+  private:
+    profile_task *_task;
+
+  public:
+    profile_scope(profile_task *task) { _task = task; profile_enter(task); }
+    ~profile_scope() { profile_leave(_task); }
+};
+
+
+// reporting, from the last window
+void profile_print(void);                 // serial console
+void profile_draw(int32_t line);          // brain screen, starting at line
+
+#endif // PROFILE_H
@@ -0,0 +1,97 @@
+
+/*
+ * slew.h
+ * acceleration and jerk limits on motor commands, under one current budget
+ * NOTE: a group is motors that are always commanded together (a drive
+ * side, the flywheel). its output ramps toward the target with the
+ * acceleration coming in at the jerk limit and easing off again before
+ * the target, so neither the command nor its rate ever steps. every group
+ * also estimates what its next command draws (a motor on voltage pulls
+ * current in proportion to how far the command is ahead of its speed, one
+ * on its own velocity loop pulls what it takes to accelerate the load at
+ * the commanded rate) and the groups on one budget share it in
+ * proportion to what they ask for. the budget keeps a running total
+ * rather than walking every group, so a group's step costs the same
+ * however many there are
+*/
+
+#ifndef SLEW_H
+#define SLEW_H
+
+#include <stdint.h>
+
+// groups one budget can share between
+#define SLEW_MAX_GROUPS 8
+
+
+// in the group's output units (rpm or mV) per s, and per s squared
+// zero acceleration means no shaping, the target goes straight out
+struct slew_limits {
+  double accel;
+  double jerk;
+};
+
+
+class current_budget {
+  private:
+    double _limit;                      // mA
+    double _demand[SLEW_MAX_GROUPS];    // mA, each group's latest
+    double _total;
+    uint32_t _count;
+
+  public:
+    current_budget(double limit);
+
+    // a slot for a new group, -1 once they are all taken
+    int32_t join(void);
+
+    // what a group wants to draw now (mA), returns the fraction of it the
+    // group can have (1 while everyone fits)
+    double share(int32_t slot, double demand);
+
+    double limit(void) const { return _limit; }
+    double total(void) const { return _total; }
+};
+
+
+class slew_group {
+  private:
+    slew_limits _limits;
+    double _full_scale;      // output that runs the motors at free speed
+    double _stall_rate;      // output per s the load gains on stall current
+    double _stall;           // mA, every motor in the group stalled
+    current_budget *_budget;
+    int32_t _slot;
+
+    double _output;
+    double _rate;            // output units per s
+    uint64_t _last_us;
+    double _demand;          // mA, last step
+    double _fraction;        // of the demand the budget allowed
+
+  public:
+    // unshaped, step() hands the target straight back
+    slew_group(void);
+
+    // full_scale is the output at free speed (200 rpm on an 18:1, 12000
+    // mV), stall_rate how fast the output could rise on stall current with
+    // the group's load on it (0 when the output isnt a speed), stall the
+    // current the whole group draws stalled. budget may be NULL for a group
+    // with nobody to share with
+    slew_group(const slew_limits &limits, double full_scale, double stall_rate, double stall,
+               current_budget *budget);
+
+    // next command toward target, given what the motors are doing now in
+    // the same units as the output, one call per tick
+    double step(double target, double actual);
+
+    // jump straight to an output (stopping, the e-stop)
+    void reset(double output);
+
+    double output(void) const { return _output; }
+    double demand(void) const { return _demand; }
+    double fraction(void) const { return _fraction; }
+    bool shaping(void) const { return _limits.accel > 0; }
+};
+
+#endif // SLEW_H
@@ -0,0 +1,131 @@
+
+/*
+ * telemetry.h
+ * binary telemetry over the usb serial port
+ * NOTE: this header is shared with the host side receiver (tools/telemetry_rx.cpp)
+ * so keep it to plain c types and the v5 c api
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// frame layout (before cobs encoding)
+//   type (1) | seq (1) | timestamp us (4) | payload (0..TELEMETRY_MAX_PAYLOAD) | crc8 (1)
+// every frame is cobs encoded and ends with a single 0x00 so the
+// receiver can always resync on the next zero
+#define TELEMETRY_HEADER_SIZE 6
+#define TELEMETRY_MAX_PAYLOAD 48
+#define TELEMETRY_MAX_FRAME (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + 1)
+#define TELEMETRY_MAX_ENCODED (TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254 + 2)
+
+// decimation limits (we only ever send every Nth record of a type)
+#define TELEMETRY_MAX_DECIMATE 64
+#define TELEMETRY_RECOVER_SENDS 32 // clean sends before we halve decimation again
+
+// longest console line telemetry_printf formats, the rest is cut off
+#define TELEMETRY_TEXT_MAX 256
+
+
+// record types
+enum telemetry_type {
+  TELEM_STATS = 0,    // telemetry_stats
+  TELEM_MOTOR = 1,    // telemetry_motor
+  TELEM_DRIVE = 2,    // telemetry_drive
+  TELEM_FLYWHEEL = 3, // telemetry_flywheel
+  TELEM_LATENCY = 4,  // telemetry_latency
+  TELEM_TEXT = 5,     // raw characters, not null terminated
+  TELEM_ESTOP = 6,    // telemetry_estop
+  TELEM_CURRENT = 7,  // telemetry_current
+  TELEM_CPU = 8,      // telemetry_cpu
+  TELEM_TYPE_COUNT
+};
+
+// record payloads (little endian, packed so both ends agree)
+struct __attribute__((packed)) telemetry_stats {
+  uint32_t sent;
+  uint32_t dropped;
+  uint32_t decimated;
+};
+
+struct __attribute__((packed)) telemetry_motor {
+  uint8_t port;
+  int16_t velocity;    // rpm * 10
+  int16_t current;     // mA
+  int16_t voltage;     // mV
+  int16_t temperature; // celsius * 10
+};
+
+struct __attribute__((packed)) telemetry_drive {
+  int16_t left;    // commanded rpm
+  int16_t right;   // commanded rpm
+  int16_t heading; // degrees * 100
+};
+
+struct __attribute__((packed)) telemetry_flywheel {
+  int16_t target; // rpm
+  int16_t actual; // rpm * 10
+};
+
+struct __attribute__((packed)) telemetry_latency {
+  uint8_t task;
+  uint32_t run_p50; // us
+  uint32_t run_p99; // us
+  uint32_t late_p99; // us
+};
+
+struct __attribute__((packed)) telemetry_estop {
+  uint32_t edge_ms;  // system time the button was seen
+  uint32_t stop_us;  // from the button to the last motor stop command
+  uint8_t motors;
+};
+
+struct __attribute__((packed)) telemetry_current {
+  uint8_t group;    // current arbiter group
+  int16_t limit;    // mA per motor
+  int16_t demand;   // mA per motor
+  int16_t drawn;    // mA, the group's hungriest motor
+};
+
+struct __attribute__((packed)) telemetry_cpu {
+  uint8_t task;     // profiled task, TELEMETRY_CPU_OTHER for everything else
+  uint16_t share;   // of the cpu last window, permille
+  uint32_t longest; // us, longest run last window (profiling cost for other,
+                    // hundredths of a percent)
+};
+#define TELEMETRY_CPU_OTHER 255
+
+
+// robot side
+// pack and send one record, never blocks
+// returns false when the record was dropped or decimated away
+bool telemetry_send(uint8_t type, const void *payload, uint32_t len);
+
+// console text, printf's stand in on the robot: printf would go out raw
+// on the same channel and break the frame after it, this sends the text
+// as TELEM_TEXT frames (TELEMETRY_MAX_PAYLOAD characters each) that the
+// receiver prints as they are. never blocks, returns characters sent
+int32_t telemetry_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// send the drop/decimation counters as a TELEM_STATS record
+bool telemetry_send_stats(void);
+
+// let every record type through again (an e-stop wants the last of
+// everything), returns how many bytes are still waiting to go out
+int32_t telemetry_flush(void);
+
+// current counters
+telemetry_stats telemetry_get_stats(void);
+
+
+// framing helpers (used by both ends)
+uint8_t telemetry_crc8(const uint8_t *data, uint32_t len);
+
+// returns the encoded length, out needs len + len / 254 + 1 bytes
+uint32_t telemetry_cobs_encode(const uint8_t *in, uint32_t len, uint8_t *out);
+
+// returns the decoded length, or -1 if the frame is malformed
+int32_t telemetry_cobs_decode(const uint8_t *in, uint32_t len, uint8_t *out);
+
+#endif // TELEMETRY_H
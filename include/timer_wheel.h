@@ -0,0 +1,96 @@
+
+/*
+ * timer_wheel.h
+ * one shot and periodic callbacks, all run from one task
+ * NOTE: hierarchical wheel at 1 ms, 4 levels of 64 slots (about 4.6 hours
+ * out). every timer sits on one slot list, so adding or cancelling is a
+ * couple of pointer writes, and a timer only moves down a level when its
+ * slot comes round. timers live in a fixed pool, nothing allocates.
+ * vex tasks are cooperative so any task can add or cancel without a lock,
+ * callbacks run in the wheel's task and must not block
+*/
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+// how many timers can be scheduled at once
+#define TIMER_WHEEL_MAX 2048
+
+// most callbacks one advance() will run, the rest wait for the next one
+#define TIMER_WHEEL_BUDGET 64
+
+
+typedef void (*timer_callback)(void *arg);
+
+// 0 is never a handle, so it can mean "no timer"
+typedef uint32_t timer_handle;
+
+
+class timer_wheel {
+  private:
+    struct node {
+      node *next;
+      node *prev;
+      uint32_t expires;   // ms
+      uint32_t period;    // ms, 0 for one shot
+      timer_callback callback;
+      void *arg;
+      uint16_t generation;
+      bool cancelled;     // while its callback is running
+    };
+
+    node _pool[TIMER_WHEEL_MAX];
+    node _slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];  // list heads
+    node _due;        // expired, waiting on the budget
+    node _free;
+    node *_running;
+
+    uint32_t _now;    // ms the wheel has been advanced to
+    uint32_t _pending;
+    uint32_t _fired;
+    uint32_t _skipped;    // periods a late periodic timer missed
+    uint32_t _max_late;   // ms
+
+    static void link(node *head, node *n);
+    static void unlink(node *n);
+    void place(node *n);
+    void cascade(int level);
+    timer_handle handle(node *n) const;
+    node *lookup(timer_handle timer);
+    timer_handle add(uint32_t delay, uint32_t period, timer_callback callback, void *arg);
+
+  public:
+    timer_wheel(void);
+
+    // set the clock without running anything (before the first advance)
+    void start(uint32_t now);
+
+    // run callback once, delay ms from now
+    // returns 0 when the pool is full
+    timer_handle after(uint32_t delay, timer_callback callback, void *arg);
+
+    // run callback every period ms, first one a period from now
+    timer_handle every(uint32_t period, timer_callback callback, void *arg);
+
+    // returns false if it already ran (one shot) or was cancelled
+    // a callback can cancel itself
+    bool cancel(timer_handle timer);
+
+    // move the wheel up to now (ms) and run what is due, up to the budget
+    // returns how many callbacks ran
+    uint32_t advance(uint32_t now);
+
+    uint32_t now(void) const { return _now; }
+    uint32_t pending(void) const { return _pending; }
+    uint32_t fired(void) const { return _fired; }
+    uint32_t skipped(void) const { return _skipped; }
+    uint32_t max_late(void) const { return _max_late; }
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,48 @@
+
+/*
+ * triple_buffer.h
+ * latest value handoff between one writer task and one reader task
+ * NOTE: neither side ever waits or copies, the writer fills its own buffer
+ * and swaps it in, the reader swaps out the newest one when there is one.
+ * a value the reader never got to is just replaced
+*/
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+
+template<class T>
+class triple_buffer {
+  private:
+    // set on the middle index when the writer put something new there
+    static const uint8_t FRESH = 0x4;
+    static const uint8_t INDEX = 0x3;
+
+    T _buffers[3];
+    std::atomic<uint8_t> _middle;
+    uint8_t _back;    // only the writer touches this one
+    uint8_t _front;   // only the reader touches this one
+
+  public:
+    triple_buffer(void) : _buffers(), _middle(1), _back(0), _front(2) {}
+
+    // writer: fill this in, then publish it
+    T &back(void) { return _buffers[_back]; }
+
+    void publish(void) {
+      _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader: newest published value (the same one again if nothing new)
+    const T &front(void) {
+      if (_middle.load(std::memory_order_relaxed) & FRESH) {
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+      }
+      return _buffers[_front];
+    }
+};
+
+#endif // TRIPLE_BUFFER_H
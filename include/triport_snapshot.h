@@ -0,0 +1,49 @@
+
+/*
+ * triport_snapshot.h
+ * read every three wire port in one pass
+ * NOTE: take one snapshot at the top of a tick and have everything in
+ * that tick read from it, instead of each sensor object hitting the
+ * jumptable on its own at a different time
+*/
+
+#ifndef TRIPORT_SNAPSHOT_H
+#define TRIPORT_SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "vex.h"
+
+
+// one coherent set of samples
+struct triport_snapshot {
+  uint64_t timestamp;                // us, taken right before the first read
+  uint32_t duration;                 // us the whole pass took
+  uint32_t sequence;                 // bumps every snapshot
+  uint8_t mask;                      // bit n set if port n was read
+  int32_t value[V5_ADI_PORT_NUM];    // raw value (what triport::port::value() returns)
+};
+
+
+class triport_sampler {
+  private:
+    int32_t _index;
+    uint32_t _sequence;
+    uint8_t _mask;
+    V5_AdiPortConfiguration _config[V5_ADI_PORT_NUM];
+
+  public:
+    // index of the triport, PORT22 for the one built into the brain
+    triport_sampler(int32_t index);
+
+    // read the port configuration and work out which ports need reading
+    // call after the sensors are set up (or if they change), not every tick
+    void refresh_config(void);
+
+    // one pass over every configured port
+    void take(triport_snapshot *snap);
+
+    V5_AdiPortConfiguration config(int32_t port) const { return _config[port]; }
+};
+
+#endif // TRIPORT_SNAPSHOT_H
@@ -0,0 +1,67 @@
+
+/*
+ * velocity.h
+ * velocity from raw encoder counts and their timestamps
+ * NOTE: the firmware velocity is noisy at low speed and lags at high
+ * speed, these work from the raw position instead
+*/
+
+#ifndef VELOCITY_H
+#define VELOCITY_H
+
+#include <stdint.h>
+
+// samples kept for the adaptive window
+#define VELOCITY_HISTORY 16
+
+
+enum velocity_method {
+  // end fit over the longest recent window that stays inside the count
+  // noise, short window when accelerating (low lag), long when steady
+  // (low noise)
+  VELOCITY_ADAPTIVE = 0,
+
+  // constant velocity kalman filter on position, copes with uneven gaps
+  VELOCITY_KALMAN = 1,
+
+  // plain difference of the last two samples (for comparison)
+  VELOCITY_DIFFERENCE = 2
+};
+
+
+class velocity_estimator {
+  private:
+    velocity_method _method;
+    double _counts_per_rev;
+    double _rpm;
+
+    // history, newest at _head
+    uint64_t _time[VELOCITY_HISTORY];
+    int32_t _counts[VELOCITY_HISTORY];
+    uint32_t _head;
+    uint32_t _size;
+
+    // kalman state (counts, counts/s) and covariance
+    double _x[2];
+    double _p[2][2];
+
+    void adaptive(void);
+    void kalman(double dt, int32_t counts);
+
+  public:
+    velocity_estimator(double counts_per_rev, velocity_method method);
+
+    // add a sample, time in us
+    // returns false (and changes nothing) if the time didnt move forward,
+    // which is what you get polling a motor faster than it reports
+    bool update(uint64_t time_us, int32_t counts);
+
+    // read a smart motor's raw position and its device timestamp
+    bool update_motor(int32_t port);
+
+    void reset(void);
+
+    double rpm(void) const { return _rpm; }
+};
+
+#endif // VELOCITY_H
@@ -1,3 +1,6 @@
 
 // include v5.h
 #include "v5.h"
+
+// and the c++ classes on top of it
+#include "v5_vcs.h"
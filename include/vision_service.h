@@ -0,0 +1,66 @@
+
+/*
+ * vision_service.h
+ * vision objects read in their own task and handed to the control code
+ * NOTE: the sensor only makes a new frame every ~20 ms and has no frame
+ * counter, so the service sleeps until the next frame is due, then does a
+ * cheap check (object count and the first object) and only reads the
+ * whole list when that changed. readers get the newest frame through a
+ * triple buffer and never wait on the sensor
+*/
+
+#ifndef VISION_SERVICE_H
+#define VISION_SERVICE_H
+
+#include <stdint.h>
+
+#include "vex.h"
+#include "triple_buffer.h"
+
+// objects kept per frame (the sensor tracks up to 16)
+#define VISION_FRAME_OBJECTS 16
+
+
+// one frame, largest object first
+struct vision_frame {
+  uint32_t sequence;    // bumps every new frame, 0 before the first one
+  uint32_t timestamp;   // ms, when we read it
+  uint32_t count;
+  V5_DeviceVisionObject objects[VISION_FRAME_OBJECTS];
+
+  // largest object with this signature (or color code), NULL if none
+  const V5_DeviceVisionObject *largest(uint16_t signature) const;
+};
+
+
+class vision_service {
+  private:
+    int32_t _port;
+    triple_buffer<vision_frame> _frames;
+    uint32_t _sequence;
+    uint32_t _published;        // ms, last frame we published
+    int32_t _last_count;
+    V5_DeviceVisionObject _last_first;
+
+    uint32_t _checks;
+    uint32_t _reads;
+
+  public:
+    vision_service(int32_t port);
+
+    // one check, from the vision task only
+    // returns true if a new frame was published
+    bool poll(void);
+
+    // how long (ms) the vision task should sleep after a poll
+    uint32_t next_poll(bool published) const;
+
+    // newest frame, from one reader task only (the drive task)
+    const vision_frame &latest(void) { return _frames.front(); }
+
+    // cheap checks vs full reads, to see the skipping is working
+    uint32_t checks(void) const { return _checks; }
+    uint32_t reads(void) const { return _reads; }
+};
+
+#endif // VISION_SERVICE_H
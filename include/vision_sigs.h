@@ -0,0 +1,70 @@
+
+/*
+ * vision_sigs.h
+ * vision sensor signatures as constant tables
+ * NOTE: the tables come from tools/vision_sigs (make vision), which turns
+ * a vision utility export into vision_table.h. at start up (and whenever
+ * the sensor is plugged back in) we read back what the sensor already has
+ * and only send the signatures that differ
+*/
+
+#ifndef VISION_SIGS_H
+#define VISION_SIGS_H
+
+#include <stdint.h>
+
+#include "vex.h"
+
+// ids 1..7, same as the vision utility
+#define VISION_SIG_COUNT 7
+
+
+// one signature, same fields as vision::signature
+struct vision_sig {
+  uint8_t id;
+  int32_t u_min, u_max, u_mean;
+  int32_t v_min, v_max, v_mean;
+  float range;
+  uint32_t type;     // V5VisionBlockType, color code members are kVisionTypeColorCode
+};
+
+// color code from its signature ids, first one in the top octal digit
+// (same number vision::code builds and the sensor reports)
+constexpr uint32_t vision_code(void) {
+  return 0;
+}
+
+template<typename... Ids>
+constexpr uint32_t vision_code(uint32_t id, Ids... rest) {
+  return (id << (3 * sizeof...(rest))) | vision_code(rest...);
+}
+
+
+class vision_signatures {
+  private:
+    int32_t _port;
+    const vision_sig *_table;
+    uint32_t _count;
+    uint8_t _brightness;
+    bool _present;
+    uint32_t _sent;
+
+  public:
+    vision_signatures(int32_t port, const vision_sig *table, uint32_t count, uint8_t brightness);
+
+    // make the sensor match the table
+    // returns how many signatures had to be sent, -1 if there is no sensor
+    int32_t sync(void);
+
+    // cheap check for a sensor that was unplugged and came back, syncs
+    // when it does. call from a slow loop
+    // returns what sync returned, or 0 if nothing happened
+    int32_t poll(void);
+
+    bool present(void) const { return _present; }
+
+    // signatures sent since start up (0 after a warm restart is the goal)
+    uint32_t sent(void) const { return _sent; }
+};
+
+#endif // VISION_SIGS_H
@@ -0,0 +1,26 @@
+
+/*
+ * vision_table.h
+ * generated by tools/vision_sigs from vision/signatures.txt
+ * NOTE: do not edit, change the export and run make vision
+*/
+
+#ifndef VISION_TABLE_H
+#define VISION_TABLE_H
+
+#include "vision_sigs.h"
+
+constexpr uint8_t VISION_BRIGHTNESS = 50;
+
+constexpr vision_sig SIG_RED = { 1, 8099, 8893, 8496, -1505, -949, -1227, 3.000f, kVisionTypeColorCode };
+constexpr vision_sig SIG_BLUE = { 2, -3441, -2785, -3113, 8975, 10355, 9665, 2.500f, kVisionTypeColorCode };
+constexpr vision_sig SIG_YELLOW = { 3, 1, 1093, 547, -4287, -3799, -4043, 3.200f, kVisionTypeNormal };
+constexpr vision_sig SIG_GREEN = { 4, -6195, -5579, -5887, -4467, -3835, -4151, 3.000f, kVisionTypeColorCode };
+
+constexpr vision_sig VISION_TABLE[] = { SIG_RED, SIG_BLUE, SIG_YELLOW, SIG_GREEN };
+constexpr uint32_t VISION_TABLE_COUNT = 4;
+
+constexpr uint32_t CODE_RED_GREEN = vision_code(SIG_RED.id, SIG_GREEN.id);
+constexpr uint32_t CODE_BLUE_GREEN = vision_code(SIG_BLUE.id, SIG_GREEN.id);
+
+#endif // VISION_TABLE_H
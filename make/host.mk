@@ -0,0 +1,80 @@
+################################################################################
+# host side tools (receiver, simulator, ...)
+# these build with the host compiler and link the robot sources against the
+# jumptable stand ins in sim/, nothing here ends up on the brain
+HOSTCXX?=g++
+HOSTCXXFLAGS?=-O2 -g -Wall -Wextra -Wno-unused-parameter
+HOSTCXXFLAGS+=--std=$(CXX_STANDARD) -iquote"$(INCDIR)" -iquote"$(SIMDIR)"
+HOSTLDFLAGS?=-pthread
+
+SIMDIR=$(ROOT)/sim
+TOOLDIR=$(ROOT)/tools
+HOSTBINDIR=$(BINDIR)/host
+
+SIMSRC=$(SIMDIR)/v5_sim.cpp $(SIMDIR)/vex_sim.cpp
+FIELDSRC=$(SIMDIR)/field_sim.cpp $(SIMSRC)
+
+HOST_TOOLS=$(HOSTBINDIR)/telemetry_rx $(HOSTBINDIR)/heading_sim \
+	$(HOSTBINDIR)/velocity_bench $(HOSTBINDIR)/vision_sigs $(HOSTBINDIR)/pose_replay \
+	$(HOSTBINDIR)/competition_sim $(HOSTBINDIR)/timer_bench $(HOSTBINDIR)/field_sim \
+	$(HOSTBINDIR)/autotune $(HOSTBINDIR)/bench $(HOSTBINDIR)/slew_sim \
+	$(HOSTBINDIR)/push_sim $(HOSTBINDIR)/crash_decode $(HOSTBINDIR)/overload_sim
+
+$(HOSTBINDIR)/telemetry_rx: $(TOOLDIR)/telemetry_rx.cpp $(SRCDIR)/telemetry.cpp $(SIMSRC)
+$(HOSTBINDIR)/heading_sim: $(TOOLDIR)/heading_sim.cpp $(SRCDIR)/heading.cpp $(SRCDIR)/drivetrain.cpp \
+	$(SRCDIR)/motor_cache.cpp $(SRCDIR)/slew.cpp $(SRCDIR)/latency.cpp $(SRCDIR)/params.cpp \
+	$(SRCDIR)/telemetry.cpp $(SIMSRC)
+$(HOSTBINDIR)/velocity_bench: $(TOOLDIR)/velocity_bench.cpp $(SRCDIR)/velocity.cpp $(SIMSRC)
+$(HOSTBINDIR)/vision_sigs: $(TOOLDIR)/vision_sigs.cpp
+$(HOSTBINDIR)/pose_replay: $(TOOLDIR)/pose_replay.cpp $(SRCDIR)/pose.cpp $(SIMSRC)
+$(HOSTBINDIR)/competition_sim: $(TOOLDIR)/competition_sim.cpp $(SRCDIR)/competition_manager.cpp \
+	$(SRCDIR)/auton.cpp $(SRCDIR)/drivetrain.cpp $(SRCDIR)/motor_cache.cpp $(SRCDIR)/slew.cpp \
+	$(SRCDIR)/heading.cpp $(SRCDIR)/latency.cpp $(SRCDIR)/params.cpp $(SRCDIR)/telemetry.cpp $(SIMSRC)
+$(HOSTBINDIR)/timer_bench: $(TOOLDIR)/timer_bench.cpp $(SRCDIR)/timer_wheel.cpp
+$(HOSTBINDIR)/field_sim: $(TOOLDIR)/field_sim.cpp $(SRCDIR)/auton.cpp $(SRCDIR)/drivetrain.cpp \
+	$(SRCDIR)/motor_cache.cpp $(SRCDIR)/slew.cpp $(SRCDIR)/heading.cpp $(SRCDIR)/pose.cpp \
+	$(SRCDIR)/velocity.cpp $(SRCDIR)/latency.cpp $(SRCDIR)/params.cpp $(SRCDIR)/telemetry.cpp \
+	$(FIELDSRC)
+$(HOSTBINDIR)/autotune: $(TOOLDIR)/autotune.cpp $(SRCDIR)/drivetrain.cpp $(SRCDIR)/motor_cache.cpp \
+	$(SRCDIR)/slew.cpp $(SRCDIR)/heading.cpp $(SRCDIR)/flywheel.cpp $(SRCDIR)/velocity.cpp \
+	$(SRCDIR)/latency.cpp $(SRCDIR)/params.cpp $(SRCDIR)/telemetry.cpp $(FIELDSRC)
+$(HOSTBINDIR)/bench: $(TOOLDIR)/bench.cpp $(SRCDIR)/drivetrain.cpp $(SRCDIR)/motor_cache.cpp \
+	$(SRCDIR)/slew.cpp $(SRCDIR)/heading.cpp $(SRCDIR)/controller_display.cpp $(SRCDIR)/pose.cpp \
+	$(SRCDIR)/auton.cpp $(SRCDIR)/vision_service.cpp $(SRCDIR)/telemetry.cpp $(SRCDIR)/latency.cpp \
+	$(SRCDIR)/params.cpp $(SRCDIR)/profile.cpp $(SIMSRC)
+$(HOSTBINDIR)/slew_sim: $(TOOLDIR)/slew_sim.cpp $(SRCDIR)/drivetrain.cpp $(SRCDIR)/motor_cache.cpp \
+	$(SRCDIR)/slew.cpp $(SRCDIR)/flywheel.cpp $(SRCDIR)/velocity.cpp $(SRCDIR)/latency.cpp \
+	$(SRCDIR)/params.cpp $(SRCDIR)/telemetry.cpp $(FIELDSRC)
+$(HOSTBINDIR)/push_sim: $(TOOLDIR)/push_sim.cpp $(SRCDIR)/current_arbiter.cpp $(SRCDIR)/drivetrain.cpp \
+	$(SRCDIR)/motor_cache.cpp $(SRCDIR)/slew.cpp $(SRCDIR)/flywheel.cpp $(SRCDIR)/velocity.cpp \
+	$(SRCDIR)/latency.cpp $(SRCDIR)/params.cpp $(SRCDIR)/telemetry.cpp $(FIELDSRC)
+$(HOSTBINDIR)/crash_decode: $(TOOLDIR)/crash_decode.cpp $(SRCDIR)/crash_recorder.cpp \
+	$(SRCDIR)/motor_cache.cpp $(SRCDIR)/latency.cpp $(SRCDIR)/telemetry.cpp $(SIMSRC)
+$(HOSTBINDIR)/overload_sim: $(TOOLDIR)/overload_sim.cpp $(SRCDIR)/periodic.cpp $(SRCDIR)/latency.cpp \
+	$(SRCDIR)/profile.cpp $(SRCDIR)/telemetry.cpp $(SIMSRC)
+
+$(HOST_TOOLS):
+	$(VV)mkdir -p $(dir $@)
+	$(call test_output_2,Building host tool $@ ,$(HOSTCXX) $(HOSTCXXFLAGS) $^ $(HOSTLDFLAGS) -o $@,$(OK_STRING))
+
+.PHONY: tools
+tools: $(HOST_TOOLS)
+
+# the robot's per tick hot paths timed on the host, results (one json
+# object per case) go to bin/host/bench.json
+# make bench BENCH_BASELINE=<old bench.json> fails on anything slower
+BENCHOUT=$(HOSTBINDIR)/bench.json
+
+.PHONY: bench
+bench: $(HOSTBINDIR)/bench
+	$(VV)$(HOSTBINDIR)/bench $(BENCHOUT) $(BENCH_BASELINE)
+
+# vision signature tables, regenerated from the vision utility export
+# the generated header is checked in so the robot build never needs this
+VISIONEXPORT=vision/signatures.txt
+
+$(INCDIR)/vision_table.h: $(ROOT)/$(VISIONEXPORT) $(HOSTBINDIR)/vision_sigs
+	$(call test_output_2,Generating $@ ,$(HOSTBINDIR)/vision_sigs $< $@,$(OK_STRING))
+
+.PHONY: vision
+vision: $(INCDIR)/vision_table.h
@@ -0,0 +1,287 @@
+
+// standard libs
+#include <math.h>
+#include <string.h>
+
+// vex api
+#include "vex.h"
+#include "v5_sim.h"
+#include "field_sim.h"
+
+// v5 smart motor, 18:1 output: stall torque and the current limit it hits
+#define STALL_TORQUE_18 2.1     // Nm
+#define CURRENT_LIMIT 2.5       // A
+#define MOTOR_VOLTS 12.0
+
+// the motor's own velocity controller (volts per rpm, per rpm s, per degree)
+#define MOTOR_KP 0.1
+#define MOTOR_KI 1.0
+#define MOTOR_KHOLD 0.05
+
+// heating (celsius per s per amp squared) and cooling time constant (s)
+#define MOTOR_HEAT 0.08
+#define MOTOR_COOL 300.0
+#define AMBIENT 25.0
+
+#define GRAVITY 9.81
+
+// substeps per sim_field_step, the tire model is stiff
+#define SUBSTEPS 4
+
+
+// what the motor firmware keeps between updates
+struct motor_model {
+  double integral;
+  bool holding;
+  double hold_at;
+};
+
+struct field {
+  bool ready;
+  sim_robot_config config;
+  sim_robot_state state;
+  double theta0;
+  double side[2];          // wheel speed, rad/s (left, right)
+  double flywheel;         // rad/s at the motor output
+  double flywheel_inertia; // kg m^2 as the motor sees it
+  double push;             // N against the direction the robot faces
+  double push_speed;       // m/s, how fast the pusher can go
+  motor_model motors[V5_MAX_DEVICE_PORTS];
+};
+
+static thread_local field world;
+
+
+sim_robot_config sim_robot_defaults(void) {
+  sim_robot_config c;
+  c.left[0] = 10;  c.left[1] = 19;
+  c.right[0] = 0;  c.right[1] = 9;
+  c.flywheel = 1;
+  c.imu = 2;
+
+  c.mass = 6.8;
+  c.inertia = 0.25;
+  c.wheel_diameter = 0.1016;
+  c.track_width = 0.305;
+  c.side_inertia = 0.004;
+  c.friction = 0.8;
+  c.stiffness = 600;
+  c.rolling = 0.03;
+  c.drive_cartridge = SIM_CARTRIDGE_18;
+
+  c.flywheel_inertia = 0.0005;
+  c.flywheel_ratio = 5;
+  c.flywheel_radius = 0.0635;
+  c.flywheel_drag = 0.00002;
+  c.flywheel_cartridge = SIM_CARTRIDGE_6;
+  c.disc_mass = 0.065;
+  c.launch_angle = 30;
+  c.launch_efficiency = 0.5;
+  return c;
+}
+
+// the gear set a cartridge free speed comes from
+static V5MotorGearset gearing(double free_rpm) {
+  return free_rpm <= SIM_CARTRIDGE_36 ? kMotorGearSet_36 :
+         free_rpm <= SIM_CARTRIDGE_18 ? kMotorGearSet_18 : kMotorGearSet_06;
+}
+
+void sim_field_setup(const sim_robot_config &config, double x, double y, double theta) {
+  memset(&world, 0, sizeof(world));
+  world.ready = true;
+  world.config = config;
+  world.state.x = x;
+  world.state.y = y;
+  world.state.theta = theta;
+  world.theta0 = theta;
+  world.flywheel_inertia = config.flywheel_inertia * config.flywheel_ratio * config.flywheel_ratio;
+
+  // our motors move with the model, not the first order stand in, and
+  // count like the cartridges in them
+  sim_motor_reset();
+  for (int i = 0; i < 2; i++) {
+    sim_motor_get(config.left[i])->tau = 0;
+    sim_motor_get(config.right[i])->tau = 0;
+    sim_motor_get(config.left[i])->gearing = gearing(config.drive_cartridge);
+    sim_motor_get(config.right[i])->gearing = gearing(config.drive_cartridge);
+  }
+  if (config.flywheel >= 0) {
+    sim_motor_get(config.flywheel)->tau = 0;
+    sim_motor_get(config.flywheel)->gearing = gearing(config.flywheel_cartridge);
+  }
+  sim_imu_set(config.imu, 0);
+}
+
+// output torque of one motor at rpm, and what it draws doing it
+static double motor_torque(int32_t port, double rpm, double free_rpm, double dt) {
+  sim_motor *m = sim_motor_get(port);
+  motor_model *model = &world.motors[port];
+  double stall = STALL_TORQUE_18 * SIM_CARTRIDGE_18 / free_rpm;
+  double volts = 0;
+
+  if (m->voltage_mode) {
+    // straight to the windings, the velocity controller is out of it
+    model->integral = 0;
+    model->holding = false;
+    volts = fmax(-MOTOR_VOLTS, fmin(MOTOR_VOLTS, m->voltage / 1000.0));
+  } else {
+    if (m->target_rpm == 0 && m->brake == kV5MotorBrakeModeCoast) {
+      // coasting is an open circuit
+      model->integral = 0;
+      model->holding = false;
+      m->current = 0;
+      return 0;
+    }
+
+    double error = m->target_rpm - rpm;
+    model->integral = fmax(-MOTOR_VOLTS, fmin(MOTOR_VOLTS, model->integral + MOTOR_KI * error * dt));
+    volts = MOTOR_VOLTS * m->target_rpm / free_rpm + MOTOR_KP * error + model->integral;
+
+    if (m->target_rpm == 0 && m->brake == kV5MotorBrakeModeHold) {
+      if (!model->holding) {
+        model->holding = true;
+        model->hold_at = m->position;
+      }
+      volts += MOTOR_KHOLD * (model->hold_at - m->position);
+    } else {
+      model->holding = false;
+    }
+    volts = fmax(-MOTOR_VOLTS, fmin(MOTOR_VOLTS, volts));
+  }
+
+  // dc motor: the torque-speed line for this voltage, cut at the current
+  // limit (the hardware's, or a lower one the robot code set)
+  double torque = stall * (volts / MOTOR_VOLTS - rpm / free_rpm);
+  double amps = fabs(torque) / stall * CURRENT_LIMIT;
+  double limit = fmax(0, fmin(CURRENT_LIMIT, m->current_limit / 1000.0));
+  if (amps > limit) {
+    torque *= limit / amps;
+    amps = limit;
+  }
+
+  m->current = amps * 1000;
+  m->temperature += (MOTOR_HEAT * amps * amps - (m->temperature - AMBIENT) / MOTOR_COOL) * dt;
+  return torque;
+}
+
+static void step(double dt) {
+  const sim_robot_config &c = world.config;
+  sim_robot_state &s = world.state;
+  double r = c.wheel_diameter / 2;
+  double grip = c.friction * c.mass * GRAVITY / 2;   // per side
+  bool slipping = false;
+
+  // drive sides: motor torque turns the wheels, the tiles push back
+  double force[2];
+  const int32_t *ports[2] = { c.left, c.right };
+  for (int side = 0; side < 2; side++) {
+    double ground = s.v + (side ? 1 : -1) * s.w * c.track_width / 2;
+    double rpm = world.side[side] * 60 / (2 * M_PI);
+
+    double torque = 0;
+    for (int i = 0; i < 2; i++) {
+      torque += motor_torque(ports[side][i], rpm, c.drive_cartridge, dt);
+    }
+
+    // tire force grows with slip until the tiles let go
+    double f = c.stiffness * (world.side[side] * r - ground);
+    if (fabs(f) > grip) {
+      f = copysign(grip, f);
+      slipping = true;
+    }
+    force[side] = f;
+    world.side[side] += (torque - f * r) / c.side_inertia * dt;
+
+    rpm = world.side[side] * 60 / (2 * M_PI);
+    for (int i = 0; i < 2; i++) {
+      sim_motor *m = sim_motor_get(ports[side][i]);
+      m->rpm = rpm;
+      m->position += rpm * 6.0 * dt;
+    }
+  }
+
+  // the body, rolling resistance smoothed through zero
+  double rolling = c.rolling * c.mass * GRAVITY * tanh(s.v / 0.01);
+  double push = world.push != 0 ? world.push * fmax(0, fmin(1, 1 + s.v / world.push_speed)) : 0;
+  s.v += (force[0] + force[1] - rolling - push) / c.mass * dt;
+  s.w += (force[1] - force[0]) * c.track_width / 2 / c.inertia * dt;
+  s.x += s.v * cos(s.theta) * dt;
+  s.y += s.v * sin(s.theta) * dt;
+  s.theta += s.w * dt;
+  if (slipping) {
+    s.slip_time += dt;
+  }
+
+  // flywheel
+  if (c.flywheel >= 0) {
+    double rpm = world.flywheel * 60 / (2 * M_PI);
+    double torque = motor_torque(c.flywheel, rpm, c.flywheel_cartridge, dt);
+    double drag = c.flywheel_drag * c.flywheel_ratio * c.flywheel_ratio * world.flywheel;
+    world.flywheel += (torque - drag) / world.flywheel_inertia * dt;
+
+    sim_motor *m = sim_motor_get(c.flywheel);
+    m->rpm = world.flywheel * 60 / (2 * M_PI);
+    m->position += m->rpm * 6.0 * dt;
+    s.flywheel_rpm = m->rpm;
+  }
+
+  s.time += dt;
+}
+
+void sim_field_step(double dt) {
+  if (!world.ready) {
+    return;
+  }
+
+  for (int i = 0; i < SUBSTEPS; i++) {
+    step(dt / SUBSTEPS);
+  }
+
+  // the imu is clockwise from where it was calibrated
+  sim_imu_set(world.config.imu, -(world.state.theta - world.theta0) * 180 / M_PI);
+}
+
+bool sim_field_launch(void) {
+  const sim_robot_config &c = world.config;
+  sim_robot_state &s = world.state;
+  if (!world.ready || c.flywheel < 0) {
+    return false;
+  }
+
+  // the disc leaves with the flywheel's surface speed (times the
+  // efficiency), and its energy comes out of the flywheel
+  // (k is disc speed per rad/s of the motor)
+  double before = world.flywheel;
+  double k = c.launch_efficiency * c.flywheel_radius * c.flywheel_ratio;
+  world.flywheel = before * sqrt(world.flywheel_inertia / (world.flywheel_inertia + c.disc_mass * k * k));
+
+  sim_launch launch;
+  launch.time = s.time;
+  launch.rpm_before = before * 60 / (2 * M_PI);
+  launch.rpm_after = world.flywheel * 60 / (2 * M_PI);
+  launch.speed = k * fabs(world.flywheel);
+  launch.range = launch.speed * launch.speed * sin(2 * c.launch_angle * M_PI / 180) / GRAVITY;
+
+  if (s.launches < SIM_MAX_LAUNCHES) {
+    s.launch[s.launches] = launch;
+  }
+  s.launches++;
+  return true;
+}
+
+void sim_field_bump(double dv, double dw) {
+  world.state.v += dv;
+  world.state.w += dw;
+}
+
+const sim_robot_state *sim_field_state(void) {
+  return &world.state;
+}
+
+void sim_field_push(double force) {
+  // a robot like ours, its push falls away along its own torque-speed
+  // line as it drives us backwards
+  const sim_robot_config &c = world.config;
+  world.push = force;
+  world.push_speed = c.drive_cartridge / 60 * M_PI * c.wheel_diameter;
+}
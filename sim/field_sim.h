@@ -0,0 +1,102 @@
+
+/*
+ * field_sim.h
+ * host model of the robot on the field: drive, flywheel and launches
+ * NOTE: only built for the host (make tools). the model drives the same
+ * sim_motor entries the jumptable stand ins read, so robot code runs on
+ * it unchanged. motors are dc motors behind the v5's velocity controller,
+ * or straight on a voltage (the torque-speed line of their cartridge,
+ * current limited), the drive is a rigid body on two wheel sides that
+ * slip once the tiles cant take the force, and the flywheel is an
+ * inertia that each launch takes energy out of. all the state is per
+ * thread, so independent matches can run side by side, one per thread
+*/
+
+#ifndef FIELD_SIM_H
+#define FIELD_SIM_H
+
+#include <stdint.h>
+
+// cartridge free speeds (rpm at the output)
+#define SIM_CARTRIDGE_36 100
+#define SIM_CARTRIDGE_18 200
+#define SIM_CARTRIDGE_6 600
+
+// most launches one match keeps a record of
+#define SIM_MAX_LAUNCHES 64
+
+
+struct sim_robot_config {
+  // wiring, sides are 2 motors each
+  int32_t left[2];
+  int32_t right[2];
+  int32_t flywheel;        // -1 for none
+  int32_t imu;
+
+  // drive
+  double mass;             // kg
+  double inertia;          // kg m^2 about the center
+  double wheel_diameter;   // m
+  double track_width;      // m
+  double side_inertia;     // kg m^2, wheels + gearing on one side at the wheel
+  double friction;         // wheel to tile coefficient
+  double stiffness;        // N per m/s of slip, before the wheels break loose
+  double rolling;          // rolling resistance, fraction of the weight
+  double drive_cartridge;  // free rpm
+
+  // flywheel
+  double flywheel_inertia; // kg m^2 of the wheel itself
+  double flywheel_ratio;   // wheel turns per motor turn
+  double flywheel_radius;  // m
+  double flywheel_drag;    // Nm per rad/s, at the wheel
+  double flywheel_cartridge;
+  double disc_mass;        // kg
+  double launch_angle;     // degrees
+  double launch_efficiency;// disc exit speed over flywheel surface speed
+};
+
+struct sim_launch {
+  double time;             // s
+  double rpm_before;       // motor
+  double rpm_after;
+  double speed;            // m/s
+  double range;            // m, flat ground
+};
+
+// what actually happened, for scoring against what the robot thinks
+struct sim_robot_state {
+  double x, y, theta;      // m, m, rad counter clockwise
+  double v, w;             // m/s, rad/s
+  double time;             // s since sim_field_setup
+  double slip_time;        // s either side was sliding
+  double flywheel_rpm;     // at the motor, like the robot sees it
+  uint32_t launches;
+  sim_launch launch[SIM_MAX_LAUNCHES];
+};
+
+
+// a competition robot: 4in wheels, 12in track, 18:1 drive, 6:1 flywheel
+sim_robot_config sim_robot_defaults(void);
+
+// put the robot on the field (also resets the motors it drives)
+void sim_field_setup(const sim_robot_config &config, double x, double y, double theta);
+
+// move the model on by dt (s), 1 ms or less. updates the motors and the
+// imu the robot code reads, does not move the clock
+void sim_field_step(double dt);
+
+// push a disc through the flywheel now, returns false without one
+bool sim_field_launch(void);
+
+// knock the robot (another robot, a game object): add dv m/s and dw rad/s
+// counter clockwise to its motion, the wheels have to catch up
+void sim_field_bump(double dv, double dw);
+
+// another robot the same as this one pushing back on the front with force
+// (N) at a standstill, less the faster it drives us back, from now on (0
+// to take it away)
+void sim_field_push(double force);
+
+const sim_robot_state *sim_field_state(void);
+
+#endif // FIELD_SIM_H
@@ -0,0 +1,536 @@
+
+// standard libs
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// vex api
+#include "vex.h"
+#include "v5_sim.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*    clock                                                                   */
+/*----------------------------------------------------------------------------*/
+
+static thread_local bool time_is_real = false;
+static thread_local uint64_t time_now = 0;
+
+static uint64_t host_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void sim_time_real(bool real) {
+  time_is_real = real;
+}
+
+void sim_time_advance(uint64_t us) {
+  time_now += us;
+}
+
+uint64_t sim_time_now(void) {
+  return time_is_real ? host_us() : time_now;
+}
+
+uint64_t vexSystemHighResTimeGet(void) {
+  return sim_time_now();
+}
+
+uint32_t vexSystemTimeGet(void) {
+  return (uint32_t)(sim_time_now() / 1000);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    usb serial                                                              */
+/*----------------------------------------------------------------------------*/
+
+static int serial_fd = -1;
+static uint32_t serial_capacity = 0;
+static uint32_t serial_rate = 0;
+static uint32_t serial_queued = 0;
+static uint64_t serial_drained_at = 0;
+
+void sim_serial_attach(int fd, uint32_t capacity, uint32_t bytes_per_sec) {
+  serial_fd = fd;
+  serial_capacity = capacity;
+  serial_rate = bytes_per_sec;
+  serial_queued = 0;
+  serial_drained_at = sim_time_now();
+}
+
+// let the modeled cdc buffer empty out at the link rate
+static void serial_drain(void) {
+  uint64_t now = sim_time_now();
+  uint64_t drained = (now - serial_drained_at) * serial_rate / 1000000;
+  if (drained == 0) {
+    return;
+  }
+
+  serial_queued = drained >= serial_queued ? 0 : serial_queued - (uint32_t)drained;
+  serial_drained_at = now;
+}
+
+int32_t vexSerialWriteFree(uint32_t channel) {
+  if (serial_fd < 0) {
+    return 0;
+  }
+  serial_drain();
+  return serial_capacity - serial_queued;
+}
+
+int32_t vexSerialWriteBuffer(uint32_t channel, uint8_t *data, uint32_t data_len) {
+  if (serial_fd < 0) {
+    return 0;
+  }
+
+  // like the real thing, whatever doesnt fit is lost
+  int32_t free = vexSerialWriteFree(channel);
+  if ((int32_t)data_len > free) {
+    data_len = free;
+  }
+
+  uint32_t done = 0;
+  while (done < data_len) {
+    ssize_t n = write(serial_fd, data + done, data_len - done);
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+  }
+
+  serial_queued += done;
+  return done;
+}
+
+int32_t vexSerialWriteChar(uint32_t channel, uint8_t c) {
+  return vexSerialWriteBuffer(channel, &c, 1);
+}
+
+int32_t vexSerialReadChar(uint32_t channel) {
+  // nobody is typing into the sim console
+  return -1;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    motors                                                                  */
+/*----------------------------------------------------------------------------*/
+
+static thread_local sim_motor motors[V5_MAX_DEVICE_PORTS];
+static thread_local bool motors_ready = false;
+
+void sim_motor_reset(void) {
+  for (int i = 0; i < V5_MAX_DEVICE_PORTS; i++) {
+    motors[i] = sim_motor();
+    motors[i].gain = 1.0;
+    motors[i].tau = 0.05;
+    motors[i].temperature = 25;
+    motors[i].current_limit = 2500;
+    motors[i].gearing = kMotorGearSet_18;
+  }
+  motors_ready = true;
+}
+
+sim_motor *sim_motor_get(int32_t port) {
+  if (port < 0 || port >= V5_MAX_DEVICE_PORTS) {
+    return NULL;
+  }
+  if (!motors_ready) {
+    sim_motor_reset();
+  }
+  return &motors[port];
+}
+
+// free speed at the output and raw encoder counts per output rev
+static double free_rpm(const sim_motor *m) {
+  return m->gearing == kMotorGearSet_36 ? 100 : m->gearing == kMotorGearSet_06 ? 600 : 200;
+}
+
+static double counts_per_rev(const sim_motor *m) {
+  return m->gearing == kMotorGearSet_36 ? 1800 : m->gearing == kMotorGearSet_06 ? 300 : 900;
+}
+
+void sim_motor_step(double dt) {
+  if (!motors_ready) {
+    sim_motor_reset();
+  }
+
+  for (int i = 0; i < V5_MAX_DEVICE_PORTS; i++) {
+    sim_motor *m = &motors[i];
+    if (m->tau <= 0) {
+      continue;
+    }
+
+    // on voltage the first order model settles where an unloaded motor would
+    double target = (m->voltage_mode ? m->voltage / 12000.0 * free_rpm(m) : m->target_rpm) * m->gain;
+    m->rpm += (target - m->rpm) * (1.0 - exp(-dt / m->tau));
+    m->position += m->rpm * 6.0 * dt;
+  }
+}
+
+void vexMotorVelocitySet(uint32_t index, int32_t velocity) {
+  sim_motor *m = sim_motor_get(index);
+  if (m != NULL) {
+    m->target_rpm = velocity;
+    m->voltage_mode = false;
+    m->commands++;
+  }
+}
+
+void vexMotorVoltageSet(uint32_t index, int32_t value) {
+  sim_motor *m = sim_motor_get(index);
+  if (m != NULL) {
+    m->voltage = value;
+    m->voltage_mode = true;
+    m->commands++;
+  }
+}
+
+void vexMotorCurrentLimitSet(uint32_t index, int32_t value) {
+  sim_motor *m = sim_motor_get(index);
+  if (m != NULL) {
+    m->current_limit = value;
+  }
+}
+
+int32_t vexMotorCurrentLimitGet(uint32_t index) {
+  sim_motor *m = sim_motor_get(index);
+  return m != NULL ? (int32_t)m->current_limit : 0;
+}
+
+void vexMotorGearingSet(uint32_t index, V5MotorGearset value) {
+  sim_motor *m = sim_motor_get(index);
+  if (m != NULL) {
+    m->gearing = value;
+  }
+}
+
+V5MotorGearset vexMotorGearingGet(uint32_t index) {
+  sim_motor *m = sim_motor_get(index);
+  return m != NULL ? m->gearing : kMotorGearSet_18;
+}
+
+void vexMotorBrakeModeSet(uint32_t index, V5MotorBrakeMode mode) {
+  sim_motor *m = sim_motor_get(index);
+  if (m != NULL) {
+    m->brake = mode;
+  }
+}
+
+// every read goes through here so tools can count device calls
+static sim_motor *motor_read(uint32_t index) {
+  sim_motor *m = sim_motor_get(index);
+  if (m != NULL) {
+    m->reads++;
+  }
+  return m;
+}
+
+double vexMotorActualVelocityGet(uint32_t index) {
+  sim_motor *m = motor_read(index);
+  return m != NULL ? m->rpm : 0;
+}
+
+double vexMotorPositionGet(uint32_t index) {
+  sim_motor *m = motor_read(index);
+  return m != NULL ? m->position : 0;
+}
+
+int32_t vexMotorCurrentGet(uint32_t index) {
+  sim_motor *m = motor_read(index);
+  return m != NULL ? (int32_t)m->current : 0;
+}
+
+int32_t vexMotorVoltageGet(uint32_t index) {
+  sim_motor *m = motor_read(index);
+  if (m == NULL) {
+    return 0;
+  }
+  return (int32_t)(m->voltage_mode ? m->voltage : m->target_rpm / free_rpm(m) * 12000);
+}
+
+double vexMotorTemperatureGet(uint32_t index) {
+  sim_motor *m = motor_read(index);
+  return m != NULL ? m->temperature : 0;
+}
+
+// no torque model, these are only here so robot code links
+double vexMotorTorqueGet(uint32_t index) {
+  motor_read(index);
+  return 0;
+}
+
+double vexMotorEfficiencyGet(uint32_t index) {
+  motor_read(index);
+  return 0;
+}
+
+int32_t vexMotorPositionRawGet(uint32_t index, uint32_t *timestamp) {
+  sim_motor *m = motor_read(index);
+  if (timestamp != NULL) {
+    *timestamp = vexSystemTimeGet();
+  }
+
+  // counts per output rev follow the cartridge, as on the real motor
+  return m != NULL ? (int32_t)floor(m->position * counts_per_rev(m) / 360.0) : 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    imu                                                                     */
+/*----------------------------------------------------------------------------*/
+
+static thread_local double imu_heading[V5_MAX_DEVICE_PORTS];
+
+void sim_imu_set(int32_t port, double heading) {
+  if (port >= 0 && port < V5_MAX_DEVICE_PORTS) {
+    imu_heading[port] = heading;
+  }
+}
+
+double vexImuHeadingGet(uint32_t index) {
+  if (index >= V5_MAX_DEVICE_PORTS) {
+    return 0;
+  }
+
+  // the real imu reports 0..360
+  double h = fmod(imu_heading[index], 360.0);
+  return h < 0 ? h + 360.0 : h;
+}
+
+double vexImuDegreesGet(uint32_t index) {
+  return index < V5_MAX_DEVICE_PORTS ? imu_heading[index] : 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    competition                                                             */
+/*----------------------------------------------------------------------------*/
+
+static thread_local uint32_t competition_status = 0;
+
+void sim_competition_set(uint32_t status) {
+  competition_status = status;
+}
+
+uint32_t vexCompetitionStatus(void) {
+  return competition_status;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    devices                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static thread_local V5_DeviceType device_type[V5_MAX_DEVICE_PORTS];
+
+void sim_device_set(int32_t port, V5_DeviceType type) {
+  if (port >= 0 && port < V5_MAX_DEVICE_PORTS) {
+    device_type[port] = type;
+  }
+}
+
+int32_t vexDeviceGetStatus(V5_DeviceType *buffer) {
+  memcpy(buffer, device_type, sizeof(device_type));
+  return V5_MAX_DEVICE_PORTS;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    vision                                                                  */
+/*----------------------------------------------------------------------------*/
+
+static thread_local sim_vision visions[V5_MAX_DEVICE_PORTS];
+
+sim_vision *sim_vision_get(int32_t port) {
+  return port >= 0 && port < V5_MAX_DEVICE_PORTS ? &visions[port] : NULL;
+}
+
+void vexVisionSignatureSet(uint32_t index, V5_DeviceVisionSignature *pSignature) {
+  if (index >= V5_MAX_DEVICE_PORTS || pSignature->id < 1 || pSignature->id > 7) {
+    return;
+  }
+  visions[index].signature[pSignature->id] = *pSignature;
+  visions[index].signature[pSignature->id].flags |= VISION_SIG_FLAG_STATUS;
+  visions[index].signature_sets++;
+}
+
+bool vexVisionSignatureGet(uint32_t index, uint32_t id, V5_DeviceVisionSignature *pSignature) {
+  if (index >= V5_MAX_DEVICE_PORTS || id < 1 || id > 7) {
+    return false;
+  }
+  *pSignature = visions[index].signature[id];
+  return true;
+}
+
+int32_t vexVisionObjectCountGet(uint32_t index) {
+  return index < V5_MAX_DEVICE_PORTS ? visions[index].object_count : 0;
+}
+
+int32_t vexVisionObjectGet(uint32_t index, uint32_t indexObj, V5_DeviceVisionObject *pObject) {
+  if (index >= V5_MAX_DEVICE_PORTS || indexObj >= (uint32_t)visions[index].object_count) {
+    return 0;
+  }
+  *pObject = visions[index].objects[indexObj];
+  visions[index].object_reads++;
+  return 1;
+}
+
+void vexVisionBrightnessSet(uint32_t index, uint8_t percent) {
+  if (index < V5_MAX_DEVICE_PORTS) {
+    visions[index].brightness = percent;
+  }
+}
+
+uint8_t vexVisionBrightnessGet(uint32_t index) {
+  return index < V5_MAX_DEVICE_PORTS ? visions[index].brightness : 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    display                                                                 */
+/*----------------------------------------------------------------------------*/
+
+// there is no screen on the host, drawing just goes nowhere
+void vexDisplayString(const int32_t nLineNumber, const char *format, ...) {
+}
+
+void vexDisplayErase(void) {
+}
+
+void vexDisplayForegroundColor(uint32_t col) {
+}
+
+void vexDisplayRectFill(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+}
+
+void vexDisplayStringAt(int32_t xpos, int32_t ypos, const char *format, ...) {
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    controller                                                              */
+/*----------------------------------------------------------------------------*/
+
+// the controller drops writes that come closer than this (us)
+#define SIM_CONTROLLER_GAP 50000
+
+static thread_local sim_controller controllers[2] = {
+  { kV5ControllerTethered, {}, 0, 0, 0, {}, 0 },
+  { kV5ControllerOffline, {}, 0, 0, 0, {}, 0 },
+};
+
+sim_controller *sim_controller_get(V5_ControllerId id) {
+  return &controllers[id == kControllerPartner ? 1 : 0];
+}
+
+V5_ControllerStatus vexControllerConnectionStatusGet(V5_ControllerId id) {
+  return sim_controller_get(id)->status;
+}
+
+int32_t vexControllerGet(V5_ControllerId id, V5_ControllerIndex index) {
+  sim_controller *c = sim_controller_get(id);
+  c->reads++;
+  uint32_t slots = sizeof(c->values) / sizeof(c->values[0]);
+  if (c->status == kV5ControllerOffline || (uint32_t)index >= slots) {
+    return 0;
+  }
+  return c->values[index];
+}
+
+bool vexControllerTextSet(V5_ControllerId id, uint32_t line, uint32_t col, const char *str) {
+  sim_controller *c = sim_controller_get(id);
+  if (c->status == kV5ControllerOffline || line > 3 || (line < 3 && (col < 1 || col > 19))) {
+    return false;
+  }
+
+  uint64_t now = sim_time_now();
+  if (c->writes + c->rejected > 0 && now - c->last_write < SIM_CONTROLLER_GAP) {
+    c->rejected++;
+    return false;
+  }
+  c->last_write = now;
+  c->writes++;
+
+  // a rumble pattern just replaces the line
+  if (line == 3) {
+    snprintf(c->text[3], sizeof(c->text[3]), "%s", str);
+    return true;
+  }
+
+  for (uint32_t i = col - 1; *str != '\0' && i < 19; i++, str++) {
+    if (c->text[line][i] == '\0') {
+      memset(c->text[line] + i, ' ', 19 - i);
+    }
+    c->text[line][i] = *str;
+  }
+  return true;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    touch                                                                   */
+/*----------------------------------------------------------------------------*/
+
+static thread_local V5_TouchStatus touch;
+
+void sim_touch(int16_t x, int16_t y) {
+  touch.lastEvent = kTouchEventPress;
+  touch.lastXpos = x;
+  touch.lastYpos = y;
+  touch.pressCount++;
+  touch.releaseCount++;
+}
+
+bool vexTouchDataGet(V5_TouchStatus *status) {
+  *status = touch;
+  return true;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    sd card                                                                 */
+/*----------------------------------------------------------------------------*/
+
+static char sd_root[256] = ".";
+
+void sim_sd_root(const char *path) {
+  snprintf(sd_root, sizeof(sd_root), "%s", path);
+}
+
+static FIL *sd_open(const char *filename, const char *mode) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", sd_root, filename);
+  return (FIL *)fopen(path, mode);
+}
+
+FIL *vexFileOpen(const char *filename, const char *mode) {
+  return sd_open(filename, "rb");
+}
+
+FIL *vexFileOpenWrite(const char *filename) {
+  return sd_open(filename, "ab");
+}
+
+FIL *vexFileOpenCreate(const char *filename) {
+  return sd_open(filename, "wb");
+}
+
+void vexFileClose(FIL *fdp) {
+  if (fdp != NULL) {
+    fclose((FILE *)fdp);
+  }
+}
+
+int32_t vexFileRead(char *buf, uint32_t size, uint32_t nItems, FIL *fdp) {
+  return fread(buf, size, nItems, (FILE *)fdp);
+}
+
+int32_t vexFileWrite(char *buf, uint32_t size, uint32_t nItems, FIL *fdp) {
+  return fwrite(buf, size, nItems, (FILE *)fdp);
+}
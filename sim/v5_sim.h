@@ -0,0 +1,105 @@
+
+/*
+ * v5_sim.h
+ * host side stand ins for the v5 jumptable
+ * NOTE: only built for the host (make tools), never linked into the robot.
+ * the clock and every device are per thread, so a tool can run separate
+ * robots on separate threads (the usb serial and the sd card are shared)
+*/
+
+#ifndef V5_SIM_H
+#define V5_SIM_H
+
+#include <stdint.h>
+
+#include "v5_apitypes.h"
+
+// clock
+// by default time only moves when sim_time_advance is called, so runs are
+// repeatable and as fast as the host can go
+void sim_time_real(bool real);          // follow the host monotonic clock instead
+void sim_time_advance(uint64_t us);
+uint64_t sim_time_now(void);
+
+// usb serial
+// bytes written by the robot code go to fd, the cdc buffer is modeled as
+// capacity bytes that drain at bytes_per_sec (in sim time)
+void sim_serial_attach(int fd, uint32_t capacity, uint32_t bytes_per_sec);
+
+// motors
+// each smart port has a first order velocity model, the robot model (or the
+// tool) reads the actual velocity and can scale it to model a weak side
+struct sim_motor {
+  double target_rpm;  // what the robot code last asked for
+  double voltage;     // mV, if the robot code asked for a voltage instead
+  bool voltage_mode;
+  double rpm;         // what the motor is actually doing
+  double position;    // degrees
+  double gain;        // actual/target at steady state (1.0 = perfect)
+  double tau;         // time constant in seconds
+  int32_t brake;      // V5MotorBrakeMode
+  uint32_t commands;  // how many velocity commands have arrived
+  double current;     // mA, set by the robot model (0 if nothing models it)
+  double current_limit; // mA, what the robot code last set (the robot model keeps to it)
+  double temperature; // celsius
+  uint32_t reads;     // how many readings the robot code took
+  V5MotorGearset gearing; // cartridge, sets the raw counts per rev (18:1 until set)
+};
+
+sim_motor *sim_motor_get(int32_t port);
+void sim_motor_reset(void);
+
+// advance the motor models (does not move the clock)
+void sim_motor_step(double dt);
+
+// imu
+// the robot model writes the true heading, the robot code reads it back
+void sim_imu_set(int32_t port, double heading);
+
+// competition
+// V5_COMP_BIT_* as the field would set them (0 is driver with no field)
+void sim_competition_set(uint32_t status);
+
+// devices
+// what vexDeviceGetStatus reports on each port (nothing until set)
+void sim_device_set(int32_t port, V5_DeviceType type);
+
+// vision
+// signatures the robot code has sent, as the sensor would read them back,
+// and the objects the model puts in front of it
+struct sim_vision {
+  V5_DeviceVisionSignature signature[8];  // by id, 1..7
+  uint8_t brightness;
+  uint32_t signature_sets;                // how many signatures were sent
+  V5_DeviceVisionObject objects[16];
+  int32_t object_count;
+  uint32_t object_reads;                  // vexVisionObjectGet calls
+};
+
+sim_vision *sim_vision_get(int32_t port);
+
+// controller
+// the text the controller shows, taking writes no closer than the real
+// one does (line 3 is where a rumble pattern goes), and the sticks and
+// buttons the tool sets
+struct sim_controller {
+  V5_ControllerStatus status;   // tethered unless set
+  char text[4][20];
+  uint32_t writes;
+  uint32_t rejected;            // too soon after the last one
+  uint64_t last_write;          // us
+  int32_t values[32];           // what vexControllerGet reads, by V5_ControllerIndex
+  uint32_t reads;               // vexControllerGet calls
+};
+
+sim_controller *sim_controller_get(V5_ControllerId id);
+
+// touch screen
+// a press (and release) at x, y
+void sim_touch(int16_t x, int16_t y);
+
+// sd card
+// files live under this host directory (default is the working directory)
+void sim_sd_root(const char *path);
+
+#endif // V5_SIM_H
@@ -0,0 +1,74 @@
+
+// standard libs
+#include <stdio.h>
+
+// vex api
+#include "vex.h"
+#include "v5_vcs.h"
+#include "v5_sim.h"
+
+// host side stand ins for the few vex:: classes the robot modules use
+// (main.cpp itself never builds for the host)
+
+
+/*----------------------------------------------------------------------------*/
+/*    brain::sdcard                                                           */
+/*----------------------------------------------------------------------------*/
+
+vex::brain::sdcard::sdcard() {
+}
+
+vex::brain::sdcard::~sdcard() {
+}
+
+bool vex::brain::sdcard::isInserted() {
+  return true;
+}
+
+int32_t vex::brain::sdcard::loadfile(const char *name, uint8_t *buffer, int32_t len) {
+  FIL *file = vexFileOpen(name, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  int32_t got = vexFileRead((char *)buffer, 1, len, file);
+  vexFileClose(file);
+  return got;
+}
+
+int32_t vex::brain::sdcard::savefile(const char *name, uint8_t *buffer, int32_t len) {
+  FIL *file = vexFileOpenCreate(name);
+  if (file == NULL) {
+    return 0;
+  }
+  int32_t put = vexFileWrite((char *)buffer, 1, len, file);
+  vexFileClose(file);
+  return put;
+}
+
+int32_t vex::brain::sdcard::appendfile(const char *name, uint8_t *buffer, int32_t len) {
+  FIL *file = vexFileOpenWrite(name);
+  if (file == NULL) {
+    return 0;
+  }
+  int32_t put = vexFileWrite((char *)buffer, 1, len, file);
+  vexFileClose(file);
+  return put;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    this_thread                                                             */
+/*----------------------------------------------------------------------------*/
+
+// there is only ever the one task on the host, so sleeping moves the clock
+// up to when it would wake (or spins until then, on the real clock)
+void vex::this_thread::sleep_until(uint32_t time) {
+  uint64_t wake = (uint64_t)time * 1000;
+  while (sim_time_now() < wake) {
+    sim_time_advance(wake - sim_time_now());
+  }
+}
+
+// and nothing else is waiting for the cpu
+void vex::this_thread::yield(void) {
+}
@@ -0,0 +1,174 @@
+
+// standard libs
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "auton.h"
+
+// selector layout, 4 buttons to a row
+#define BUTTON_COLUMNS 4
+#define BUTTON_WIDTH 107
+#define BUTTON_HEIGHT 60
+#define BUTTON_GAP 10
+#define BUTTON_TOP 50
+
+
+// trapezoid from 0 to 0 over a distance, one speed per tick
+template<class F>
+static void trapezoid(double distance, double max_speed, double accel, double dt, F emit) {
+  double done = 0, speed = 0;
+
+  while (distance - done > 1e-6) {
+    double left = distance - done;
+
+    // as fast as we can get to and still stop in time, but never crawl
+    speed = fmin(fmin(max_speed, speed + accel * dt), sqrt(2 * accel * left));
+    speed = fmax(speed, accel * dt);
+    if (speed * dt > left) {
+      speed = left / dt;
+    }
+
+    done += speed * dt;
+    emit(speed);
+  }
+}
+
+static double rpm_to_mps(double rpm) {
+  return rpm / 60.0 * M_PI * DRIVE_WHEEL_DIAMETER;
+}
+
+
+auton_plan::auton_plan(void) {
+  _count = 0;
+  _routine = NULL;
+  _max_rpm = 0;
+  _truncated = false;
+}
+
+void auton_plan::add(double forward, double heading) {
+  if (_count >= AUTON_MAX_TICKS) {
+    _truncated = true;
+    return;
+  }
+  _ticks[_count].forward = forward;
+  _ticks[_count].heading = heading;
+  _count++;
+}
+
+void auton_plan::prepare(const auton_routine *routine, double max_rpm) {
+  _count = 0;
+  _routine = routine;
+  _max_rpm = max_rpm;
+  _truncated = false;
+
+  // no speed to drive at (the drivetrain_speed parameter set to 0), so
+  // nothing to play back, and every step below would divide by it
+  if (!(max_rpm > 0)) {
+    return;
+  }
+
+  double dt = DRIVE_PERIOD / 1000.0;
+  double max_speed = rpm_to_mps(max_rpm);
+  double heading = 0;
+
+  for (uint32_t i = 0; i < routine->count; i++) {
+    const auton_step &step = routine->steps[i];
+    double sign = step.value < 0 ? -1 : 1;
+
+    switch (step.type) {
+      case AUTON_DRIVE:
+        trapezoid(fabs(step.value), max_speed, AUTON_ACCEL, dt, [&](double speed) {
+          add(sign * speed / max_speed * max_rpm, heading);
+        });
+        break;
+
+      case AUTON_DRIVE_TIME: {
+        // full speed for the time, ramped at both ends (a negative time is none)
+        uint32_t ticks = (uint32_t)lround(fmax(0, step.value) / dt);
+        for (uint32_t k = 1; k <= ticks; k++) {
+          double speed = fmin(max_speed, AUTON_ACCEL * fmin(k, ticks - k + 1) * dt);
+          add(speed / max_speed * max_rpm, heading);
+        }
+        break;
+      }
+
+      case AUTON_TURN:
+        trapezoid(fabs(step.value), AUTON_TURN_RATE, AUTON_TURN_ACCEL, dt, [&](double rate) {
+          heading += sign * rate * dt;
+          add(0, heading);
+        });
+
+        // let heading hold catch up before the next step
+        for (uint32_t k = 0; k < AUTON_SETTLE / DRIVE_PERIOD; k++) {
+          add(0, heading);
+        }
+        break;
+
+      case AUTON_WAIT: {
+        uint32_t ticks = (uint32_t)lround(fmax(0, step.value) / dt);
+        for (uint32_t k = 0; k < ticks; k++) {
+          add(0, heading);
+        }
+        break;
+      }
+    }
+  }
+
+  // and stop
+  add(0, heading);
+}
+
+
+auton_selector::auton_selector(const auton_routine *routines, uint32_t count) {
+  _routines = routines;
+  _count = count < AUTON_MAX_ROUTINES ? count : AUTON_MAX_ROUTINES;
+  _presses = -1;
+}
+
+int32_t auton_selector::poll(void) {
+  V5_TouchStatus status;
+  if (!vexTouchDataGet(&status)) {
+    return -1;
+  }
+
+  // first look just catches up with presses from before we started
+  bool fresh = _presses >= 0 && status.pressCount != _presses;
+  _presses = status.pressCount;
+  if (!fresh) {
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < _count; i++) {
+    int32_t x = BUTTON_GAP + (i % BUTTON_COLUMNS) * (BUTTON_WIDTH + BUTTON_GAP);
+    int32_t y = BUTTON_TOP + (i / BUTTON_COLUMNS) * (BUTTON_HEIGHT + BUTTON_GAP);
+    if (status.lastXpos >= x && status.lastXpos < x + BUTTON_WIDTH
+        && status.lastYpos >= y && status.lastYpos < y + BUTTON_HEIGHT) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void auton_selector::draw(int32_t selected, const auton_plan &plan) {
+  vexDisplayErase();
+
+  vexDisplayForegroundColor(ClrWhite);
+  if (plan.routine() != NULL) {
+    vexDisplayString(1, "auton: %s  %.1f s%s", plan.routine()->name,
+                     plan.count() * DRIVE_PERIOD / 1000.0, plan.truncated() ? " (cut short)" : "");
+  } else {
+    vexDisplayString(1, "auton: none");
+  }
+
+  for (uint32_t i = 0; i < _count; i++) {
+    int32_t x = BUTTON_GAP + (i % BUTTON_COLUMNS) * (BUTTON_WIDTH + BUTTON_GAP);
+    int32_t y = BUTTON_TOP + (i / BUTTON_COLUMNS) * (BUTTON_HEIGHT + BUTTON_GAP);
+
+    vexDisplayForegroundColor((int32_t)i == selected ? ClrGreen : ClrDarkGray);
+    vexDisplayRectFill(x, y, x + BUTTON_WIDTH, y + BUTTON_HEIGHT);
+    vexDisplayForegroundColor(ClrWhite);
+    vexDisplayStringAt(x + 6, y + BUTTON_HEIGHT / 2 + 6, "%s", _routines[i].name);
+  }
+}
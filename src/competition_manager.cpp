@@ -0,0 +1,93 @@
+
+// vex api and macros
+#include "vex.h"
+#include "competition_manager.h"
+
+
+const char *comp_state_name(comp_state state) {
+  switch (state) {
+    case COMP_AUTON: return "auton";
+    case COMP_DRIVER: return "driver";
+    default: return "disabled";
+  }
+}
+
+
+competition_manager::competition_manager(void) {
+  for (int i = 0; i < COMP_STATES; i++) {
+    _modes[i] = { NULL, NULL, NULL, NULL };
+  }
+  _state = COMP_DISABLED;
+  _ready = false;
+  _halted = false;
+  _ticks = 0;
+  _transitions = 0;
+  latency_reset(&_response);
+}
+
+void competition_manager::on(comp_state state, const comp_mode &mode) {
+  _modes[state] = mode;
+}
+
+comp_state competition_manager::decode(uint32_t status) {
+  if (status & V5_COMP_BIT_EBL) {
+    return COMP_DISABLED;
+  }
+  return (status & V5_COMP_BIT_MODE) ? COMP_AUTON : COMP_DRIVER;
+}
+
+void competition_manager::halt(void) {
+  if (_halted) {
+    return;
+  }
+  _halted = true;
+
+  if (_modes[_state].stop) _modes[_state].stop();
+  if (_state != COMP_DISABLED) {
+    _transitions++;
+  }
+  _state = COMP_DISABLED;
+  _ticks = 0;
+}
+
+void competition_manager::step(void) {
+  if (_halted) {
+    return;
+  }
+
+  // without a field or switch we are enabled in driver from the start,
+  // so make sure every mode got prepared at least once
+  if (!_ready) {
+    for (int i = 0; i < COMP_STATES; i++) {
+      if (_modes[i].prepare) _modes[i].prepare();
+    }
+    _ready = true;
+  }
+
+  comp_state next = decode(vexCompetitionStatus());
+
+  if (next != _state) {
+    uint64_t start = vexSystemHighResTimeGet();
+
+    if (_modes[_state].stop) _modes[_state].stop();
+    _state = next;
+    _ticks = 0;
+    _transitions++;
+
+    if (_modes[_state].start) _modes[_state].start();
+    if (_modes[_state].tick) _modes[_state].tick();
+    _ticks++;
+
+    latency_record(&_response, (uint32_t)(vexSystemHighResTimeGet() - start));
+    return;
+  }
+
+  if (_state == COMP_DISABLED) {
+    for (int i = 0; i < COMP_STATES; i++) {
+      if (_modes[i].prepare) _modes[i].prepare();
+    }
+  }
+
+  if (_modes[_state].tick) _modes[_state].tick();
+  _ticks++;
+}
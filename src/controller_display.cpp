@@ -0,0 +1,163 @@
+
+// standard libs
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+// vex api and macros
+#include "vex.h"
+#include "controller_display.h"
+
+// nothing prints this, so a row set to it always differs from the screen
+#define UNKNOWN '\0'
+
+
+controller_display::controller_display(V5_ControllerId id) {
+  _id = id;
+  memset(_want, ' ', sizeof(_want));
+  memset(_sent, UNKNOWN, sizeof(_sent));
+  memset(_priority, 0, sizeof(_priority));
+  memset(_waiting, 0, sizeof(_waiting));
+  _rumble[0] = '\0';
+  _connected = false;
+  _written = false;
+  _last_write = 0;
+  _prints = 0;
+  _writes = 0;
+  _rejected = 0;
+}
+
+void controller_display::priority(int32_t row, uint8_t priority) {
+  if (row >= 0 && row < CONTROLLER_ROWS) {
+    _priority[row] = priority;
+  }
+}
+
+void controller_display::print(int32_t row, const char *format, ...) {
+  if (row < 0 || row >= CONTROLLER_ROWS) {
+    return;
+  }
+
+  char text[CONTROLLER_COLS + 1];
+  va_list args;
+  va_start(args, format);
+  int32_t len = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+
+  if (len < 0) {
+    len = 0;
+  }
+  if (len > CONTROLLER_COLS) {
+    len = CONTROLLER_COLS;
+  }
+  memset(text + len, ' ', CONTROLLER_COLS - len);
+
+  if (memcmp(_want[row], text, CONTROLLER_COLS) != 0) {
+    memcpy(_want[row], text, CONTROLLER_COLS);
+    _prints++;
+  }
+}
+
+void controller_display::rumble(const char *pattern) {
+  snprintf(_rumble, sizeof(_rumble), "%s", pattern);
+}
+
+bool controller_display::changed(int32_t row, int32_t *first, int32_t *last) const {
+  int32_t a = 0, b = CONTROLLER_COLS - 1;
+  while (a < CONTROLLER_COLS && _want[row][a] == _sent[row][a]) a++;
+  if (a == CONTROLLER_COLS) {
+    return false;
+  }
+  while (_want[row][b] == _sent[row][b]) b--;
+
+  *first = a;
+  *last = b;
+  return true;
+}
+
+bool controller_display::dirty(void) const {
+  int32_t first, last;
+  for (int32_t row = 0; row < CONTROLLER_ROWS; row++) {
+    if (changed(row, &first, &last)) {
+      return true;
+    }
+  }
+  return _rumble[0] != '\0';
+}
+
+bool controller_display::service(uint32_t now) {
+  // whatever was on the screen is gone once the link drops
+  bool connected = vexControllerConnectionStatusGet(_id) != kV5ControllerOffline;
+  if (!connected) {
+    _connected = false;
+    return false;
+  }
+  if (!_connected) {
+    _connected = true;
+    memset(_sent, UNKNOWN, sizeof(_sent));
+  }
+
+  if (_written && now - _last_write < CONTROLLER_TEXT_PERIOD) {
+    return false;
+  }
+
+  // a rumble is there to be felt now, it goes before any text
+  if (_rumble[0] != '\0') {
+    _written = true;
+    _last_write = now;
+    if (!vexControllerTextSet(_id, CONTROLLER_ROWS, 0, _rumble)) {
+      _rejected++;
+      return false;
+    }
+    _rumble[0] = '\0';
+    _writes++;
+    return true;
+  }
+
+  // highest priority changed row, plus a point for every write it missed
+  int32_t best = -1, first = 0, last = 0;
+  uint32_t best_score = 0;
+  for (int32_t row = 0; row < CONTROLLER_ROWS; row++) {
+    int32_t a, b;
+    if (!changed(row, &a, &b)) {
+      _waiting[row] = 0;
+      continue;
+    }
+
+    uint32_t score = _priority[row] + _waiting[row];
+    if (best < 0 || score > best_score) {
+      best = row;
+      best_score = score;
+      first = a;
+      last = b;
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+
+  // just the changed span, one write covers everything that changed in
+  // the row since the last one
+  char text[CONTROLLER_COLS + 1];
+  int32_t len = last - first + 1;
+  memcpy(text, &_want[best][first], len);
+  text[len] = '\0';
+
+  // lines count from 0 but columns from 1
+  _written = true;
+  _last_write = now;
+  if (!vexControllerTextSet(_id, best, first + 1, text)) {
+    _rejected++;
+    return false;
+  }
+
+  memcpy(&_sent[best][first], text, len);
+  _writes++;
+  for (int32_t row = 0; row < CONTROLLER_ROWS; row++) {
+    if (row != best && changed(row, &first, &last)) {
+      _waiting[row]++;
+    }
+  }
+  _waiting[best] = 0;
+  return true;
+}
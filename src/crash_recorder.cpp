@@ -0,0 +1,176 @@
+
+// standard libs
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <exception>
+
+// vex api and macros
+#include "vex.h"
+#include "latency.h"
+#include "crash_recorder.h"
+
+
+crash_recorder::crash_recorder(const motor_cache *motors) {
+  _motors = motors;
+  _next = 0;
+  _count = 0;
+  memset(_ring, 0, sizeof(_ring));
+  memset(_copy, 0, sizeof(_copy));
+}
+
+void crash_recorder::add(const crash_record &record) {
+  crash_record &slot = _ring[_next];
+  slot = record;
+
+  uint32_t n = _motors->count() < CRASH_MOTORS ? _motors->count() : CRASH_MOTORS;
+  for (uint32_t i = 0; i < CRASH_MOTORS; i++) {
+    int32_t mA = i < n ? _motors->currents()[i] : 0;
+    double c = i < n ? _motors->temperatures()[i] : 0;
+    slot.current[i] = (int16_t)(mA < INT16_MAX ? mA : INT16_MAX);
+    slot.temperature[i] = (uint8_t)(c <= 0 ? 0 : c < 255 ? c : 255);
+  }
+
+  _next = _next + 1 < CRASH_RING_TICKS ? _next + 1 : 0;
+  if (_count < CRASH_RING_TICKS) {
+    _count++;
+  }
+}
+
+// the header and where every task is right now, what goes in front of
+// count records
+static void write_head(FIL *file, const motor_cache *motors, crash_reason reason, uint32_t count) {
+  int32_t task_count = latency_task_count();
+
+  crash_header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = CRASH_MAGIC;
+  header.version = CRASH_VERSION;
+  header.reason = reason;
+  header.motors = motors->count() < CRASH_MOTORS ? motors->count() : CRASH_MOTORS;
+  header.tasks = task_count;
+  header.time = vexSystemTimeGet();
+  header.records = count;
+  header.record_size = sizeof(crash_record);
+  for (uint32_t i = 0; i < header.motors; i++) {
+    header.ports[i] = motors->ports()[i];
+  }
+  vexFileWrite((char *)&header, sizeof(header), 1, file);
+
+  // next_us is when the task's next tick is due, so one period before
+  // that is when the last one started
+  uint64_t now = vexSystemHighResTimeGet();
+  for (int32_t i = 0; i < task_count; i++) {
+    const latency_task *task = latency_task_at(i);
+    crash_task entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.name, task->name, CRASH_TASK_NAME - 1);
+    entry.period_us = task->period_us;
+    uint64_t last = task->next_us > task->period_us ? task->next_us - task->period_us : 0;
+    entry.since_us = task->next_us != 0 && now > last ? (uint32_t)(now - last) : 0;
+    entry.run_p99 = latency_percentile(&task->run, 99);
+    entry.run_max = task->run.max.load(std::memory_order_relaxed);
+    entry.late_max = task->late.max.load(std::memory_order_relaxed);
+    vexFileWrite((char *)&entry, sizeof(entry), 1, file);
+  }
+}
+
+int32_t crash_recorder::dump(const char *filename, crash_reason reason) const {
+  FIL *file = vexFileOpenCreate(filename);
+  if (file == NULL) {
+    return -1;
+  }
+
+  // where the ring is right now (nothing else runs until we are done)
+  uint32_t count = _count;
+  uint32_t next = _next;
+  write_head(file, _motors, reason, count);
+
+  // oldest first, that is the slot after the newest once the ring is full
+  uint32_t first = count < CRASH_RING_TICKS ? 0 : next;
+  uint32_t tail = CRASH_RING_TICKS - first < count ? CRASH_RING_TICKS - first : count;
+  vexFileWrite((char *)&_ring[first], sizeof(crash_record), tail, file);
+  vexFileWrite((char *)&_ring[0], sizeof(crash_record), count - tail, file);
+
+  vexFileClose(file);
+  return count;
+}
+
+int32_t crash_recorder::checkpoint(const char *filename, void (*pause)(void)) {
+  // the ring as it is now, oldest first, before anything gets to run
+  uint32_t count = _count;
+  uint32_t first = count < CRASH_RING_TICKS ? 0 : _next;
+  uint32_t tail = CRASH_RING_TICKS - first < count ? CRASH_RING_TICKS - first : count;
+  memcpy(&_copy[0], &_ring[first], tail * sizeof(crash_record));
+  memcpy(&_copy[tail], &_ring[0], (count - tail) * sizeof(crash_record));
+
+  FIL *file = vexFileOpenCreate(filename);
+  if (file == NULL) {
+    return -1;
+  }
+  write_head(file, _motors, CRASH_CHECKPOINT, count);
+
+  // the control task keeps adding to the ring in the pauses, the copy
+  // stays put
+  for (uint32_t done = 0; done < count; done += CRASH_WRITE_CHUNK) {
+    pause();
+    uint32_t n = count - done < CRASH_WRITE_CHUNK ? count - done : CRASH_WRITE_CHUNK;
+    vexFileWrite((char *)&_copy[done], sizeof(crash_record), n, file);
+  }
+
+  vexFileClose(file);
+  return count;
+}
+
+
+// keeping the last run's dump
+// done at startup, before this run can checkpoint over it
+int32_t crash_keep(const char *from, const char *to) {
+  FIL *in = vexFileOpen(from, "r");
+  if (in == NULL) {
+    return -1;
+  }
+  FIL *out = vexFileOpenCreate(to);
+  if (out == NULL) {
+    vexFileClose(in);
+    return -1;
+  }
+
+  char chunk[512];
+  int32_t copied = 0;
+  int32_t got;
+  while ((got = vexFileRead(chunk, 1, sizeof(chunk), in)) > 0) {
+    copied += vexFileWrite(chunk, 1, got, out);
+  }
+
+  vexFileClose(out);
+  vexFileClose(in);
+  return copied;
+}
+
+
+// abort and terminate hooks
+// these run on whichever task went down, so all they have is the recorder
+static const crash_recorder *crash_target = NULL;
+static const char *crash_file = NULL;
+
+static void on_abort(int sig) {
+  // once, even if the dump itself aborts
+  signal(SIGABRT, SIG_DFL);
+  crash_target->dump(crash_file, CRASH_ABORT);
+}
+
+static void on_terminate(void) {
+  // abort() below shouldnt dump over this one
+  signal(SIGABRT, SIG_DFL);
+  crash_target->dump(crash_file, CRASH_TERMINATE);
+  abort();
+}
+
+void crash_install(const crash_recorder *recorder, const char *filename) {
+  crash_target = recorder;
+  crash_file = filename;
+  signal(SIGABRT, on_abort);
+  std::set_terminate(on_terminate);
+}
@@ -0,0 +1,134 @@
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "current_arbiter.h"
+
+
+current_arbiter::current_arbiter(const arbiter_group *groups, uint32_t count, int32_t budget) {
+  _count = count < ARBITER_MAX_GROUPS ? count : ARBITER_MAX_GROUPS;
+  _budget = budget;
+  for (uint32_t g = 0; g < ARBITER_MAX_GROUPS; g++) {
+    _groups[g] = g < _count ? groups[g] : arbiter_group{ "", NULL, 0, 0 };
+    _sent[g] = -1;
+    _limit[g].store(MOTOR_STALL_CURRENT, std::memory_order_relaxed);
+    _demand[g].store(0, std::memory_order_relaxed);
+    _drawn[g].store(0, std::memory_order_relaxed);
+  }
+  _sequence.store(0, std::memory_order_relaxed);
+
+  // by priority, groups with the same one in the order they were given
+  for (uint32_t i = 0; i < _count; i++) {
+    uint32_t j = i;
+    for (; j > 0 && _groups[_order[j - 1]].priority > _groups[i].priority; j--) {
+      _order[j] = _order[j - 1];
+    }
+    _order[j] = i;
+  }
+}
+
+void current_arbiter::update(const motor_cache &motors) {
+  int32_t level[ARBITER_TIERS][ARBITER_MAX_GROUPS];
+  int32_t grant[ARBITER_MAX_GROUPS];
+  int32_t drawn[ARBITER_MAX_GROUPS];
+
+  // everyone keeps the floor, unless the budget cant even cover that
+  uint32_t motor_count = 0;
+  for (uint32_t g = 0; g < _count; g++) {
+    motor_count += _groups[g].count;
+  }
+  int32_t base = motor_count > 0 ? _budget / (int32_t)motor_count : 0;
+  base = base < ARBITER_FLOOR ? base : ARBITER_FLOOR;
+  int32_t left = _budget - base * (int32_t)motor_count;
+
+  // what each group asks for, in tiers that are served one after the
+  // other: a step over what it draws now (more when it is drawing all its
+  // limit lets it, it is being held back), then room over that. every
+  // level is a whole number of steps, so a group that isnt held back
+  // always has a step to spare under its limit
+  for (uint32_t g = 0; g < _count; g++) {
+    const arbiter_group &group = _groups[g];
+    drawn[g] = 0;
+    for (uint32_t i = 0; i < group.count; i++) {
+      int32_t mA = motors.current(group.ports[i]);
+      drawn[g] = mA > drawn[g] ? mA : drawn[g];
+    }
+
+    int32_t limit = _sent[g] >= 0 ? _sent[g] : MOTOR_STALL_CURRENT;
+    bool held = drawn[g] > limit - ARBITER_STEP / 2;
+    int32_t need = held ? (int32_t)(limit * ARBITER_GROWTH) : drawn[g] + ARBITER_STEP;
+    level[0][g] = need;
+    level[1][g] = need + ARBITER_HEADROOM;
+    for (uint32_t t = 0; t < ARBITER_TIERS; t++) {
+      int32_t mA = (level[t][g] + ARBITER_STEP - 1) / ARBITER_STEP * ARBITER_STEP;
+      mA = mA < MOTOR_STALL_CURRENT ? mA : MOTOR_STALL_CURRENT;
+      level[t][g] = mA > base ? mA : base;
+    }
+    grant[g] = base;
+  }
+
+  // each tier in priority order
+  for (uint32_t t = 0; t < ARBITER_TIERS; t++) {
+    for (uint32_t i = 0; i < _count; i++) {
+      uint32_t g = _order[i];
+      int32_t n = _groups[g].count;
+      if (n == 0 || level[t][g] <= grant[g]) {
+        continue;
+      }
+      int32_t extra = level[t][g] - grant[g];
+      extra = extra < left / n ? extra : left / n;
+      grant[g] += extra;
+      left -= extra * n;
+    }
+  }
+
+  // anything left is spread evenly, the groups with the least room to take
+  // it go first so what they cant use goes on to the rest
+  uint32_t by_room[ARBITER_MAX_GROUPS];
+  for (uint32_t i = 0; i < _count; i++) {
+    uint32_t g = _order[i];
+    uint32_t j = i;
+    for (; j > 0 && grant[by_room[j - 1]] < grant[g]; j--) {
+      by_room[j] = by_room[j - 1];
+    }
+    by_room[j] = g;
+  }
+  int32_t sharing = motor_count;
+  for (uint32_t i = 0; i < _count && sharing > 0; i++) {
+    uint32_t g = by_room[i];
+    int32_t n = _groups[g].count;
+    int32_t extra = MOTOR_STALL_CURRENT - grant[g];
+    extra = extra < left / sharing ? extra : left / sharing;
+    grant[g] += extra;
+    left -= extra * n;
+    sharing -= n;
+  }
+
+  // only motors whose limit moved hear about it
+  for (uint32_t g = 0; g < _count; g++) {
+    int32_t limit = grant[g] - grant[g] % ARBITER_STEP;
+    if (limit != _sent[g]) {
+      for (uint32_t i = 0; i < _groups[g].count; i++) {
+        vexMotorCurrentLimitSet(_groups[g].ports[i], limit);
+      }
+      _sent[g] = limit;
+    }
+
+    _limit[g].store(limit, std::memory_order_relaxed);
+    _demand[g].store(level[ARBITER_TIERS - 1][g], std::memory_order_relaxed);
+    _drawn[g].store(drawn[g], std::memory_order_relaxed);
+  }
+  _sequence.fetch_add(1, std::memory_order_release);
+}
+
+int32_t current_arbiter::limit(uint32_t group) const {
+  return group < _count ? _limit[group].load(std::memory_order_relaxed) : 0;
+}
+
+int32_t current_arbiter::demand(uint32_t group) const {
+  return group < _count ? _demand[group].load(std::memory_order_relaxed) : 0;
+}
+
+int32_t current_arbiter::drawn(uint32_t group) const {
+  return group < _count ? _drawn[group].load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,131 @@
+
+// standard libs
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "drivetrain.h"
+
+// NOTE: vex tasks are cooperative, nothing else runs between two jumptable
+// calls unless we yield, so issuing every motor command back to back with
+// no waits in between is the critical section
+
+
+static double clamp(double value, double limit) {
+  if (value > limit) return limit;
+  if (value < -limit) return -limit;
+  return value;
+}
+
+
+drivetrain::drivetrain(int32_t left_a, int32_t left_b, int32_t right_a, int32_t right_b, double max_rpm) {
+  _left[0] = left_a;
+  _left[1] = left_b;
+  _right[0] = right_a;
+  _right[1] = right_b;
+  _max_rpm = max_rpm;
+  _left_rpm = 0;
+  _right_rpm = 0;
+  _motors = NULL;
+  latency_reset(&_skew);
+}
+
+void drivetrain::shape(const slew_limits &limits, current_budget *budget, const motor_cache *motors) {
+  _left_slew = slew_group(limits, DRIVE_FREE_RPM, DRIVE_STALL_ACCEL, DRIVE_MOTORS_PER_SIDE * MOTOR_STALL_CURRENT, budget);
+  _right_slew = slew_group(limits, DRIVE_FREE_RPM, DRIVE_STALL_ACCEL, DRIVE_MOTORS_PER_SIDE * MOTOR_STALL_CURRENT, budget);
+  _motors = motors;
+}
+
+double drivetrain::side_rpm(const int32_t *ports, const slew_group &slew) const {
+  if (_motors != NULL && _motors->has(ports[0], MOTOR_VELOCITY)) {
+    return _motors->velocity(ports[0]);
+  }
+  return slew.output();
+}
+
+void drivetrain::tank(double left, double right) {
+  // work everything out before the first command goes out
+  left = _left_slew.step(clamp(left, _max_rpm), side_rpm(_left, _left_slew));
+  right = _right_slew.step(clamp(right, _max_rpm), side_rpm(_right, _right_slew));
+  int32_t l = (int32_t)lround(left);
+  int32_t r = (int32_t)lround(right);
+
+  // interleave the sides so neither one gets a head start
+  uint64_t start = vexSystemHighResTimeGet();
+  for (int i = 0; i < DRIVE_MOTORS_PER_SIDE; i++) {
+    vexMotorVelocitySet(_left[i], l);
+    vexMotorVelocitySet(_right[i], r);
+  }
+  latency_record(&_skew, (uint32_t)(vexSystemHighResTimeGet() - start));
+
+  _left_rpm = l;
+  _right_rpm = r;
+}
+
+void drivetrain::arcade(double forward, double turn) {
+  double left = forward + turn;
+  double right = forward - turn;
+
+  // keep the ratio between the sides (and so the turn) when saturated
+  double biggest = fmax(fabs(left), fabs(right));
+  if (biggest > _max_rpm) {
+    left *= _max_rpm / biggest;
+    right *= _max_rpm / biggest;
+  }
+
+  tank(left, right);
+}
+
+void drivetrain::curvature(double forward, double curve, bool quick_turn) {
+  curve = clamp(curve, 1.0);
+
+  // turning in place, curve is just a turn rate
+  if (quick_turn) {
+    arcade(forward, curve * _max_rpm);
+    return;
+  }
+
+  // otherwise the turn scales with speed so the arc stays the same
+  arcade(forward, fabs(forward) * curve);
+}
+
+void drivetrain::stop(V5MotorBrakeMode mode) {
+  for (int i = 0; i < DRIVE_MOTORS_PER_SIDE; i++) {
+    vexMotorBrakeModeSet(_left[i], mode);
+    vexMotorBrakeModeSet(_right[i], mode);
+  }
+
+  // velocity 0 with a brake mode set is how the sdk stops a motor
+  uint64_t start = vexSystemHighResTimeGet();
+  for (int i = 0; i < DRIVE_MOTORS_PER_SIDE; i++) {
+    vexMotorVelocitySet(_left[i], 0);
+    vexMotorVelocitySet(_right[i], 0);
+  }
+  latency_record(&_skew, (uint32_t)(vexSystemHighResTimeGet() - start));
+
+  _left_rpm = 0;
+  _right_rpm = 0;
+  _left_slew.reset(0);
+  _right_slew.reset(0);
+}
+
+void drivetrain::set_max_rpm(double max_rpm) {
+  _max_rpm = max_rpm;
+}
+
+double drivetrain::left_position(const motor_cache &motors) const {
+  double sum = 0;
+  for (int i = 0; i < DRIVE_MOTORS_PER_SIDE; i++) {
+    sum += motors.position(_left[i]);
+  }
+  return sum / DRIVE_MOTORS_PER_SIDE;
+}
+
+double drivetrain::right_position(const motor_cache &motors) const {
+  double sum = 0;
+  for (int i = 0; i < DRIVE_MOTORS_PER_SIDE; i++) {
+    sum += motors.position(_right[i]);
+  }
+  return sum / DRIVE_MOTORS_PER_SIDE;
+}
@@ -0,0 +1,74 @@
+
+// standard libs
+#include <stdio.h>
+
+// vex api and macros
+#include "vex.h"
+#include "telemetry.h"
+#include "estop.h"
+
+
+estop::estop(const estop_motor *motors, uint32_t count) {
+  _count = count < ESTOP_MAX_MOTORS ? count : ESTOP_MAX_MOTORS;
+  for (uint32_t i = 0; i < _count; i++) {
+    _motors[i] = motors[i];
+  }
+  _active = false;
+  _reported = false;
+  _triggers = 0;
+  _stop_us = 0;
+  _edge = 0;
+}
+
+void estop::stop_all(void) {
+  // brake modes first so each motor stops the right way the moment its
+  // velocity goes to 0 (same as drivetrain::stop)
+  for (uint32_t i = 0; i < _count; i++) {
+    vexMotorBrakeModeSet(_motors[i].port, _motors[i].mode);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    vexMotorVelocitySet(_motors[i].port, 0);
+  }
+}
+
+void estop::trigger(uint64_t edge) {
+  stop_all();
+  _triggers++;
+
+  if (_active) {
+    return;
+  }
+  _stop_us = (uint32_t)(vexSystemHighResTimeGet() - edge);
+  _edge = edge;
+  _active = true;
+}
+
+void estop::hold(void) {
+  if (_active) {
+    stop_all();
+  }
+}
+
+bool estop::report(void) {
+  if (!_active || _reported) {
+    return false;
+  }
+  _reported = true;
+
+  // whatever was held back goes out now, then what happened
+  telemetry_flush();
+  telemetry_estop record;
+  record.stop_us = _stop_us;
+  record.motors = (uint8_t)_count;
+  record.edge_ms = (uint32_t)(_edge / 1000);
+  telemetry_send(TELEM_ESTOP, &record, sizeof(record));
+  telemetry_send_stats();
+
+  telemetry_printf("estop: %lu motors stopped %lu us after the button\n",
+         (unsigned long)_count, (unsigned long)_stop_us);
+  vexDisplayErase();
+  vexDisplayForegroundColor(ClrRed);
+  vexDisplayString(1, "E-STOP  %lu motors in %lu us", (unsigned long)_count, (unsigned long)_stop_us);
+  vexDisplayString(2, "restart the program to drive again");
+  return true;
+}
@@ -0,0 +1,72 @@
+
+// standard libs
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "flywheel.h"
+
+// motor supply (mV)
+#define FLYWHEEL_MAX_VOLTAGE 12000
+
+
+flywheel_control::flywheel_control(void) {
+  _gains = NULL;
+  reset();
+}
+
+void flywheel_control::set_gains(const flywheel_gains *gains) {
+  _gains = gains;
+}
+
+void flywheel_control::shape(const slew_limits &limits, current_budget *budget) {
+  _slew = slew_group(limits, FLYWHEEL_MAX_VOLTAGE, 0, MOTOR_STALL_CURRENT, budget);
+}
+
+void flywheel_control::reset(void) {
+  _integral = 0;
+  _last_us = 0;
+  _error = 0;
+  _output = 0;
+  _slew.reset(0);
+}
+
+int32_t flywheel_control::update(double target, double rpm) {
+  flywheel_gains k;
+  if (_gains != NULL) {
+    k = *_gains;
+  } else {
+    k = { param_flywheel_kf.get(), param_flywheel_kp.get(), param_flywheel_ki.get() };
+  }
+
+  uint64_t now = vexSystemHighResTimeGet();
+  double dt_s = _last_us != 0 ? (now - _last_us) / 1e6 : 0;
+  _last_us = now;
+  _error = target - rpm;
+
+  // the integral only has to cover what the feedforward misses (drag,
+  // battery sag), so it gets a small limit of its own. it holds still
+  // while the output is pinned the way the error pushes it (spinning up,
+  // or starved by a current limit), or it winds up and overshoots after
+  double integral = _integral + _error * dt_s;
+  if (k.ki > 0) {
+    double limit = FLYWHEEL_MAX_INTEGRAL / k.ki;
+    integral = fmax(-limit, fmin(limit, integral));
+  }
+  double pinned = k.kf * target + k.kp * _error + k.ki * _integral;
+  if (!(pinned >= FLYWHEEL_MAX_VOLTAGE && _error > 0) && !(pinned <= 0 && _error < 0)) {
+    _integral = integral;
+  }
+
+  // never drive it backwards, a flywheel just coasts down
+  double mv = k.kf * target + k.kp * _error + k.ki * _integral;
+  mv = fmax(0, fmin(FLYWHEEL_MAX_VOLTAGE, mv));
+
+  // the motor's speed as a voltage is what it would take to hold it
+  mv = _slew.step(mv, rpm * FLYWHEEL_MAX_VOLTAGE / FLYWHEEL_FREE_RPM);
+
+  _output = (int32_t)mv;
+  return _output;
+}
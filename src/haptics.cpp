@@ -0,0 +1,72 @@
+
+// standard libs
+#include <stddef.h>
+
+// vex api and macros
+#include "haptics.h"
+
+
+haptics::haptics(const haptic_pattern *table, uint32_t count) {
+  _table = table;
+  _count = count < HAPTIC_MAX_EVENTS ? count : HAPTIC_MAX_EVENTS;
+  _waiting = 0;
+  for (uint32_t i = 0; i < HAPTIC_MAX_EVENTS; i++) {
+    _played_at[i] = 0;
+    _played[i] = false;
+  }
+  _busy_until = 0;
+  _posts = 0;
+  _dropped = 0;
+  _plays = 0;
+}
+
+uint32_t haptics::duration(const char *pattern) {
+  uint32_t ms = 0;
+  for (const char *c = pattern; *c != '\0'; c++) {
+    switch (*c) {
+      case '.': ms += HAPTIC_DOT_MS; break;
+      case '-': ms += HAPTIC_DASH_MS; break;
+      default: ms += HAPTIC_SPACE_MS; break;
+    }
+    ms += HAPTIC_GAP_MS;
+  }
+  return ms;
+}
+
+bool haptics::post(uint32_t event, uint32_t now) {
+  if (event >= _count) {
+    return false;
+  }
+  _posts++;
+
+  bool waiting = _waiting & (1u << event);
+  bool cooling = _played[event] && now - _played_at[event] < _table[event].cooldown;
+  if (waiting || cooling) {
+    _dropped++;
+    return false;
+  }
+
+  _waiting |= 1u << event;
+  return true;
+}
+
+const char *haptics::service(uint32_t now) {
+  if (_waiting == 0 || (int32_t)(now - _busy_until) < 0) {
+    return NULL;
+  }
+
+  // most important first, lowest event number on a tie
+  int32_t best = -1;
+  for (uint32_t i = 0; i < _count; i++) {
+    if ((_waiting & (1u << i)) && (best < 0 || _table[i].priority > _table[best].priority)) {
+      best = i;
+    }
+  }
+
+  _waiting &= ~(1u << best);
+  _played[best] = true;
+  _played_at[best] = now;
+  _busy_until = now + duration(_table[best].pattern);
+  _plays++;
+  return _table[best].pattern;
+}
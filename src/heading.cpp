@@ -0,0 +1,117 @@
+
+// standard libs
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "heading.h"
+
+
+double heading_wrap(double degrees) {
+  degrees = fmod(degrees + 180.0, 360.0);
+  if (degrees < 0) {
+    degrees += 360.0;
+  }
+  return degrees - 180.0;
+}
+
+
+heading_hold::heading_hold(int32_t imu_port) {
+  _imu_port = imu_port;
+  _source = NULL;
+  _gains = NULL;
+  _active = false;
+  _target = 0;
+  _integral = 0;
+  _last_heading = 0;
+  _last_us = 0;
+  _error = 0;
+}
+
+void heading_hold::set_source(double (*source)(void)) {
+  _source = source;
+}
+
+void heading_hold::set_gains(const heading_gains *gains) {
+  _gains = gains;
+}
+
+double heading_hold::read(void) {
+  if (_source != NULL) {
+    return _source();
+  }
+  return vexImuHeadingGet(_imu_port);
+}
+
+void heading_hold::hold(double heading) {
+  _target = heading;
+  _integral = 0;
+  _last_heading = read();
+  _last_us = vexSystemHighResTimeGet();
+  _active = true;
+}
+
+void heading_hold::hold_current(void) {
+  hold(read());
+}
+
+void heading_hold::retarget(double heading) {
+  if (!_active) {
+    hold(heading);
+    return;
+  }
+  _target = heading;
+}
+
+void heading_hold::release(void) {
+  _active = false;
+  _error = 0;
+}
+
+void heading_hold::drive(drivetrain &dt, double forward) {
+  if (!_active) {
+    dt.tank(forward, forward);
+    return;
+  }
+
+  // fresh sample every tick, the imu updates faster than we drive
+  double heading = read();
+  uint64_t now = vexSystemHighResTimeGet();
+  double dt_s = (now - _last_us) / 1e6;
+  _last_us = now;
+
+  _error = heading_wrap(_target - heading);
+
+  double rate = 0;
+  if (dt_s > 0) {
+    // derivative on the measurement so changing the target doesnt kick
+    rate = heading_wrap(heading - _last_heading) / dt_s;
+
+    // only integrate while moving, otherwise it winds up sitting still
+    if (forward != 0) {
+      _integral += _error * dt_s;
+    }
+  }
+  _last_heading = heading;
+
+  heading_gains k;
+  if (_gains != NULL) {
+    k = *_gains;
+  } else {
+    k = { param_heading_kp.get(), param_heading_ki.get(), param_heading_kd.get() };
+  }
+
+  // keep the integral term from ever asking for more than the limit
+  if (k.ki > 0) {
+    double limit = HEADING_MAX_CORRECTION / k.ki;
+    _integral = fmax(-limit, fmin(limit, _integral));
+  }
+
+  // positive error means we need to turn clockwise (left side faster)
+  double turn = k.kp * _error + k.ki * _integral - k.kd * rate;
+  turn = fmax(-HEADING_MAX_CORRECTION, fmin(HEADING_MAX_CORRECTION, turn));
+
+  dt.arcade(forward, turn);
+}
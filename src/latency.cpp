@@ -0,0 +1,211 @@
+
+// standard libs
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "telemetry.h"
+#include "latency.h"
+
+
+// task table, filled in at startup
+static latency_task tasks[LATENCY_MAX_TASKS];
+static std::atomic<int32_t> task_count(0);
+
+
+// map a sample to its bucket
+static inline uint32_t bucket_index(uint32_t us) {
+  if (us < LATENCY_SUB_COUNT) {
+    return us;
+  }
+
+  uint32_t e = 31 - __builtin_clz(us);
+  if (e > LATENCY_MAX_EXP) {
+    return LATENCY_BUCKETS - 1;
+  }
+
+  uint32_t sub = (us >> (e - LATENCY_SUB_BITS)) & (LATENCY_SUB_COUNT - 1);
+  return (e - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT + sub;
+}
+
+// largest value that lands in a bucket
+static uint32_t bucket_upper(uint32_t index) {
+  if (index < LATENCY_SUB_COUNT) {
+    return index;
+  }
+
+  uint32_t e = index / LATENCY_SUB_COUNT + LATENCY_SUB_BITS - 1;
+  uint32_t sub = index % LATENCY_SUB_COUNT;
+  uint32_t width = 1u << (e - LATENCY_SUB_BITS);
+  return ((LATENCY_SUB_COUNT + sub) << (e - LATENCY_SUB_BITS)) + width - 1;
+}
+
+
+latency_task *latency_register(const char *name, uint32_t period_ms) {
+  int32_t index = task_count.load(std::memory_order_relaxed);
+  if (index >= LATENCY_MAX_TASKS) {
+    return NULL;
+  }
+
+  latency_task *task = &tasks[index];
+  task->name = name;
+  task->period_us = period_ms * 1000;
+  task->next_us = 0;
+  latency_reset(&task->run);
+  latency_reset(&task->late);
+
+  // publish after the slot is filled so readers never see half a task
+  task_count.store(index + 1, std::memory_order_release);
+  return task;
+}
+
+void latency_record(latency_hist *hist, uint32_t us) {
+  // single writer, so load + store is enough (no read-modify-write needed)
+  std::atomic<uint32_t> &slot = hist->counts[bucket_index(us)];
+  slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  hist->total.store(hist->total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  if (us > hist->max.load(std::memory_order_relaxed)) {
+    hist->max.store(us, std::memory_order_relaxed);
+  }
+}
+
+void latency_reset(latency_hist *hist) {
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    hist->counts[i].store(0, std::memory_order_relaxed);
+  }
+  hist->total.store(0, std::memory_order_relaxed);
+  hist->max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t latency_tick_begin(latency_task *task) {
+  uint64_t now = vexSystemHighResTimeGet();
+
+  // first tick just sets the schedule
+  if (task->next_us == 0) {
+    task->next_us = now;
+  }
+
+  uint64_t late = now > task->next_us ? now - task->next_us : 0;
+  latency_record(&task->late, (uint32_t)late);
+
+  // if we fell a whole period behind dont try to catch up, just resync
+  task->next_us += task->period_us;
+  if (late > task->period_us) {
+    task->next_us = now + task->period_us;
+  }
+
+  return now;
+}
+
+void latency_tick_end(latency_task *task, uint64_t start) {
+  latency_record(&task->run, (uint32_t)(vexSystemHighResTimeGet() - start));
+}
+
+uint32_t latency_percentile(const latency_hist *hist, double p) {
+  uint32_t total = hist->total.load(std::memory_order_relaxed);
+  if (total == 0) {
+    return 0;
+  }
+
+  // rank of the sample we want (rounded up so p100 is the last one)
+  uint32_t rank = (uint32_t)ceil(total * (p / 100.0));
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += hist->counts[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      // never report more than we actually saw
+      uint32_t upper = bucket_upper(i);
+      uint32_t max = hist->max.load(std::memory_order_relaxed);
+      return upper < max ? upper : max;
+    }
+  }
+
+  return hist->max.load(std::memory_order_relaxed);
+}
+
+int32_t latency_task_count(void) {
+  return task_count.load(std::memory_order_acquire);
+}
+
+const latency_task *latency_task_at(int32_t index) {
+  return index >= 0 && index < latency_task_count() ? &tasks[index] : NULL;
+}
+
+
+latency_probe::latency_probe(latency_hist *hist) {
+  _hist = hist;
+  _start = vexSystemHighResTimeGet();
+}
+
+latency_probe::~latency_probe() {
+  latency_record(_hist, (uint32_t)(vexSystemHighResTimeGet() - _start));
+}
+
+
+// format one task as a single line
+// name: run p50/p99/max late p50/p99/max (all in us)
+static int32_t format_task(char *out, uint32_t len, const latency_task *task) {
+  return snprintf(out, len, "%-8s run %lu/%lu/%lu late %lu/%lu/%lu",
+    task->name,
+    (unsigned long)latency_percentile(&task->run, 50),
+    (unsigned long)latency_percentile(&task->run, 99),
+    (unsigned long)task->run.max.load(std::memory_order_relaxed),
+    (unsigned long)latency_percentile(&task->late, 50),
+    (unsigned long)latency_percentile(&task->late, 99),
+    (unsigned long)task->late.max.load(std::memory_order_relaxed));
+}
+
+void latency_print(void) {
+  char line[96];
+  int32_t count = task_count.load(std::memory_order_acquire);
+
+  telemetry_printf("latency (us) p50/p99/max\n");
+  for (int i = 0; i < count; i++) {
+    format_task(line, sizeof(line), &tasks[i]);
+    telemetry_printf("%s\n", line);
+  }
+}
+
+void latency_draw(int32_t line) {
+  char text[96];
+  int32_t count = task_count.load(std::memory_order_acquire);
+
+  vexDisplayString(line, "latency (us) p50/p99/max");
+  for (int i = 0; i < count; i++) {
+    format_task(text, sizeof(text), &tasks[i]);
+    vexDisplayString(line + 1 + i, "%s", text);
+  }
+}
+
+int32_t latency_log(const char *filename) {
+  char line[96];
+  int32_t count = task_count.load(std::memory_order_acquire);
+
+  // vexFileOpenWrite appends
+  FIL *file = vexFileOpenWrite(filename);
+  if (file == NULL) {
+    return -1;
+  }
+
+  int32_t written = 0;
+  uint32_t stamp = vexSystemTimeGet();
+  for (int i = 0; i < count; i++) {
+    int32_t len = snprintf(line, sizeof(line), "%lu ", (unsigned long)stamp);
+    len += format_task(line + len, sizeof(line) - len, &tasks[i]);
+    if (len > (int32_t)sizeof(line) - 2) {
+      len = sizeof(line) - 2;
+    }
+    line[len++] = '\n';
+    written += vexFileWrite(line, 1, len, file);
+  }
+
+  vexFileClose(file);
+  return written;
+}
@@ -11,6 +11,29 @@
 // vex api and macros
 #include "vex.h"
 #include "macros.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "heading.h"
+#include "triport_snapshot.h"
+#include "velocity.h"
+#include "vision_table.h"
+#include "pose.h"
+#include "vision_service.h"
+#include "auton.h"
+#include "competition_manager.h"
+#include "estop.h"
+#include "timer_wheel.h"
+#include "controller_display.h"
+#include "haptics.h"
+#include "motor_cache.h"
+#include "flywheel.h"
+#include "slew.h"
+#include "current_arbiter.h"
+#include "crash_recorder.h"
+#include "profile.h"
+#include "periodic.h"
 
 using namespace vex;
 
@@ -27,8 +50,108 @@ motor_group LeftDriveSmart = motor_group(leftMotorA, leftMotorB);
 motor rightMotorA = motor(PORT1, ratio18_1, true);
 motor rightMotorB = motor(PORT10, ratio18_1, true);
 motor_group RightDriveSmart = motor_group(rightMotorA, rightMotorB);
-motor flyWheel = motor(PORT2, ratio18_1, true);
+drivetrain Drivetrain = drivetrain(PORT11, PORT20, PORT1, PORT10, DRIVETRAIN_SPEED);
+heading_hold Heading = heading_hold(PORT3); // inertial sensor
+motor flyWheel = motor(PORT2, ratio6_1, true);  // 6:1, FLYWHEEL_FREE_RPM and FLYWHEEL_KF assume it
 bool flyWheel_is_spinning = false;
+velocity_estimator flyWheelSpeed = velocity_estimator(MOTOR_COUNTS_6, VELOCITY_KALMAN);
+flywheel_control flyWheelControl = flywheel_control();
+
+// every motor reading, taken once a drive tick (17 device calls)
+// (one velocity per drive side is enough for the current estimate).
+// tools/bench times the same list, change both together
+const motor_read MotorReads[] = {
+  { PORT11, MOTOR_POSITION | MOTOR_VELOCITY | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { PORT20, MOTOR_POSITION | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { PORT1, MOTOR_POSITION | MOTOR_VELOCITY | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { PORT10, MOTOR_POSITION | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { PORT2, MOTOR_RAW | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+};
+motor_cache Motors = motor_cache(MotorReads, sizeof(MotorReads) / sizeof(MotorReads[0]));
+
+// what every motor port together may draw, the drive and the flywheel
+// ramp their commands and share it (more than these 5 motors can draw, see
+// CURRENT_BUDGET)
+current_budget MotorCurrent = current_budget(CURRENT_BUDGET);
+
+// and the current limits the motors actually run under, moved every tick
+// to wherever the current is needed. the flywheel is served first, up to
+// speed it only draws what holding it and getting back a shot takes, and
+// the drive gets the rest (all of it, when it is pushing)
+const int32_t DrivePorts[] = { PORT11, PORT20, PORT1, PORT10 };
+const int32_t FlyWheelPorts[] = { PORT2 };
+const arbiter_group CurrentGroups[] = {
+  { "drive", DrivePorts, 4, 1 },
+  { "flywheel", FlyWheelPorts, 1, 0 },
+};
+current_arbiter CurrentArbiter = current_arbiter(CurrentGroups, 2, CURRENT_BUDGET);
+
+// the three wire ports. nothing is plugged in yet, so no tick reads them:
+// once a sensor is, take a snapshot at the top of the drive tick and have
+// it read from that
+triport_sampler Triport = triport_sampler(PORT22);
+
+// vision signatures from vision/signatures.txt (make vision)
+vision_signatures VisionSigs = vision_signatures(PORT4, VISION_TABLE, VISION_TABLE_COUNT, VISION_BRIGHTNESS);
+vision_service Vision = vision_service(PORT4);
+
+// field position, the goals are the landmarks (meters from the red corner).
+// they carry color codes, red and blue are only ever seen as part of one
+const landmark Landmarks[] = {
+  { CODE_RED_GREEN, 0.0, 1.83 },
+  { CODE_BLUE_GREEN, 3.66, 1.83 },
+};
+pose_filter Pose = pose_filter(Landmarks, sizeof(Landmarks) / sizeof(Landmarks[0]));
+pose_log PoseLog;
+
+// autonomous routines, picked on the brain screen while disabled
+// (the straight one follows the wait_time parameter)
+auton_step straight_steps[] = {
+  { AUTON_DRIVE_TIME, WAIT_TIME },
+};
+const auton_step square_steps[] = {
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+};
+const auton_routine Routines[] = {
+  { "straight", { 0.6, 0.6, 0 }, straight_steps, 1 },
+  { "square", { 0.6, 0.6, 0 }, square_steps, 8 },
+  { "none", { 0.6, 0.6, 0 }, NULL, 0 },
+};
+#define ROUTINE_COUNT (sizeof(Routines) / sizeof(Routines[0]))
+
+auton_plan Plan;
+auton_selector Selector = auton_selector(Routines, ROUTINE_COUNT);
+
+// which part of the match we are in
+competition_manager Match;
+
+// every motor on the robot and how the e-stop leaves it
+const estop_motor StopList[] = {
+  { PORT11, kV5MotorBrakeModeHold },
+  { PORT20, kV5MotorBrakeModeHold },
+  { PORT1, kV5MotorBrakeModeHold },
+  { PORT10, kV5MotorBrakeModeHold },
+  { PORT2, kV5MotorBrakeModeBrake },  // flywheel, hold would fight it to a stop
+};
+estop EStop = estop(StopList, sizeof(StopList) / sizeof(StopList[0]));
+
+// rumbles, most important first
+enum rumble_event {
+  RUMBLE_ESTOP = 0,
+  RUMBLE_FLYWHEEL_READY = 1,
+  RUMBLE_OVER_TEMP = 2,
+  RUMBLE_LOW_BATTERY = 3
+};
+const haptic_pattern Rumbles[] = {
+  { "---", 3, 0 },
+  { ".", 2, 0 },
+  { "-.-", 1, RUMBLE_TEMP_COOLDOWN },
+  { "..", 0, RUMBLE_BATTERY_COOLDOWN },
+};
+haptics Haptics = haptics(Rumbles, sizeof(Rumbles) / sizeof(Rumbles[0]));
 
 // define variable for remote controller enable/disable
 // why is this required?
@@ -36,101 +159,584 @@ bool flyWheel_is_spinning = false;
 //bool RemoteControlCodeEnabled = true; //swapfile
 
 
+// crash recorder
+// the last few seconds of every drive tick, dumped to the sd card if the
+// program aborts (tools/crash_decode reads it)
+crash_recorder Crash = crash_recorder(&Motors);
+
+
+// cpu profile
+// every task marks when it has the cpu (the periodic ones do it
+// themselves), once a window the shares are worked out and streamed
+// (tools/telemetry_rx), the latency report shows them too
+profile_task *timer_cpu = NULL;
+profile_task *vision_cpu = NULL;
+profile_task *event_cpu = NULL;   // button and screen handlers
+
+void report_cpu(void *arg) {
+  profile_update();
+
+  for (int32_t i = 0; i < profile_task_count(); i++) {
+    const profile_task *task = profile_task_at(i);
+    telemetry_cpu c = { (uint8_t)i, (uint16_t)task->permille.load(), task->worst.load() };
+    telemetry_send(TELEM_CPU, &c, sizeof(c));
+  }
+  telemetry_cpu rest = { TELEMETRY_CPU_OTHER, (uint16_t)profile_other(), profile_overhead() };
+  telemetry_send(TELEM_CPU, &rest, sizeof(rest));
+}
+
+
 // abort function
-// kills the program
+// stops every motor right here (whichever task this is), the control task
+// sees it on its next tick and keeps the robot disabled from then on. what
+// led up to it goes to the sd card once the motors are stopped
 void kill(void) {
-  abort();
+  uint64_t edge = vexSystemHighResTimeGet();
+  profile_scope scope(event_cpu);
+  EStop.trigger(edge);
+  flyWheel_is_spinning = false;
+  Haptics.post(RUMBLE_ESTOP, timer::system());
+  Crash.dump(CRASH_ESTOP_FILE, CRASH_ESTOP);
 }
 
 
-// right move forward
-void r_mf(void) {
-  while (Controller1.ButtonR1.pressing()) {
-    RightDriveSmart.spin(forward);
+// latency report
+// tap the brain screen to dump control loop timing (and where the cpu
+// went) everywhere
+void show_latency(void) {
+  profile_scope scope(event_cpu);
+
+  // the auton selector has the screen while disabled
+  if (Match.state() == COMP_DISABLED) {
+    return;
   }
-  RightDriveSmart.stop();
+
+  Brain.Screen.clearScreen();
+  latency_draw(1);
+  profile_draw(2 + latency_task_count());
+  latency_print();
+  profile_print();
+  periodic_print();
+  latency_log(LATENCY_LOG_FILE);
 }
 
-// left move forward
-void l_mf(void) {
-  while (Controller1.ButtonL1.pressing()) {
-    LeftDriveSmart.spin(forward);
+
+// timer task
+// the small periodic jobs that dont need a deadline of their own run off
+// one wheel instead of a sleeping task each
+timer_wheel Timers;
+
+int timer_loop(void) {
+  while (true) {
+    profile_enter(timer_cpu);
+    Timers.advance(timer::system());
+    profile_leave(timer_cpu);
+    this_thread::sleep_for(TIMER_WHEEL_PERIOD);
   }
-  LeftDriveSmart.stop();
+  return 0;
+}
+
+
+// telemetry
+// streams flywheel state and the motor current limits to the host
+// (tools/telemetry_rx), best effort so it gives way when the drive tick
+// is short of time
+void send_telemetry(void);
+periodic_task TelemetryTask = periodic_task("telemetry", TELEMETRY_PERIOD, TELEMETRY_PERIOD, PERIODIC_BEST_EFFORT, send_telemetry);
+
+int telemetry_loop(void) {
+  TelemetryTask.run();
+  return 0;
 }
 
-// right move backward
-void r_mb(void) {
-  while (Controller1.ButtonR2.pressing()) {
-    RightDriveSmart.spin(reverse);
+void send_telemetry(void) {
+  telemetry_flywheel fw;
+  fw.target = flyWheel_is_spinning ? param_flywheel_rpm.get() : 0;
+  fw.actual = (int16_t)(flyWheelSpeed.rpm() * 10);
+  telemetry_send(TELEM_FLYWHEEL, &fw, sizeof(fw));
+
+  // reading the arbiter never waits on the control task
+  for (uint32_t g = 0; g < CurrentArbiter.count(); g++) {
+    telemetry_current c = { (uint8_t)g, (int16_t)CurrentArbiter.limit(g),
+                            (int16_t)CurrentArbiter.demand(g), (int16_t)CurrentArbiter.drawn(g) };
+    telemetry_send(TELEM_CURRENT, &c, sizeof(c));
   }
-  RightDriveSmart.stop();
+  telemetry_send_stats();
 }
 
-// left move backward
-void l_mb(void) {
-  while (Controller1.ButtonL2.pressing()) {
-    LeftDriveSmart.spin(reverse);
-  } 
-  LeftDriveSmart.stop();
+
+// controller screen
+// flywheel, battery and what mode we are in, the writes go out one at a
+// time as the radio takes them so nothing here ever waits on the link.
+// best effort like telemetry
+controller_display ControllerScreen = controller_display(kControllerMaster);
+
+void update_controller(void);
+periodic_task ScreenTask = periodic_task("screen", CONTROLLER_TEXT_PERIOD, CONTROLLER_TEXT_PERIOD, PERIODIC_BEST_EFFORT, update_controller);
+
+int screen_loop(void) {
+  ScreenTask.run();
+  return 0;
 }
 
-// flywheel start
-void flywheel_toggle(void) {
-  switch (flyWheel_is_spinning) {
-    case true:
-      flyWheel.stop();
-      flyWheel_is_spinning = false;
+void update_controller(void) {
+  if (flyWheel_is_spinning) {
+    ControllerScreen.print(0, "FW %4.0f/%ld rpm", flyWheelSpeed.rpm(), (long)param_flywheel_rpm.get());
+  } else {
+    ControllerScreen.print(0, "FW off");
+  }
+  ControllerScreen.print(1, "BAT %3.0f%% %4.1fV", vexBatteryCapacityGet(), vexBatteryVoltageGet() / 1000.0);
+  ControllerScreen.print(2, "%s", EStop.active() ? "E-STOP" : comp_state_name(Match.state()));
+
+  ControllerScreen.service(timer::system());
+}
+
+
+// parameter console
+// type "set flywheel_rpm 550" into the serial terminal to retune live
+void poll_params(void *arg) {
+  params_console_poll();
+}
 
-    case false:
-      flyWheel.spin(forward);
-      flyWheel_is_spinning = true;
 
-    default:
-      kill(); // have the program kill its self
+// vision task
+// reads each new frame as it lands so the drive tick never waits on the
+// sensor, and puts the signatures back if the sensor gets unplugged and
+// comes back
+int vision_loop(void) {
+  uint32_t next_check = 0;
+
+  while (true) {
+    profile_enter(vision_cpu);
+    bool published = Vision.poll();
+
+    if (timer::system() >= next_check) {
+      VisionSigs.poll();
+      next_check = timer::system() + VISION_CHECK_PERIOD;
+    }
+
+    profile_leave(vision_cpu);
+    this_thread::sleep_for(Vision.next_poll(published));
+  }
+  return 0;
+}
+
+
+// rumble feedback
+// flywheel up to speed (so the driver can shoot without looking), a motor
+// running hot, battery getting low. checked every control tick, the
+// rumble itself goes out with the next controller screen write
+bool flywheel_ready = false;
+
+void check_haptics(void) {
+  uint32_t now = timer::system();
+
+  double error = fabs(flyWheelSpeed.rpm() - param_flywheel_rpm.get());
+  bool ready = flyWheel_is_spinning && error < (flywheel_ready ? 2 : 1) * FLYWHEEL_READY_BAND;
+  if (ready && !flywheel_ready) {
+    Haptics.post(RUMBLE_FLYWHEEL_READY, now);
+  }
+  flywheel_ready = ready;
+
+  for (uint32_t i = 0; i < Motors.count(); i++) {
+    if (Motors.temperatures()[i] >= RUMBLE_MOTOR_TEMP) {
+      Haptics.post(RUMBLE_OVER_TEMP, now);
+      break;
+    }
+  }
+
+  if (vexBatteryCapacityGet() < RUMBLE_BATTERY_PERCENT) {
+    Haptics.post(RUMBLE_LOW_BATTERY, now);
+  }
+
+  const char *pattern = Haptics.service(now);
+  if (pattern != NULL) {
+    ControllerScreen.rumble(pattern);
+  }
+}
+
+
+// crash recording
+// one record at the end of every drive tick, and a copy on the sd card
+// every few seconds (a data abort never comes back to us, so that copy is
+// all there is after one). the copy is the first thing to go when the cpu
+// is short, and it gives the cpu up between pieces of the file
+void record_crash(uint64_t start) {
+  crash_record r;
+  pose p = Pose.get();
+  r.time = timer::system();
+  r.mode = Match.state();
+  r.flags = (EStop.active() ? CRASH_FLAG_ESTOP : 0) |
+            (flyWheel_is_spinning ? CRASH_FLAG_FLYWHEEL : 0) |
+            (Heading.active() ? CRASH_FLAG_HEADING : 0);
+  r.left = Drivetrain.left_rpm();
+  r.right = Drivetrain.right_rpm();
+  r.x = (int16_t)(p.x * 1000);
+  r.y = (int16_t)(p.y * 1000);
+  r.theta = (int16_t)(p.theta * 1800 / M_PI);
+  r.flywheel_target = flyWheel_is_spinning ? param_flywheel_rpm.get() : 0;
+  r.flywheel_rpm = (int16_t)(flyWheelSpeed.rpm() * 10);
+  r.flywheel_mv = flyWheelControl.output();
+  r.battery = vexBatteryVoltageGet();
+  r.tick_us = (uint16_t)(timer::systemHighResolution() - start);
+  Crash.add(r);
+}
+
+void checkpoint_crash(void);
+periodic_task CheckpointTask = periodic_task("crash", CRASH_CHECKPOINT_PERIOD, CRASH_CHECKPOINT_PERIOD, PERIODIC_BEST_EFFORT, checkpoint_crash);
+
+void checkpoint_pause(void) {
+  CheckpointTask.yield();
+}
+
+void checkpoint_crash(void) {
+  Crash.checkpoint(CRASH_CHECKPOINT_FILE, checkpoint_pause);
+}
+
+int crash_loop(void) {
+  CheckpointTask.run();
+  return 0;
+}
+
+
+// pose tracking
+// one filter step per drive tick, in driver and auton, and every input
+// goes in the log so a run can be replayed on the host (tools/pose_replay)
+latency_task *pose_timing = NULL;
+uint32_t last_frame = 0;
+
+void track_pose(void) {
+  latency_probe probe(&pose_timing->run);
+
+  pose_sample sample;
+  sample.time = timer::system();
+  sample.left = Drivetrain.left_position(Motors);
+  sample.right = Drivetrain.right_position(Motors);
+  sample.heading = vexImuHeadingGet(PORT3);
+  sample.signature = 0;
+  sample.x_center = 0;
+
+  // each frame once, the biggest object in it that is a landmark
+  const vision_frame &frame = Vision.latest();
+  if (frame.sequence != last_frame) {
+    last_frame = frame.sequence;
+    for (uint32_t i = 0; i < frame.count && sample.signature == 0; i++) {
+      const V5_DeviceVisionObject &object = frame.objects[i];
+      for (uint32_t l = 0; l < sizeof(Landmarks) / sizeof(Landmarks[0]); l++) {
+        if (object.signature == Landmarks[l].signature) {
+          sample.signature = Landmarks[l].signature;
+          sample.x_center = object.xoffset + object.width / 2;
+          break;
+        }
+      }
+    }
   }
+
+  Pose.step(sample);
+  PoseLog.add(sample);
 }
 
+// the log is handed over once auton is done and written out by a best
+// effort task, the sd card never holds up a control tick
+std::atomic<bool> pose_log_ready(false);
 
-// driver control callback
-void driver(void) {
+void save_pose_log(void);
+periodic_task PoseLogTask = periodic_task("poselog", POSE_LOG_CHECK_PERIOD, POSE_LOG_CHECK_PERIOD, PERIODIC_BEST_EFFORT, save_pose_log);
 
-  // setup drivetrain and flywheel
-  RightDriveSmart.setVelocity(DRIVETRAIN_SPEED, rpm);
-  LeftDriveSmart.setVelocity(DRIVETRAIN_SPEED, rpm);
-  flyWheel.setVelocity(FLYWHEEL_RPM, rpm);
-  
-  // setup movement controls
-  Controller1.ButtonL1.pressed(l_mf);
-  Controller1.ButtonR1.pressed(r_mf);
-  Controller1.ButtonL2.pressed(l_mb);
-  Controller1.ButtonR2.pressed(r_mb);
+void pose_log_pause(void) {
+  PoseLogTask.yield();
+}
+
+void save_pose_log(void) {
+  if (pose_log_ready.exchange(false)) {
+    PoseLog.save(POSE_LOG_FILE, Landmarks, sizeof(Landmarks) / sizeof(Landmarks[0]), pose_log_pause);
+  }
+}
+
+int pose_log_loop(void) {
+  PoseLogTask.run();
+  return 0;
+}
+
+
+// auton
+// while disabled a tap on the screen picks the routine, and the plan is
+// worked out again whenever the pick or a parameter changes, so auton
+// itself only has to play it back
+uint32_t auton_version = 0;
+uint32_t auton_tick_index = 0;
+double auton_base = 0;
+
+void prepare_plan(void) {
+  straight_steps[0].value = param_wait_time.get();
+
+  uint32_t pick = param_auton.get();
+  Plan.prepare(&Routines[pick < ROUTINE_COUNT ? pick : 0], param_drivetrain_speed.get());
+}
+
+void autonomous_prepare(void) {
+  int32_t pick = Selector.poll();
+  if (pick >= 0) {
+    param_auton.set(pick);
+  }
+
+  if (Plan.routine() == NULL || pick >= 0 || params_version() != auton_version) {
+    auton_version = params_version();
+    prepare_plan();
+    Selector.draw(param_auton.get(), Plan);
+  }
+}
+
+// automation
+// hehe funny name
+void capatalism_at_its_peak(void) {
+  Drivetrain.set_max_rpm(Plan.max_rpm());
+  auton_base = vexImuHeadingGet(PORT3);
+  Heading.hold(auton_base);
+  auton_tick_index = 0;
+
+  Pose.reset(Plan.routine()->start);
+  PoseLog.start(Plan.routine()->start);
+}
+
+void autonomous_tick(void) {
+  if (auton_tick_index >= Plan.count()) {
+    Drivetrain.stop(kV5MotorBrakeModeBrake);
+    return;
+  }
+
+  const auton_tick &tick = Plan.tick(auton_tick_index++);
+  Heading.retarget(auton_base + tick.heading);
+  Heading.drive(Drivetrain, tick.forward);
+}
+
+void autonomous_stop(void) {
+  Heading.release();
+  Drivetrain.stop(kV5MotorBrakeModeBrake);
+
+  // keep the run for replay on the host
+  PoseLog.close();
+  pose_log_ready.store(true);
+}
+
+
+// driver
+// buttons and the flywheel are set up while disabled, the tick is the
+// same every time
+void flywheel_toggle(void);
+void skew_bench(void);
+
+void driver_prepare(void) {
+  static bool registered = false;
+
+  flyWheel.setVelocity(param_flywheel_rpm.get(), rpm);
+  if (registered) {
+    return;
+  }
+  registered = true;
 
   // flywheel controls
   Controller1.ButtonX.pressed(flywheel_toggle);
 
   // kill button
   Controller1.ButtonA.pressed(kill);
+
+  // timing report
+  Brain.Screen.pressed(show_latency);
+  Controller1.ButtonY.pressed(skew_bench);
 }
 
-// automation
-// hehe funny name
-// NOTE: We should work on this function
-void capatalism_at_its_peak(void) {
-  LeftDriveSmart.spin(forward);
-  RightDriveSmart.spin(forward);
-  wait(WAIT_TIME, seconds);
-  LeftDriveSmart.stop();
-  RightDriveSmart.stop();
+void driver_tick(void) {
+  double speed = param_drivetrain_speed.get();
+  Drivetrain.set_max_rpm(speed);
+
+  switch (param_drive_mode.get()) {
+    case DRIVE_ARCADE:
+      Drivetrain.arcade(Controller1.Axis3.position(pct) * speed / 100,
+                        Controller1.Axis1.position(pct) * speed / 100);
+      break;
+
+    case DRIVE_CURVATURE: {
+      double forward = Controller1.Axis3.position(pct);
+      Drivetrain.curvature(forward * speed / 100,
+                           Controller1.Axis1.position(pct) / 100.0,
+                           fabs(forward) < DRIVE_QUICKTURN_DEADBAND);
+      break;
+    }
+
+    default: {
+      // buttons, L for the left side and R for the right
+      int left = Controller1.ButtonL1.pressing() - Controller1.ButtonL2.pressing();
+      int right = Controller1.ButtonR1.pressing() - Controller1.ButtonR2.pressing();
+
+      // both sides the same way means we want to go straight, so hold
+      // whatever heading we had when that started
+      if (left == right && left != 0) {
+        if (!Heading.active()) {
+          Heading.hold_current();
+        }
+        Heading.drive(Drivetrain, left * speed);
+        break;
+      }
+
+      Heading.release();
+      Drivetrain.tank(left * speed, right * speed);
+      break;
+    }
+  }
+}
+
+void driver_stop(void) {
+  Heading.release();
+}
+
+
+// control task
+// one fixed rate tick for the whole match, the competition manager works
+// out which mode we are in and the mode's command goes out first thing.
+// it has to be done DRIVE_DEADLINE after its release, when it isnt the
+// best effort tasks give up runs until it is again
+void control_tick(void);
+periodic_task DriveTask = periodic_task("drive", DRIVE_PERIOD, DRIVE_DEADLINE, PERIODIC_CONTROL, control_tick);
+
+int control_loop(void) {
+  DriveTask.run();
+  return 0;
+}
+
+void control_tick(void) {
+  if (!EStop.active()) {
+    Match.step();
+  } else {
+    // leave the mode (auton still saves its log) then make sure its stop
+    // didnt undo ours
+    Match.halt();
+    EStop.hold();
+    EStop.report();
+  }
+
+  // sensors for the next tick, after the commands are out
+  Motors.refresh();
+  flyWheelSpeed.update((uint64_t)Motors.raw_time(PORT2) * 1000, Motors.raw(PORT2));
+
+  // the flywheel runs off our estimate, so it goes as soon as that's fresh
+  // (never under the e-stop, hold() has it braked)
+  if (flyWheel_is_spinning && !EStop.active()) {
+    vexMotorVoltageSet(PORT2, flyWheelControl.update(param_flywheel_rpm.get(), flyWheelSpeed.rpm()));
+  } else {
+    flyWheelControl.reset();
+  }
+  CurrentArbiter.update(Motors);
+  track_pose();
+  check_haptics();
+  record_crash(DriveTask.started());
+}
+
+
+// drive skew benchmark
+// compares the first to last motor command time of the two motor groups
+// against the drivetrain, everything is commanded to 0 rpm so its safe to run.
+// disabled only: the rest of the time the control task commands the drive
+// every tick (and is the only one that writes the drivetrain's skew)
+void skew_bench(void) {
+  static latency_hist groups;
+  if (Match.state() != COMP_DISABLED) {
+    telemetry_printf("drive skew bench runs while disabled\n");
+    return;
+  }
+  latency_reset(&groups);
+
+  for (int i = 0; i < SKEW_BENCH_SAMPLES && Match.state() == COMP_DISABLED; i++) {
+    uint64_t start = timer::systemHighResolution();
+    LeftDriveSmart.spin(forward, 0, rpm);
+    RightDriveSmart.spin(forward, 0, rpm);
+    latency_record(&groups, (uint32_t)(timer::systemHighResolution() - start));
+    this_thread::sleep_for(DRIVE_PERIOD);
+  }
+
+  for (int i = 0; i < SKEW_BENCH_SAMPLES && Match.state() == COMP_DISABLED; i++) {
+    Drivetrain.tank(0, 0);
+    this_thread::sleep_for(DRIVE_PERIOD);
+  }
+  if (Match.state() != COMP_DISABLED) {
+    telemetry_printf("drive skew bench cut short, the match started\n");
+    return;
+  }
+
+  telemetry_printf("drive skew (us) p50/p99/max\n");
+  telemetry_printf("motor groups %lu/%lu/%lu\n",
+    (unsigned long)latency_percentile(&groups, 50),
+    (unsigned long)latency_percentile(&groups, 99),
+    (unsigned long)groups.max.load());
+  telemetry_printf("drivetrain   %lu/%lu/%lu\n",
+    (unsigned long)latency_percentile(Drivetrain.skew(), 50),
+    (unsigned long)latency_percentile(Drivetrain.skew(), 99),
+    (unsigned long)Drivetrain.skew()->max.load());
 }
 
+
+// flywheel start
+void flywheel_toggle(void) {
+  profile_scope scope(event_cpu);
+
+  // the e-stop stays latched until the program restarts
+  if (EStop.active()) {
+    return;
+  }
+  if (flyWheel_is_spinning) {
+    flyWheel.stop();
+    flyWheel_is_spinning = false;
+  } else {
+    flyWheel.spin(forward, param_flywheel_rpm.get(), rpm);
+    flyWheel_is_spinning = true;
+  }
+}
+
+
 // main function
 // // the "void" isnt standard
 void main(void) {
 
-  // setup callbacks for competition
-  competition Competition = competition();
-  Competition.drivercontrol(driver);
-  Competition.autonomous(capatalism_at_its_peak);
-}
+  // tuned values from the sd card (macros.h defaults if there is no file)
+  params_load(PARAMS_FILE);
+  crash_install(&Crash, CRASH_FILE);
+  crash_keep(CRASH_CHECKPOINT_FILE, CRASH_PREVIOUS_FILE);
+  DriveTask.start();
+  pose_timing = latency_register("pose", DRIVE_PERIOD);
+  TelemetryTask.start();
+  ScreenTask.start();
+  CheckpointTask.start();
+  PoseLogTask.start();
+  timer_cpu = profile_register("timer");
+  vision_cpu = profile_register("vision");
+  event_cpu = profile_register("events");
+  Triport.refresh_config();
+  VisionSigs.sync();
+  Drivetrain.shape({ DRIVE_SLEW_ACCEL, DRIVE_SLEW_JERK }, &MotorCurrent, &Motors);
+  flyWheelControl.shape({ FLYWHEEL_SLEW_ACCEL, FLYWHEEL_SLEW_JERK }, &MotorCurrent);
+
+  // disabled / auton / driver all run on the control task
+  Match.on(COMP_AUTON, { autonomous_prepare, capatalism_at_its_peak, autonomous_tick, autonomous_stop });
+  Match.on(COMP_DRIVER, { driver_prepare, NULL, driver_tick, driver_stop });
+  task control_task = task(control_loop, TASK_PRIORITY_CONTROL);
 
+  // background telemetry and live tuning over the serial console
+  task telemetry_task = task(telemetry_loop, TASK_PRIORITY_BEST_EFFORT);
+  Timers.start(timer::system());
+  Timers.every(PARAMS_CONSOLE_PERIOD, poll_params, NULL);
+  Timers.every(PROFILE_WINDOW, report_cpu, NULL);
+  task timer_task = task(timer_loop);
+
+  // mode first, then the flywheel, battery when there is room
+  ControllerScreen.priority(2, 2);
+  ControllerScreen.priority(0, 1);
+  task screen_task = task(screen_loop, TASK_PRIORITY_BEST_EFFORT);
+
+  // vision frames and sensor hot swap
+  task vision_task = task(vision_loop);
+
+  // crash checkpoints and the auton pose log, nothing waits on the sd
+  // card but these
+  task crash_task = task(crash_loop, TASK_PRIORITY_BEST_EFFORT);
+  task pose_log_task = task(pose_log_loop, TASK_PRIORITY_BEST_EFFORT);
+}
@@ -0,0 +1,127 @@
+
+// standard libs
+#include <string.h>
+
+// vex api and macros
+#include "vex.h"
+#include "motor_cache.h"
+
+
+motor_cache::motor_cache(const motor_read *reads, uint32_t count) {
+  memset(_slot, -1, sizeof(_slot));
+  _count = 0;
+  _calls = 0;
+
+  for (uint32_t i = 0; i < count && _count < MOTOR_CACHE_MAX; i++) {
+    int32_t port = reads[i].port;
+    if (port < 0 || port >= V5_MAX_DEVICE_PORTS || _slot[port] >= 0) {
+      continue;
+    }
+
+    _slot[port] = _count;
+    _ports[_count] = port;
+    _fields[_count] = reads[i].fields;
+    _calls += __builtin_popcount(reads[i].fields);
+    _count++;
+  }
+
+  _timestamp = 0;
+  _duration = 0;
+  _sequence = 0;
+  memset(_position, 0, sizeof(_position));
+  memset(_raw, 0, sizeof(_raw));
+  memset(_raw_time, 0, sizeof(_raw_time));
+  memset(_velocity, 0, sizeof(_velocity));
+  memset(_current, 0, sizeof(_current));
+  memset(_voltage, 0, sizeof(_voltage));
+  memset(_temperature, 0, sizeof(_temperature));
+  memset(_torque, 0, sizeof(_torque));
+  memset(_efficiency, 0, sizeof(_efficiency));
+}
+
+void motor_cache::refresh(void) {
+  _timestamp = vexSystemHighResTimeGet();
+
+  // a field at a time, each loop is the same call into the same array
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_POSITION) _position[i] = vexMotorPositionGet(_ports[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_RAW) _raw[i] = vexMotorPositionRawGet(_ports[i], &_raw_time[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_VELOCITY) _velocity[i] = vexMotorActualVelocityGet(_ports[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_CURRENT) _current[i] = vexMotorCurrentGet(_ports[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_VOLTAGE) _voltage[i] = vexMotorVoltageGet(_ports[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_TEMPERATURE) _temperature[i] = vexMotorTemperatureGet(_ports[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_TORQUE) _torque[i] = vexMotorTorqueGet(_ports[i]);
+  }
+  for (uint32_t i = 0; i < _count; i++) {
+    if (_fields[i] & MOTOR_EFFICIENCY) _efficiency[i] = vexMotorEfficiencyGet(_ports[i]);
+  }
+
+  _duration = (uint32_t)(vexSystemHighResTimeGet() - _timestamp);
+  _sequence++;
+}
+
+int32_t motor_cache::slot(int32_t port) const {
+  return port >= 0 && port < V5_MAX_DEVICE_PORTS ? _slot[port] : -1;
+}
+
+bool motor_cache::has(int32_t port, uint32_t fields) const {
+  int32_t i = slot(port);
+  return i >= 0 && (_fields[i] & fields) == fields;
+}
+
+double motor_cache::position(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _position[i] : 0;
+}
+
+int32_t motor_cache::raw(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _raw[i] : 0;
+}
+
+uint32_t motor_cache::raw_time(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _raw_time[i] : 0;
+}
+
+double motor_cache::velocity(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _velocity[i] : 0;
+}
+
+int32_t motor_cache::current(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _current[i] : 0;
+}
+
+int32_t motor_cache::voltage(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _voltage[i] : 0;
+}
+
+double motor_cache::temperature(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _temperature[i] : 0;
+}
+
+double motor_cache::torque(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _torque[i] : 0;
+}
+
+double motor_cache::efficiency(int32_t port) const {
+  int32_t i = slot(port);
+  return i >= 0 ? _efficiency[i] : 0;
+}
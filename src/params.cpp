@@ -0,0 +1,268 @@
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "telemetry.h"
+#include "params.h"
+
+
+// the parameters themselves
+#define PARAM_DEFINE(name, type, value, min, max) param<type> param_##name(value, min, max);
+PARAM_LIST(PARAM_DEFINE)
+#undef PARAM_DEFINE
+
+
+// name lookup table
+enum param_kind {
+  KIND_INT,
+  KIND_FLOAT
+};
+
+struct param_entry {
+  const char *name;
+  param_kind kind;
+  void *ptr;
+};
+
+template <class T> static constexpr param_kind kind_of();
+template <> constexpr param_kind kind_of<int32_t>() { return KIND_INT; }
+template <> constexpr param_kind kind_of<float>() { return KIND_FLOAT; }
+
+#define PARAM_ENTRY(name, type, value, min, max) { #name, kind_of<type>(), &param_##name },
+static const param_entry entries[] = {
+  PARAM_LIST(PARAM_ENTRY)
+};
+#undef PARAM_ENTRY
+
+#define PARAM_COUNT (sizeof(entries) / sizeof(entries[0]))
+
+static std::atomic<uint32_t> version(0);
+
+
+static const param_entry *find(const char *name, uint32_t len) {
+  for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+    if (strlen(entries[i].name) == len && strncmp(entries[i].name, name, len) == 0) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+static bool set_entry(const param_entry *entry, const char *value) {
+  char *end;
+  bool ok = false;
+
+  switch (entry->kind) {
+    case KIND_INT: {
+      long v = strtol(value, &end, 0);
+      ok = end != value && ((param<int32_t> *)entry->ptr)->set((int32_t)v);
+      break;
+    }
+
+    case KIND_FLOAT: {
+      float v = strtof(value, &end);
+      ok = end != value && ((param<float> *)entry->ptr)->set(v);
+      break;
+    }
+  }
+
+  if (ok) {
+    version.fetch_add(1, std::memory_order_release);
+  }
+  return ok;
+}
+
+static int32_t format_entry(const param_entry *entry, char *out, uint32_t len) {
+  switch (entry->kind) {
+    case KIND_INT:
+      return snprintf(out, len, "%ld", (long)((param<int32_t> *)entry->ptr)->get());
+
+    case KIND_FLOAT:
+      return snprintf(out, len, "%g", (double)((param<float> *)entry->ptr)->get());
+  }
+  return 0;
+}
+
+
+uint32_t params_version(void) {
+  return version.load(std::memory_order_acquire);
+}
+
+bool params_set(const char *name, const char *value) {
+  const param_entry *entry = find(name, strlen(name));
+  return entry != NULL && set_entry(entry, value);
+}
+
+bool params_get(const char *name, char *out, uint32_t len) {
+  const param_entry *entry = find(name, strlen(name));
+  if (entry == NULL) {
+    return false;
+  }
+  format_entry(entry, out, len);
+  return true;
+}
+
+int32_t params_parse(const char *text, uint32_t len) {
+  int32_t count = 0;
+  uint32_t pos = 0;
+
+  while (pos < len) {
+    // grab one line
+    uint32_t start = pos;
+    while (pos < len && text[pos] != '\n') {
+      pos++;
+    }
+    uint32_t end = pos++;
+
+    // trim
+    while (start < end && isspace((unsigned char)text[start])) start++;
+    while (end > start && isspace((unsigned char)text[end - 1])) end--;
+
+    // blank, comment or section header
+    if (start == end || text[start] == '#' || text[start] == ';' || text[start] == '[') {
+      continue;
+    }
+
+    const char *eq = (const char *)memchr(text + start, '=', end - start);
+    if (eq == NULL) {
+      continue;
+    }
+
+    uint32_t name_end = eq - text;
+    while (name_end > start && isspace((unsigned char)text[name_end - 1])) name_end--;
+
+    // value needs to be null terminated for strtol
+    char value[32];
+    uint32_t value_start = eq - text + 1;
+    uint32_t value_len = end - value_start;
+    if (value_len >= sizeof(value)) {
+      continue;
+    }
+    memcpy(value, text + value_start, value_len);
+    value[value_len] = '\0';
+
+    const param_entry *entry = find(text + start, name_end - start);
+    if (entry != NULL && set_entry(entry, value)) {
+      count++;
+    }
+    else {
+      telemetry_printf("params: skipped line \"%.*s\"\n", (int)(end - start), text + start);
+    }
+  }
+
+  return count;
+}
+
+
+// sd card
+static uint8_t file_buffer[PARAMS_FILE_MAX];
+
+int32_t params_load(const char *filename) {
+  vex::brain::sdcard sd;
+  if (!sd.isInserted()) {
+    return -1;
+  }
+
+  int32_t len = sd.loadfile(filename, file_buffer, sizeof(file_buffer));
+  if (len <= 0) {
+    return -1;
+  }
+
+  return params_parse((const char *)file_buffer, len);
+}
+
+int32_t params_save(const char *filename) {
+  vex::brain::sdcard sd;
+  if (!sd.isInserted()) {
+    return -1;
+  }
+
+  int32_t len = 0;
+  for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+    char value[32];
+    format_entry(&entries[i], value, sizeof(value));
+
+    int32_t room = sizeof(file_buffer) - len;
+    int32_t n = snprintf((char *)file_buffer + len, room, "%s = %s\n", entries[i].name, value);
+    if (n >= room) {
+      return -1;
+    }
+    len += n;
+  }
+
+  return sd.savefile(filename, file_buffer, len);
+}
+
+
+// serial console
+static char line[64];
+static uint32_t line_len = 0;
+
+static void run_command(char *cmd) {
+  char *verb = strtok(cmd, " \t");
+  char *name = strtok(NULL, " \t");
+  char *value = strtok(NULL, " \t");
+  char text[32];
+
+  if (verb == NULL) {
+    return;
+  }
+
+  if (strcmp(verb, "set") == 0 && name != NULL && value != NULL) {
+    telemetry_printf("%s %s\n", name, params_set(name, value) ? "ok" : "rejected");
+  }
+  else if (strcmp(verb, "get") == 0 && name != NULL) {
+    if (params_get(name, text, sizeof(text))) {
+      telemetry_printf("%s = %s\n", name, text);
+    }
+    else {
+      telemetry_printf("%s unknown\n", name);
+    }
+  }
+  else if (strcmp(verb, "list") == 0) {
+    for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+      format_entry(&entries[i], text, sizeof(text));
+      telemetry_printf("%s = %s\n", entries[i].name, text);
+    }
+  }
+  else if (strcmp(verb, "save") == 0) {
+    telemetry_printf("save %s\n", params_save(PARAMS_FILE) >= 0 ? "ok" : "failed");
+  }
+  else if (strcmp(verb, "load") == 0) {
+    telemetry_printf("load %ld\n", (long)params_load(PARAMS_FILE));
+  }
+  else if (strcmp(verb, "reset") == 0) {
+    #define PARAM_RESET(name, type, value, min, max) param_##name.reset();
+    PARAM_LIST(PARAM_RESET)
+    #undef PARAM_RESET
+    version.fetch_add(1, std::memory_order_release);
+    telemetry_printf("reset ok\n");
+  }
+  else {
+    telemetry_printf("? set <name> <value> | get <name> | list | save | load | reset\n");
+  }
+}
+
+void params_console_poll(void) {
+  int32_t c;
+
+  while ((c = vexSerialReadChar(PARAMS_CONSOLE_CHANNEL)) >= 0) {
+    if (c == '\r' || c == '\n') {
+      line[line_len] = '\0';
+      line_len = 0;
+      run_command(line);
+      continue;
+    }
+
+    // overlong lines just get cut off
+    if (line_len < sizeof(line) - 1) {
+      line[line_len++] = (char)c;
+    }
+  }
+}
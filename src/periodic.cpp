@@ -0,0 +1,159 @@
+
+// standard libs
+#include <stdio.h>
+
+// vex api and macros
+#include "vex.h"
+#include "telemetry.h"
+#include "periodic.h"
+
+
+// every task that has started, for the report
+static periodic_task *tasks[PERIODIC_MAX_TASKS];
+static std::atomic<int32_t> task_count(0);
+
+// how thin the best effort tasks are spread, only control tasks move it
+static std::atomic<uint32_t> stretch(1);
+static uint32_t clean_runs = 0;
+
+
+// a control run finished, on time or not
+static void control_done(bool overrun) {
+  uint32_t now = stretch.load(std::memory_order_relaxed);
+
+  if (overrun) {
+    clean_runs = 0;
+    stretch.store(now * 2 < PERIODIC_MAX_STRETCH ? now * 2 : PERIODIC_MAX_STRETCH, std::memory_order_relaxed);
+    return;
+  }
+
+  // back one step at a time, not all at once into the same overload
+  if (now > 1 && ++clean_runs >= PERIODIC_RECOVER_TICKS) {
+    clean_runs = 0;
+    stretch.store(now / 2, std::memory_order_relaxed);
+  }
+}
+
+
+periodic_task::periodic_task(const char *name, uint32_t period, uint32_t deadline, periodic_kind kind, void (*tick)(void)) {
+  _name = name;
+  _period = period > 0 ? period : 1;
+  _deadline = deadline;
+  _kind = kind;
+  _tick = tick;
+  _timing = NULL;
+  _cpu = NULL;
+  _release = 0;
+  _releases = 0;
+  _start = 0;
+  _due = 0;
+  _runs.store(0, std::memory_order_relaxed);
+  _overruns.store(0, std::memory_order_relaxed);
+  _shed.store(0, std::memory_order_relaxed);
+  _skipped.store(0, std::memory_order_relaxed);
+}
+
+void periodic_task::start(void) {
+  _timing = latency_register(_name, _period);
+  _cpu = profile_register(_name);
+  _release = vexSystemTimeGet();
+
+  int32_t index = task_count.load(std::memory_order_relaxed);
+  if (index < PERIODIC_MAX_TASKS) {
+    tasks[index] = this;
+    task_count.store(index + 1, std::memory_order_release);
+  }
+}
+
+void periodic_task::run(void) {
+  while (true) {
+    vex::this_thread::sleep_until(_release);
+    if (begin()) {
+      _tick();
+      end();
+    }
+  }
+}
+
+bool periodic_task::begin(void) {
+  uint64_t now = vexSystemHighResTimeGet();
+  uint64_t release = (uint64_t)_release * 1000;
+  _release += _period;
+  _releases++;
+
+  // a whole period (or more) late, the releases in between are gone and
+  // the next one is the first still ahead of us
+  if (now >= (uint64_t)_release * 1000) {
+    uint32_t missed = (uint32_t)((now / 1000 - _release) / _period) + 1;
+    _skipped.store(_skipped.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+    _release += missed * _period;
+    _releases += missed;
+  }
+
+  if (_kind == PERIODIC_BEST_EFFORT && _releases % stretch.load(std::memory_order_relaxed) != 0) {
+    _shed.store(_shed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (_cpu != NULL) {
+    profile_enter(_cpu);
+  }
+  _start = now;
+  _due = release + (uint64_t)_deadline * 1000;
+  if (_timing != NULL) {
+    latency_record(&_timing->late, (uint32_t)(now > release ? now - release : 0));
+    _timing->next_us = now + _timing->period_us;  // when the crash recorder expects it back
+  }
+  return true;
+}
+
+void periodic_task::end(void) {
+  uint64_t now = vexSystemHighResTimeGet();
+  bool overrun = now > _due;
+
+  _runs.store(_runs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (overrun) {
+    _overruns.store(_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+  if (_timing != NULL) {
+    latency_record(&_timing->run, (uint32_t)(now - _start));
+  }
+  if (_cpu != NULL) {
+    profile_leave(_cpu);
+  }
+
+  if (_kind == PERIODIC_CONTROL) {
+    control_done(overrun);
+  }
+}
+
+void periodic_task::yield(void) {
+  if (_cpu != NULL) {
+    profile_leave(_cpu);
+  }
+  vex::this_thread::yield();
+  if (_cpu != NULL) {
+    profile_enter(_cpu);
+  }
+}
+
+
+uint32_t periodic_stretch(void) {
+  return stretch.load(std::memory_order_relaxed);
+}
+
+void periodic_print(void) {
+  int32_t count = task_count.load(std::memory_order_acquire);
+
+  telemetry_printf("periodic (ms) period/deadline, best effort every %lu\n", (unsigned long)periodic_stretch());
+  for (int32_t i = 0; i < count; i++) {
+    const periodic_task *task = tasks[i];
+    telemetry_printf("%-8s %lu/%lu %s runs %lu over %lu shed %lu skipped %lu late max %luus\n",
+      task->name(),
+      (unsigned long)task->period(), (unsigned long)task->deadline(),
+      task->kind() == PERIODIC_CONTROL ? "control" : "best effort",
+      (unsigned long)task->runs(), (unsigned long)task->overruns(),
+      (unsigned long)task->shed(), (unsigned long)task->skipped(),
+      (unsigned long)(task->timing() != NULL ? task->timing()->late.max.load(std::memory_order_relaxed) : 0));
+  }
+}
@@ -0,0 +1,234 @@
+
+// standard libs
+#include <stdio.h>
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "pose.h"
+
+
+// wrap an angle into -pi..pi
+static double wrap(double radians) {
+  radians = fmod(radians + M_PI, 2 * M_PI);
+  return radians < 0 ? radians + M_PI : radians - M_PI;
+}
+
+static double wheel_meters(double degrees) {
+  return degrees / 360.0 * M_PI * DRIVE_WHEEL_DIAMETER;
+}
+
+
+pose_filter::pose_filter(const landmark *landmarks, uint32_t count) {
+  _landmarks = landmarks;
+  _landmark_count = count;
+  reset({ 0, 0, 0 });
+}
+
+void pose_filter::reset(const pose &start) {
+  _x(0, 0) = start.x;
+  _x(1, 0) = start.y;
+  _x(2, 0) = wrap(start.theta);
+
+  // we know where we start to about a couple of cm and a degree
+  _p = matrix<3, 3>::zero();
+  _p(0, 0) = _p(1, 1) = 0.02 * 0.02;
+  _p(2, 2) = 0.02 * 0.02;
+
+  _have_wheels = false;
+  _last_left = _last_right = 0;
+  _have_imu = false;
+  _imu_offset = 0;
+  _accepted = _rejected = 0;
+}
+
+void pose_filter::predict(double left_deg, double right_deg) {
+  if (!_have_wheels) {
+    _have_wheels = true;
+    _last_left = left_deg;
+    _last_right = right_deg;
+    return;
+  }
+
+  double dl = wheel_meters(left_deg - _last_left);
+  double dr = wheel_meters(right_deg - _last_right);
+  _last_left = left_deg;
+  _last_right = right_deg;
+
+  // arc between the two samples, integrated at its midpoint heading
+  double ds = (dl + dr) / 2;
+  double dth = (dr - dl) / DRIVE_TRACK_WIDTH;
+  double mid = _x(2, 0) + dth / 2;
+  double c = cos(mid), s = sin(mid);
+
+  _x(0, 0) += ds * c;
+  _x(1, 0) += ds * s;
+  _x(2, 0) = wrap(_x(2, 0) + dth);
+
+  // state jacobian
+  matrix<3, 3> f = matrix<3, 3>::identity();
+  f(0, 2) = -ds * s;
+  f(1, 2) = ds * c;
+
+  // wheel jacobian, each side's noise grows with how far it went
+  double k = ds / (2 * DRIVE_TRACK_WIDTH);
+  matrix<3, 2> j;
+  j(0, 0) = 0.5 * c + k * s;  j(0, 1) = 0.5 * c - k * s;
+  j(1, 0) = 0.5 * s - k * c;  j(1, 1) = 0.5 * s + k * c;
+  j(2, 0) = -1 / DRIVE_TRACK_WIDTH;
+  j(2, 1) = 1 / DRIVE_TRACK_WIDTH;
+
+  matrix<2, 2> n = matrix<2, 2>::zero();
+  n(0, 0) = POSE_WHEEL_NOISE * fabs(dl);
+  n(1, 1) = POSE_WHEEL_NOISE * fabs(dr);
+
+  _p = f * _p * f.transpose() + j * n * j.transpose();
+  _p.symmetrize();
+}
+
+bool pose_filter::correct(const matrix<1, 3> &h, double innovation, double noise, bool gate) {
+  matrix<3, 1> pht = _p * h.transpose();
+  double s = (h * pht)(0, 0) + noise * noise;
+
+  // innovation more than POSE_GATE sigma squared out is not what we think it is
+  if (gate && innovation * innovation / s > POSE_GATE) {
+    _rejected++;
+    return false;
+  }
+
+  matrix<3, 1> k = pht * (1 / s);
+  _x = _x + k * innovation;
+  _x(2, 0) = wrap(_x(2, 0));
+
+  _p = (matrix<3, 3>::identity() - k * h) * _p;
+  _p.symmetrize();
+  _accepted++;
+  return true;
+}
+
+void pose_filter::update_heading(double imu_deg) {
+  // imu is clockwise and starts wherever it was calibrated, line it up
+  // with the filter on the first reading
+  double measured = -imu_deg * M_PI / 180;
+  if (!_have_imu) {
+    _have_imu = true;
+    _imu_offset = _x(2, 0) - measured;
+    return;
+  }
+
+  matrix<1, 3> h = matrix<1, 3>::zero();
+  h(0, 2) = 1;
+  correct(h, wrap(measured + _imu_offset - _x(2, 0)), POSE_IMU_NOISE, false);
+}
+
+bool pose_filter::update_bearing(uint8_t signature, double bearing) {
+  int best = -1;
+  double best_distance = 0;
+  double best_innovation = 0;
+  matrix<1, 3> best_h;
+
+  // nearest landmark with this signature (in sigmas, not meters)
+  for (uint32_t i = 0; i < _landmark_count; i++) {
+    if (_landmarks[i].signature != signature) {
+      continue;
+    }
+
+    double dx = _landmarks[i].x - _x(0, 0);
+    double dy = _landmarks[i].y - _x(1, 0);
+    double q = dx * dx + dy * dy;
+    if (q < 0.01) {
+      continue;
+    }
+
+    matrix<1, 3> h;
+    h(0, 0) = dy / q;
+    h(0, 1) = -dx / q;
+    h(0, 2) = -1;
+
+    double innovation = wrap(bearing - (atan2(dy, dx) - _x(2, 0)));
+    double s = (h * _p * h.transpose())(0, 0) + POSE_BEARING_NOISE * POSE_BEARING_NOISE;
+    double distance = innovation * innovation / s;
+    if (best < 0 || distance < best_distance) {
+      best = i;
+      best_distance = distance;
+      best_innovation = innovation;
+      best_h = h;
+    }
+  }
+
+  if (best < 0) {
+    _rejected++;
+    return false;
+  }
+  return correct(best_h, best_innovation, POSE_BEARING_NOISE, true);
+}
+
+void pose_filter::step(const pose_sample &sample) {
+  predict(sample.left, sample.right);
+  update_heading(sample.heading);
+  if (sample.signature != 0) {
+    update_bearing(sample.signature, vision_bearing(sample.x_center));
+  }
+}
+
+pose pose_filter::get(void) const {
+  return { _x(0, 0), _x(1, 0), _x(2, 0) };
+}
+
+double pose_filter::sigma_xy(void) const {
+  return sqrt(_p(0, 0) + _p(1, 1));
+}
+
+double pose_filter::sigma_theta(void) const {
+  return sqrt(_p(2, 2));
+}
+
+
+double vision_bearing(int32_t x_center) {
+  // pinhole, so the angle goes with the tangent and not the pixel
+  double half = VISION_WIDTH / 2.0;
+  double focal = half / tan(VISION_FOV * M_PI / 360);
+  return atan2(half - x_center, focal);
+}
+
+
+void pose_log::add(const pose_sample &sample) {
+  if (!_closed && _count < POSE_LOG_SAMPLES) {
+    _samples[_count++] = sample;
+  }
+}
+
+int32_t pose_log::save(const char *filename, const landmark *landmarks, uint32_t count, void (*pause)(void)) {
+  char line[96];
+
+  FIL *file = vexFileOpenCreate(filename);
+  if (file == NULL) {
+    return -1;
+  }
+
+  int32_t len = snprintf(line, sizeof(line), "# start %.3f %.3f %.4f\n", _start.x, _start.y, _start.theta);
+  vexFileWrite(line, 1, len, file);
+
+  for (uint32_t i = 0; i < count; i++) {
+    len = snprintf(line, sizeof(line), "# landmark %u %.3f %.3f\n",
+                   landmarks[i].signature, landmarks[i].x, landmarks[i].y);
+    vexFileWrite(line, 1, len, file);
+  }
+
+  len = snprintf(line, sizeof(line), "time_ms,left_deg,right_deg,heading_deg,signature,x_center\n");
+  vexFileWrite(line, 1, len, file);
+
+  for (uint32_t i = 0; i < _count; i++) {
+    if (i % POSE_LOG_CHUNK == 0) {
+      pause();
+    }
+    const pose_sample &s = _samples[i];
+    len = snprintf(line, sizeof(line), "%lu,%.2f,%.2f,%.3f,%u,%d\n", (unsigned long)s.time,
+                   s.left, s.right, s.heading, s.signature, s.x_center);
+    vexFileWrite(line, 1, len, file);
+  }
+
+  vexFileClose(file);
+  return _count;
+}
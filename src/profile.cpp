@@ -0,0 +1,203 @@
+
+// standard libs
+#include <stdio.h>
+#include <string.h>
+
+// vex api and macros
+#include "vex.h"
+#include "telemetry.h"
+#include "profile.h"
+
+// enter/leave pairs timed to work out what one costs
+#define CALIBRATE_PAIRS 64
+
+
+// task table, filled in at startup
+static profile_task tasks[PROFILE_MAX_TASKS];
+static std::atomic<int32_t> task_count(0);
+
+// bumped by each update, tasks see it and start a new longest
+static std::atomic<uint32_t> window(0);
+static uint64_t window_start = 0;
+static bool started = false;
+static std::atomic<uint32_t> other(0);
+static std::atomic<uint32_t> overhead(0);
+static uint32_t pair_ns = 0;
+
+
+static void task_reset(profile_task *task, const char *name) {
+  task->name = name;
+  task->entered = 0;
+  task->depth = 0;
+  task->window = 0;
+  task->busy.store(0, std::memory_order_relaxed);
+  task->runs.store(0, std::memory_order_relaxed);
+  task->longest.store(0, std::memory_order_relaxed);
+  task->longest_ever.store(0, std::memory_order_relaxed);
+  task->last_busy = 0;
+  task->last_runs = 0;
+  task->permille.store(0, std::memory_order_relaxed);
+  task->worst.store(0, std::memory_order_relaxed);
+}
+
+// what one enter/leave pair costs on this cpu, timed on a task of our own
+static uint32_t calibrate(void) {
+  static profile_task probe;
+  task_reset(&probe, "probe");
+
+  uint64_t start = vexSystemHighResTimeGet();
+  for (int i = 0; i < CALIBRATE_PAIRS; i++) {
+    profile_enter(&probe);
+    profile_leave(&probe);
+  }
+  return (uint32_t)((vexSystemHighResTimeGet() - start) * 1000 / CALIBRATE_PAIRS);
+}
+
+
+profile_task *profile_register(const char *name) {
+  int32_t index = task_count.load(std::memory_order_relaxed);
+  if (index >= PROFILE_MAX_TASKS) {
+    return NULL;
+  }
+
+  profile_task *task = &tasks[index];
+  task_reset(task, name);
+
+  // publish after the slot is filled so readers never see half a task
+  task_count.store(index + 1, std::memory_order_release);
+  return task;
+}
+
+void profile_enter(profile_task *task) {
+  if (task == NULL) {
+    return;
+  }
+  if (task->depth++ == 0) {
+    task->entered = vexSystemHighResTimeGet();
+  }
+}
+
+void profile_leave(profile_task *task) {
+  if (task == NULL || task->depth == 0 || --task->depth > 0) {
+    return;
+  }
+
+  uint32_t run = (uint32_t)(vexSystemHighResTimeGet() - task->entered);
+  task->busy.store(task->busy.load(std::memory_order_relaxed) + run, std::memory_order_relaxed);
+  task->runs.store(task->runs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  // first run since an update starts the window's longest over
+  uint32_t now_window = window.load(std::memory_order_relaxed);
+  if (task->window != now_window) {
+    task->window = now_window;
+    task->longest.store(0, std::memory_order_relaxed);
+  }
+  if (run > task->longest.load(std::memory_order_relaxed)) {
+    task->longest.store(run, std::memory_order_relaxed);
+  }
+  if (run > task->longest_ever.load(std::memory_order_relaxed)) {
+    task->longest_ever.store(run, std::memory_order_relaxed);
+  }
+}
+
+void profile_update(void) {
+  uint64_t now = vexSystemHighResTimeGet();
+  if (pair_ns == 0) {
+    pair_ns = calibrate();
+    pair_ns = pair_ns > 0 ? pair_ns : 1;
+  }
+
+  // the first call only starts the window
+  uint64_t length = started ? now - window_start : 0;
+  window_start = now;
+  started = true;
+
+  int32_t count = task_count.load(std::memory_order_acquire);
+  uint32_t current = window.load(std::memory_order_relaxed);
+  uint64_t marked = 0;
+  uint64_t pairs = 0;
+  for (int32_t i = 0; i < count; i++) {
+    profile_task *task = &tasks[i];
+    uint32_t busy = task->busy.load(std::memory_order_relaxed);
+    uint32_t runs = task->runs.load(std::memory_order_relaxed);
+    uint32_t ran = busy - task->last_busy;
+    task->last_busy = busy;
+    pairs += runs - task->last_runs;
+    task->last_runs = runs;
+    marked += ran;
+
+    // a task that didnt finish a run this window still has last window's
+    // longest in the slot
+    uint32_t worst = task->window == current ? task->longest.load(std::memory_order_relaxed) : 0;
+    task->worst.store(worst, std::memory_order_relaxed);
+    task->permille.store(length > 0 ? (uint32_t)(ran * 1000 / length) : 0, std::memory_order_relaxed);
+  }
+
+  uint32_t share = length > 0 ? (uint32_t)(marked * 1000 / length) : 0;
+  other.store(share < 1000 ? 1000 - share : 0, std::memory_order_relaxed);
+  // ns over us is already thousandths, ten times that is hundredths of a percent
+  overhead.store(length > 0 ? (uint32_t)(pairs * pair_ns * 10 / length) : 0, std::memory_order_relaxed);
+  window.store(current + 1, std::memory_order_relaxed);
+}
+
+int32_t profile_task_count(void) {
+  return task_count.load(std::memory_order_acquire);
+}
+
+const profile_task *profile_task_at(int32_t index) {
+  return index >= 0 && index < profile_task_count() ? &tasks[index] : NULL;
+}
+
+uint32_t profile_other(void) {
+  return other.load(std::memory_order_relaxed);
+}
+
+uint32_t profile_overhead(void) {
+  return overhead.load(std::memory_order_relaxed);
+}
+
+
+// format one task as a single line
+// name: percent of the cpu, longest run last window/ever (us)
+static int32_t format_task(char *out, uint32_t len, const profile_task *task) {
+  uint32_t permille = task->permille.load(std::memory_order_relaxed);
+  return snprintf(out, len, "%-8s %3lu.%lu%% longest %lu/%lu",
+    task->name,
+    (unsigned long)(permille / 10), (unsigned long)(permille % 10),
+    (unsigned long)task->worst.load(std::memory_order_relaxed),
+    (unsigned long)task->longest_ever.load(std::memory_order_relaxed));
+}
+
+static int32_t format_rest(char *out, uint32_t len) {
+  uint32_t permille = other.load(std::memory_order_relaxed);
+  uint32_t cost = overhead.load(std::memory_order_relaxed);
+  return snprintf(out, len, "%-8s %3lu.%lu%% (profiling %lu.%02lu%%)", "other",
+    (unsigned long)(permille / 10), (unsigned long)(permille % 10),
+    (unsigned long)(cost / 100), (unsigned long)(cost % 100));
+}
+
+void profile_print(void) {
+  char line[96];
+  int32_t count = task_count.load(std::memory_order_acquire);
+
+  telemetry_printf("cpu (us) longest last window/ever\n");
+  for (int i = 0; i < count; i++) {
+    format_task(line, sizeof(line), &tasks[i]);
+    telemetry_printf("%s\n", line);
+  }
+  format_rest(line, sizeof(line));
+  telemetry_printf("%s\n", line);
+}
+
+void profile_draw(int32_t line) {
+  char text[96];
+  int32_t count = task_count.load(std::memory_order_acquire);
+
+  vexDisplayString(line, "cpu (us) longest last window/ever");
+  for (int i = 0; i < count; i++) {
+    format_task(text, sizeof(text), &tasks[i]);
+    vexDisplayString(line + 1 + i, "%s", text);
+  }
+  format_rest(text, sizeof(text));
+  vexDisplayString(line + 1 + count, "%s", text);
+}
@@ -0,0 +1,113 @@
+
+// standard libs
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "slew.h"
+
+
+current_budget::current_budget(double limit) {
+  _limit = limit;
+  _total = 0;
+  _count = 0;
+  for (int i = 0; i < SLEW_MAX_GROUPS; i++) {
+    _demand[i] = 0;
+  }
+}
+
+int32_t current_budget::join(void) {
+  return _count < SLEW_MAX_GROUPS ? (int32_t)_count++ : -1;
+}
+
+double current_budget::share(int32_t slot, double demand) {
+  if (slot < 0 || slot >= (int32_t)_count) {
+    return 1;
+  }
+
+  _total += demand - _demand[slot];
+  _demand[slot] = demand;
+
+  // over budget everyone gets the same fraction of what they asked for
+  return _total > _limit ? _limit / _total : 1;
+}
+
+
+slew_group::slew_group(void) {
+  _limits = { 0, 0 };
+  _full_scale = 1;
+  _stall_rate = 0;
+  _stall = 0;
+  _budget = NULL;
+  _slot = -1;
+  reset(0);
+}
+
+slew_group::slew_group(const slew_limits &limits, double full_scale, double stall_rate, double stall,
+                       current_budget *budget) {
+  _limits = limits;
+  _full_scale = full_scale;
+  _stall_rate = stall_rate;
+  _stall = stall;
+  _budget = budget;
+  _slot = budget != NULL ? budget->join() : -1;
+  reset(0);
+}
+
+void slew_group::reset(double output) {
+  _output = output;
+  _rate = 0;
+  _last_us = 0;
+  _demand = 0;
+  _fraction = 1;
+  if (_budget != NULL) {
+    _budget->share(_slot, 0);
+  }
+}
+
+double slew_group::step(double target, double actual) {
+  if (!shaping()) {
+    _output = target;
+    return target;
+  }
+
+  // the first step after a reset counts as a normal tick
+  uint64_t now = vexSystemHighResTimeGet();
+  double dt = _last_us != 0 ? fmin((now - _last_us) / 1e6, SLEW_MAX_DT) : DRIVE_PERIOD / 1000.0;
+  _last_us = now;
+
+  double gap = target - _output;
+  if (gap == 0) {
+    _rate = 0;
+  } else {
+    // fastest rate that can still ease back to nothing by the target,
+    // and the rate only changes as fast as the jerk limit lets it
+    double want = copysign(fmin(_limits.accel, sqrt(2 * _limits.jerk * fabs(gap))), gap);
+    double change = _limits.jerk * dt;
+    _rate += fmax(-change, fmin(change, want - _rate));
+    _output += _rate * dt;
+
+    // arrived (or would have gone past)
+    if ((gap > 0 && _output >= target) || (gap < 0 && _output <= target)) {
+      _output = target;
+      _rate = 0;
+    }
+  }
+
+  // current goes with how far the command is ahead of the motors and
+  // how hard it is asking them to accelerate
+  double ahead = _output - actual;
+  double load = fabs(ahead) / _full_scale + (_stall_rate > 0 ? fabs(_rate) / _stall_rate : 0);
+  _demand = _stall * fmin(1, load);
+
+  // over budget, come back toward what the motors are doing and ramp
+  // slower by the same fraction
+  _fraction = _budget != NULL ? _budget->share(_slot, _demand) : 1;
+  if (_fraction < 1) {
+    _output = actual + ahead * _fraction;
+    _rate *= _fraction;
+  }
+
+  return _output;
+}
@@ -0,0 +1,230 @@
+
+// standard libs
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "telemetry.h"
+
+// NOTE: vex tasks are cooperative, a send never gets interrupted halfway
+// by another task so there is no lock around the counters or the buffer
+
+
+// per type decimation state
+struct decimator {
+  uint32_t every; // send one in this many
+  uint32_t count;
+  uint32_t clean; // sends in a row with room to spare
+};
+
+static decimator decimators[TELEM_TYPE_COUNT];
+static uint8_t seq = 0;
+static telemetry_stats stats = {0, 0, 0};
+
+// biggest free space we have ever seen, our guess at the buffer size
+static int32_t capacity = 0;
+
+
+uint8_t telemetry_crc8(const uint8_t *data, uint32_t len) {
+  // crc-8 poly 0x07, small enough that a table isnt worth the ram
+  uint8_t crc = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+uint32_t telemetry_cobs_encode(const uint8_t *in, uint32_t len, uint8_t *out) {
+  uint32_t code_at = 0;
+  uint32_t write = 1;
+  uint8_t code = 1;
+
+  for (uint32_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[code_at] = code;
+      code_at = write++;
+      code = 1;
+      continue;
+    }
+
+    out[write++] = in[i];
+    code++;
+
+    // block is full, start a new one
+    if (code == 0xFF) {
+      out[code_at] = code;
+      code_at = write++;
+      code = 1;
+    }
+  }
+
+  out[code_at] = code;
+  return write;
+}
+
+int32_t telemetry_cobs_decode(const uint8_t *in, uint32_t len, uint8_t *out) {
+  uint32_t read = 0;
+  uint32_t write = 0;
+
+  while (read < len) {
+    uint8_t code = in[read++];
+    if (code == 0 || read + code - 1 > len) {
+      return -1;
+    }
+
+    for (uint8_t i = 1; i < code; i++) {
+      if (in[read] == 0) {
+        return -1;
+      }
+      out[write++] = in[read++];
+    }
+
+    // a full block has no implied zero after it, neither does the last one
+    if (code != 0xFF && read < len) {
+      out[write++] = 0;
+    }
+  }
+
+  return write;
+}
+
+
+// decide whether this record makes the cut
+static bool decimate(decimator *d) {
+  if (++d->count < d->every) {
+    return true;
+  }
+  d->count = 0;
+  return false;
+}
+
+// the link could not keep up, back this type off
+static void back_off(decimator *d) {
+  if (d->every < TELEMETRY_MAX_DECIMATE) {
+    d->every *= 2;
+  }
+  d->clean = 0;
+}
+
+// the link has plenty of room, slowly let this type back in
+static void recover(decimator *d, int32_t free) {
+  if (d->every <= 1) {
+    return;
+  }
+
+  if (free * 4 < capacity * 3) {
+    d->clean = 0;
+    return;
+  }
+
+  if (++d->clean >= TELEMETRY_RECOVER_SENDS) {
+    d->every /= 2;
+    d->clean = 0;
+  }
+}
+
+
+// frame it and hand it to the usb stack, or drop it if there is no room
+static bool put(uint8_t type, const void *payload, uint32_t len, decimator *d) {
+  // build the raw frame
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  uint32_t stamp = (uint32_t)vexSystemHighResTimeGet();
+  frame[0] = type;
+  frame[1] = seq;
+  memcpy(&frame[2], &stamp, sizeof(stamp));
+  memcpy(&frame[TELEMETRY_HEADER_SIZE], payload, len);
+  frame[TELEMETRY_HEADER_SIZE + len] = telemetry_crc8(frame, TELEMETRY_HEADER_SIZE + len);
+
+  uint8_t encoded[TELEMETRY_MAX_ENCODED];
+  uint32_t size = telemetry_cobs_encode(frame, TELEMETRY_HEADER_SIZE + len + 1, encoded);
+  encoded[size++] = 0;
+
+  // never block the caller, if it doesnt fit it gets dropped
+  int32_t free = vexSerialWriteFree(TELEMETRY_CHANNEL);
+  if (free > capacity) {
+    capacity = free;
+  }
+
+  if (free < (int32_t)size) {
+    stats.dropped++;
+    back_off(d);
+    return false;
+  }
+
+  vexSerialWriteBuffer(TELEMETRY_CHANNEL, encoded, size);
+  stats.sent++;
+  seq++;
+  recover(d, free - size);
+  return true;
+}
+
+bool telemetry_send(uint8_t type, const void *payload, uint32_t len) {
+  if (type >= TELEM_TYPE_COUNT || len > TELEMETRY_MAX_PAYLOAD) {
+    return false;
+  }
+
+  decimator *d = &decimators[type];
+  if (d->every == 0) {
+    d->every = 1;
+  }
+
+  if (decimate(d)) {
+    stats.decimated++;
+    return false;
+  }
+  return put(type, payload, len, d);
+}
+
+int32_t telemetry_printf(const char *format, ...) {
+  char text[TELEMETRY_TEXT_MAX];
+  va_list args;
+  va_start(args, format);
+  int32_t len = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  len = len < (int32_t)sizeof(text) ? len : (int32_t)sizeof(text) - 1;
+
+  // never decimated, a line with pieces missing is worse than none, and
+  // once one piece is dropped so is the rest
+  decimator *d = &decimators[TELEM_TEXT];
+  if (d->every == 0) {
+    d->every = 1;
+  }
+  int32_t sent = 0;
+  while (sent < len) {
+    uint32_t n = len - sent < TELEMETRY_MAX_PAYLOAD ? len - sent : TELEMETRY_MAX_PAYLOAD;
+    if (!put(TELEM_TEXT, &text[sent], n, d)) {
+      break;
+    }
+    sent += n;
+  }
+  return sent;
+}
+
+bool telemetry_send_stats(void) {
+  telemetry_stats copy = stats;
+  return telemetry_send(TELEM_STATS, &copy, sizeof(copy));
+}
+
+int32_t telemetry_flush(void) {
+  for (int i = 0; i < TELEM_TYPE_COUNT; i++) {
+    decimators[i].every = 1;
+    decimators[i].count = 0;
+    decimators[i].clean = 0;
+  }
+
+  int32_t free = vexSerialWriteFree(TELEMETRY_CHANNEL);
+  return free < capacity ? capacity - free : 0;
+}
+
+telemetry_stats telemetry_get_stats(void) {
+  return stats;
+}
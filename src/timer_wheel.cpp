@@ -0,0 +1,198 @@
+
+// standard libs
+#include <stddef.h>
+
+// vex api and macros
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define INDEX_BITS 16
+
+
+timer_wheel::timer_wheel(void) {
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      _slots[level][slot].next = _slots[level][slot].prev = &_slots[level][slot];
+    }
+  }
+  _due.next = _due.prev = &_due;
+  _free.next = _free.prev = &_free;
+
+  for (int i = 0; i < TIMER_WHEEL_MAX; i++) {
+    _pool[i].generation = 1;
+    link(&_free, &_pool[i]);
+  }
+
+  _running = NULL;
+  _now = 0;
+  _pending = 0;
+  _fired = 0;
+  _skipped = 0;
+  _max_late = 0;
+}
+
+void timer_wheel::link(node *head, node *n) {
+  n->prev = head->prev;
+  n->next = head;
+  head->prev->next = n;
+  head->prev = n;
+}
+
+void timer_wheel::unlink(node *n) {
+  n->prev->next = n->next;
+  n->next->prev = n->prev;
+  n->next = n->prev = n;
+}
+
+// the level is how far out it is, the slot is which of that level's
+// ticks it expires in
+void timer_wheel::place(node *n) {
+  int32_t delta = (int32_t)(n->expires - _now);
+  if (delta <= 0) {
+    link(&_due, n);
+    return;
+  }
+
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    if (level == TIMER_WHEEL_LEVELS - 1 || delta < (1 << (TIMER_WHEEL_BITS * (level + 1)))) {
+      // past the top level it just waits in the furthest slot and goes
+      // round again
+      uint32_t expires = n->expires;
+      if (delta >= (1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+        expires = _now + (1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+      }
+      link(&_slots[level][(expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK], n);
+      return;
+    }
+  }
+}
+
+// a higher level slot came round, everything in it is within one turn of
+// the level below now
+void timer_wheel::cascade(int level) {
+  node *head = &_slots[level][(_now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+  while (head->next != head) {
+    node *n = head->next;
+    unlink(n);
+    place(n);
+  }
+}
+
+timer_handle timer_wheel::handle(node *n) const {
+  return ((uint32_t)n->generation << INDEX_BITS) | (uint32_t)(n - _pool);
+}
+
+timer_wheel::node *timer_wheel::lookup(timer_handle timer) {
+  uint32_t index = timer & ((1 << INDEX_BITS) - 1);
+  if (index >= TIMER_WHEEL_MAX || _pool[index].generation != timer >> INDEX_BITS) {
+    return NULL;
+  }
+  return &_pool[index];
+}
+
+void timer_wheel::start(uint32_t now) {
+  _now = now;
+}
+
+timer_handle timer_wheel::add(uint32_t delay, uint32_t period, timer_callback callback, void *arg) {
+  if (_free.next == &_free || callback == NULL) {
+    return 0;
+  }
+
+  node *n = _free.next;
+  unlink(n);
+  n->expires = _now + delay;
+  n->period = period;
+  n->callback = callback;
+  n->arg = arg;
+  n->cancelled = false;
+  place(n);
+  _pending++;
+  return handle(n);
+}
+
+timer_handle timer_wheel::after(uint32_t delay, timer_callback callback, void *arg) {
+  return add(delay, 0, callback, arg);
+}
+
+timer_handle timer_wheel::every(uint32_t period, timer_callback callback, void *arg) {
+  if (period == 0) {
+    return 0;
+  }
+  return add(period, period, callback, arg);
+}
+
+bool timer_wheel::cancel(timer_handle timer) {
+  node *n = lookup(timer);
+  if (n == NULL || n->cancelled) {
+    return false;
+  }
+
+  // running right now, advance() frees it once the callback returns
+  if (n == _running) {
+    n->cancelled = true;
+    return true;
+  }
+
+  unlink(n);
+  n->generation = n->generation == 0xFFFF ? 1 : n->generation + 1;
+  link(&_free, n);
+  _pending--;
+  return true;
+}
+
+uint32_t timer_wheel::advance(uint32_t now) {
+  // one slot per ms, cascading whenever a level wraps
+  while ((int32_t)(now - _now) > 0) {
+    _now++;
+
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+      if ((_now & ((1 << (TIMER_WHEEL_BITS * level)) - 1)) != 0) {
+        break;
+      }
+      cascade(level);
+    }
+
+    // the whole slot is due, move it over in one go
+    node *slot = &_slots[0][_now & SLOT_MASK];
+    if (slot->next != slot) {
+      slot->next->prev = _due.prev;
+      _due.prev->next = slot->next;
+      slot->prev->next = &_due;
+      _due.prev = slot->prev;
+      slot->next = slot->prev = slot;
+    }
+  }
+
+  uint32_t ran = 0;
+  while (_due.next != &_due && ran < TIMER_WHEEL_BUDGET) {
+    node *n = _due.next;
+    unlink(n);
+
+    uint32_t late = _now - n->expires;
+    if (late > _max_late) {
+      _max_late = late;
+    }
+
+    _running = n;
+    n->callback(n->arg);
+    _running = NULL;
+    ran++;
+    _fired++;
+
+    if (n->period != 0 && !n->cancelled) {
+      // stay on the original beat, skipping any periods we were too late for
+      uint32_t missed = (_now - n->expires) / n->period;
+      _skipped += missed;
+      n->expires += (missed + 1) * n->period;
+      place(n);
+      continue;
+    }
+
+    n->generation = n->generation == 0xFFFF ? 1 : n->generation + 1;
+    link(&_free, n);
+    _pending--;
+  }
+
+  return ran;
+}
@@ -0,0 +1,64 @@
+
+// vex api and macros
+#include "vex.h"
+#include "triport_snapshot.h"
+
+
+// encoders and sonars take two ports but only report on the first one
+static bool is_pair(V5_AdiPortConfiguration config) {
+  return config == kAdiPortTypeQuadEncoder || config == kAdiPortTypeSonar;
+}
+
+
+triport_sampler::triport_sampler(int32_t index) {
+  _index = index;
+  _sequence = 0;
+  _mask = 0;
+  for (int i = 0; i < V5_ADI_PORT_NUM; i++) {
+    _config[i] = kAdiPortTypeUndefined;
+  }
+}
+
+void triport_sampler::refresh_config(void) {
+  _mask = 0;
+
+  for (int i = 0; i < V5_ADI_PORT_NUM; i++) {
+    _config[i] = vexAdiPortConfigGet(_index, i);
+    if (_config[i] == kAdiPortTypeUndefined) {
+      continue;
+    }
+
+    // outputs have nothing to read back
+    if (_config[i] == kAdiPortTypeAnalogOut || _config[i] == kAdiPortTypeDigitalOut
+        || _config[i] == kAdiPortTypeLegacyServo || _config[i] == kAdiPortTypeLegacyPwm
+        || _config[i] == kAdiPortTypeLegacyPwmSlew) {
+      continue;
+    }
+
+    // second half of a pair (pairs always start on A, C, E or G)
+    if ((i & 1) && is_pair(_config[i]) && _config[i - 1] == _config[i]) {
+      continue;
+    }
+
+    _mask |= 1 << i;
+  }
+}
+
+void triport_sampler::take(triport_snapshot *snap) {
+  snap->timestamp = vexSystemHighResTimeGet();
+
+  for (int i = 0; i < V5_ADI_PORT_NUM; i++) {
+    snap->value[i] = (_mask & (1 << i)) ? vexAdiValueGet(_index, i) : 0;
+  }
+
+  // give the second half of a pair the same value so either port works
+  for (int i = 1; i < V5_ADI_PORT_NUM; i += 2) {
+    if (is_pair(_config[i]) && _config[i - 1] == _config[i]) {
+      snap->value[i] = snap->value[i - 1];
+    }
+  }
+
+  snap->duration = (uint32_t)(vexSystemHighResTimeGet() - snap->timestamp);
+  snap->sequence = ++_sequence;
+  snap->mask = _mask;
+}
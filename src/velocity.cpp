@@ -0,0 +1,148 @@
+
+// standard libs
+#include <math.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "velocity.h"
+
+
+velocity_estimator::velocity_estimator(double counts_per_rev, velocity_method method) {
+  _method = method;
+  _counts_per_rev = counts_per_rev;
+  reset();
+}
+
+void velocity_estimator::reset(void) {
+  _rpm = 0;
+  _head = 0;
+  _size = 0;
+  _x[0] = _x[1] = 0;
+  _p[0][0] = _p[1][1] = 0;
+  _p[0][1] = _p[1][0] = 0;
+}
+
+bool velocity_estimator::update(uint64_t time_us, int32_t counts) {
+  double dt = 0;
+
+  if (_size > 0) {
+    if (time_us <= _time[_head]) {
+      return false;
+    }
+    dt = (time_us - _time[_head]) / 1e6;
+  }
+
+  _head = (_head + 1) % VELOCITY_HISTORY;
+  _time[_head] = time_us;
+  _counts[_head] = counts;
+  if (_size < VELOCITY_HISTORY) {
+    _size++;
+  }
+
+  if (_size < 2 && _method != VELOCITY_KALMAN) {
+    return true;
+  }
+
+  switch (_method) {
+    case VELOCITY_ADAPTIVE:
+      adaptive();
+      break;
+
+    case VELOCITY_KALMAN:
+      kalman(dt, counts);
+      break;
+
+    case VELOCITY_DIFFERENCE: {
+      uint32_t prev = (_head + VELOCITY_HISTORY - 1) % VELOCITY_HISTORY;
+      _rpm = (counts - _counts[prev]) / dt * 60.0 / _counts_per_rev;
+      break;
+    }
+  }
+
+  return true;
+}
+
+bool velocity_estimator::update_motor(int32_t port) {
+  // the device timestamp is in ms, when the motor took the sample
+  uint32_t stamp = 0;
+  int32_t counts = vexMotorPositionRawGet(port, &stamp);
+  return update((uint64_t)stamp * 1000, counts);
+}
+
+
+// first order adaptive window
+// grow the window one sample at a time and stop as soon as the straight
+// line from the oldest to the newest sample misses any sample in between
+// by more than the noise bound
+void velocity_estimator::adaptive(void) {
+  uint32_t newest = _head;
+  double best = 0;
+
+  for (uint32_t n = 1; n < _size; n++) {
+    uint32_t oldest = (_head + VELOCITY_HISTORY - n) % VELOCITY_HISTORY;
+    double span = (double)(_time[newest] - _time[oldest]);
+    double slope = (_counts[newest] - _counts[oldest]) / span;
+
+    // counts are off by up to a count, and timestamps by up to a tick,
+    // which at speed is worth slope * tick counts
+    double bound = VELOCITY_WINDOW_NOISE + fabs(slope) * VELOCITY_WINDOW_JITTER;
+
+    bool fits = true;
+    for (uint32_t k = 1; k < n; k++) {
+      uint32_t i = (_head + VELOCITY_HISTORY - k) % VELOCITY_HISTORY;
+      double line = _counts[newest] - slope * (double)(_time[newest] - _time[i]);
+      if (fabs(_counts[i] - line) > bound) {
+        fits = false;
+        break;
+      }
+    }
+
+    if (!fits) {
+      break;
+    }
+    best = slope;
+  }
+
+  // counts per us to rpm
+  _rpm = best * 1e6 * 60.0 / _counts_per_rev;
+}
+
+// constant velocity kalman filter, acceleration is the process noise
+void velocity_estimator::kalman(double dt, int32_t counts) {
+  if (_size == 1) {
+    _x[0] = counts;
+    _x[1] = 0;
+    _p[0][0] = VELOCITY_KALMAN_MEASURE;
+    _p[1][1] = 1e8;
+    _p[0][1] = _p[1][0] = 0;
+    _rpm = 0;
+    return;
+  }
+
+  // predict
+  double q = VELOCITY_KALMAN_ACCEL * VELOCITY_KALMAN_ACCEL;
+  double dt2 = dt * dt;
+  _x[0] += _x[1] * dt;
+
+  double p00 = _p[0][0] + dt * (_p[1][0] + _p[0][1]) + dt2 * _p[1][1] + q * dt2 * dt2 / 4;
+  double p01 = _p[0][1] + dt * _p[1][1] + q * dt2 * dt / 2;
+  double p10 = _p[1][0] + dt * _p[1][1] + q * dt2 * dt / 2;
+  double p11 = _p[1][1] + q * dt2;
+
+  // update on the measured position
+  double s = p00 + VELOCITY_KALMAN_MEASURE;
+  double k0 = p00 / s;
+  double k1 = p10 / s;
+  double y = counts - _x[0];
+
+  _x[0] += k0 * y;
+  _x[1] += k1 * y;
+
+  _p[0][0] = (1 - k0) * p00;
+  _p[0][1] = (1 - k0) * p01;
+  _p[1][0] = p10 - k1 * p00;
+  _p[1][1] = p11 - k1 * p01;
+
+  _rpm = _x[1] * 60.0 / _counts_per_rev;
+}
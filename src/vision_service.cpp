@@ -0,0 +1,100 @@
+
+// standard libs
+#include <string.h>
+
+// vex api and macros
+#include "vex.h"
+#include "macros.h"
+#include "vision_service.h"
+
+
+static uint32_t area(const V5_DeviceVisionObject &object) {
+  return (uint32_t)object.width * object.height;
+}
+
+static bool same(const V5_DeviceVisionObject &a, const V5_DeviceVisionObject &b) {
+  return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+
+const V5_DeviceVisionObject *vision_frame::largest(uint16_t signature) const {
+  for (uint32_t i = 0; i < count; i++) {
+    if (objects[i].signature == signature) {
+      return &objects[i];
+    }
+  }
+  return NULL;
+}
+
+
+vision_service::vision_service(int32_t port) {
+  _port = port;
+  _sequence = 0;
+  _published = 0;
+  _last_count = -1;
+  memset(&_last_first, 0, sizeof(_last_first));
+  _checks = 0;
+  _reads = 0;
+}
+
+bool vision_service::poll(void) {
+  uint32_t now = vexSystemTimeGet();
+  _checks++;
+
+  int32_t count = vexVisionObjectCountGet(_port);
+  if (count > VISION_FRAME_OBJECTS) {
+    count = VISION_FRAME_OBJECTS;
+  }
+  if (count < 0) {
+    count = 0;
+  }
+
+  V5_DeviceVisionObject first;
+  memset(&first, 0, sizeof(first));
+  if (count > 0) {
+    vexVisionObjectGet(_port, 0, &first);
+  }
+
+  // nothing moved, either the frame isnt in yet or the scene is still
+  // (still publish now and then so readers can tell the sensor is alive)
+  bool stale = now - _published >= VISION_FRAME_PERIOD * 2;
+  if (count == _last_count && same(first, _last_first) && !stale) {
+    return false;
+  }
+  _last_count = count;
+  _last_first = first;
+  _reads++;
+
+  vision_frame &frame = _frames.back();
+  frame.count = count;
+  if (count > 0) {
+    frame.objects[0] = first;
+  }
+  for (int32_t i = 1; i < count; i++) {
+    vexVisionObjectGet(_port, i, &frame.objects[i]);
+  }
+
+  // largest first, the list is short and usually sorted already so an
+  // insertion sort is about one pass
+  for (int32_t i = 1; i < count; i++) {
+    V5_DeviceVisionObject object = frame.objects[i];
+    int32_t k = i - 1;
+    while (k >= 0 && area(frame.objects[k]) < area(object)) {
+      frame.objects[k + 1] = frame.objects[k];
+      k--;
+    }
+    frame.objects[k + 1] = object;
+  }
+
+  frame.sequence = ++_sequence;
+  frame.timestamp = now;
+  _frames.publish();
+  _published = now;
+  return true;
+}
+
+uint32_t vision_service::next_poll(bool published) const {
+  // right after a frame the next one is a whole period away, after that
+  // check often so we catch it soon after it lands
+  return published ? VISION_FRAME_PERIOD - VISION_FRAME_MARGIN : VISION_POLL_PERIOD;
+}
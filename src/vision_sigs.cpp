@@ -0,0 +1,90 @@
+
+// standard libs
+#include <math.h>
+#include <string.h>
+
+// vex api and macros
+#include "vex.h"
+#include "vision_sigs.h"
+
+
+static bool matches(const vision_sig &want, const V5_DeviceVisionSignature &have) {
+  // range goes through the sensor as a float, allow for rounding
+  return have.id == want.id
+    && have.uMin == want.u_min && have.uMax == want.u_max && have.uMean == want.u_mean
+    && have.vMin == want.v_min && have.vMax == want.v_max && have.vMean == want.v_mean
+    && have.mType == want.type
+    && fabsf(have.range - want.range) < 0.01f;
+}
+
+static bool sensor_present(int32_t port) {
+  V5_DeviceTypeBuffer types;
+  int32_t count = vexDeviceGetStatus(types);
+  return port < count && types[port] == kDeviceTypeVisionSensor;
+}
+
+
+vision_signatures::vision_signatures(int32_t port, const vision_sig *table, uint32_t count, uint8_t brightness) {
+  _port = port;
+  _table = table;
+  _count = count;
+  _brightness = brightness;
+  _present = false;
+  _sent = 0;
+}
+
+int32_t vision_signatures::sync(void) {
+  _present = sensor_present(_port);
+  if (!_present) {
+    return -1;
+  }
+
+  if (vexVisionBrightnessGet(_port) != _brightness) {
+    vexVisionBrightnessSet(_port, _brightness);
+  }
+
+  int32_t sent = 0;
+  for (uint32_t i = 0; i < _count; i++) {
+    const vision_sig &want = _table[i];
+
+    // a signature the sensor cant read back (flag clear) always gets sent
+    V5_DeviceVisionSignature have;
+    memset(&have, 0, sizeof(have));
+    if (vexVisionSignatureGet(_port, want.id, &have) && (have.flags & VISION_SIG_FLAG_STATUS)
+        && matches(want, have)) {
+      continue;
+    }
+
+    V5_DeviceVisionSignature sig;
+    memset(&sig, 0, sizeof(sig));
+    sig.id = want.id;
+    sig.range = want.range;
+    sig.uMin = want.u_min;
+    sig.uMax = want.u_max;
+    sig.uMean = want.u_mean;
+    sig.vMin = want.v_min;
+    sig.vMax = want.v_max;
+    sig.vMean = want.v_mean;
+    sig.mType = want.type;
+    vexVisionSignatureSet(_port, &sig);
+    sent++;
+  }
+
+  _sent += sent;
+  return sent;
+}
+
+int32_t vision_signatures::poll(void) {
+  bool present = sensor_present(_port);
+  if (present == _present) {
+    return 0;
+  }
+
+  // gone, remember that so we sync when it comes back
+  if (!present) {
+    _present = false;
+    return 0;
+  }
+
+  return sync();
+}
@@ -0,0 +1,594 @@
+
+/*
+ * autotune.cpp
+ * search the heading hold and flywheel gains on the field model
+ *
+ * every candidate set of gains is scored on a handful of robots (mass,
+ * tile friction and flywheel inertia wander around the defaults): heading
+ * hold on a straight drive that gets knocked sideways and then asked to
+ * turn a little, and the flywheel on spin up and on recovering from a
+ * string of shots. the search is cma-es in log gain space, and every run
+ * of a generation goes into a work stealing pool across the host's cores.
+ * the best gains go into the parameter file the robot loads at startup
+ * (anything else already in the file is kept)
+ *
+ * usage:
+ *   autotune [generations] [threads] [file]
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "heading.h"
+#include "flywheel.h"
+#include "velocity.h"
+#include "v5_sim.h"
+#include "field_sim.h"
+
+
+// robots each candidate is scored on, and candidates per generation
+#define ROBOTS 6
+#define POPULATION 12
+#define GENERATIONS 30
+
+// heading run (s): knocked at BUMP_AT, asked for STEP degrees at STEP_AT
+#define HEADING_LENGTH 3.0
+#define BUMP_AT 0.5
+#define BUMP_RATE 1.5          // rad/s
+#define STEP_AT 1.5
+#define STEP 15.0
+
+// flywheel run (s): spin up, then a disc every SHOT_GAP from FIRST_SHOT
+// (how fast it gets up to speed is mostly the motor, so the error only
+// counts once it is shooting and the spin up time goes in on its own)
+#define FLYWHEEL_LENGTH 6.5
+#define TUNE_RPM 500
+#define FIRST_SHOT 3.0
+#define SHOT_GAP 0.5
+#define SHOTS 6
+#define SPIN_UP_COST 10.0      // per s, against rpm of error
+
+// what chatter costs against tracking error: per rpm of turn change per
+// tick (heading), per volt of change per tick (flywheel)
+#define HEADING_CHATTER 0.02
+#define FLYWHEEL_CHATTER 0.5
+
+// cma-es, gains per controller
+#define DIM 3
+
+
+/*----------------------------------------------------------------------------*/
+/*    work stealing pool                                                      */
+/*----------------------------------------------------------------------------*/
+
+// every worker takes jobs off the back of its own queue and, once that is
+// empty, off the front of someone else's. a round is handed out evenly up
+// front, so stealing only happens when runs take uneven time
+class steal_pool {
+  private:
+    struct queue {
+      std::mutex lock;
+      std::deque<uint32_t> jobs;
+    };
+
+    std::vector<std::thread> _threads;
+    std::vector<queue> _queues;
+    std::function<void(uint32_t)> _work;
+
+    std::mutex _lock;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    uint32_t _round;
+    uint32_t _working;   // threads still on this round
+    bool _quit;
+
+    std::atomic<uint64_t> _steals;
+    std::vector<double> _busy;   // s of work per thread
+
+    bool take(uint32_t self, uint32_t *job) {
+      {
+        queue &q = _queues[self];
+        std::lock_guard<std::mutex> hold(q.lock);
+        if (!q.jobs.empty()) {
+          *job = q.jobs.back();
+          q.jobs.pop_back();
+          return true;
+        }
+      }
+
+      for (uint32_t i = 1; i < _queues.size(); i++) {
+        queue &q = _queues[(self + i) % _queues.size()];
+        std::lock_guard<std::mutex> hold(q.lock);
+        if (!q.jobs.empty()) {
+          *job = q.jobs.front();
+          q.jobs.pop_front();
+          _steals++;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void worker(uint32_t self) {
+      uint32_t seen = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> hold(_lock);
+          _wake.wait(hold, [&]() { return _quit || _round != seen; });
+          if (_quit) {
+            return;
+          }
+          seen = _round;
+        }
+
+        // nothing is left to take once this comes back empty, but others
+        // may still be running theirs
+        uint32_t job;
+        struct timespec a, b;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        while (take(self, &job)) {
+          _work(job);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        _busy[self] += (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) / 1e9;
+
+        std::lock_guard<std::mutex> hold(_lock);
+        if (--_working == 0) {
+          _done.notify_all();
+        }
+      }
+    }
+
+  public:
+    steal_pool(uint32_t threads) : _queues(threads), _busy(threads, 0) {
+      _round = 0;
+      _working = 0;
+      _quit = false;
+      _steals = 0;
+      for (uint32_t i = 0; i < threads; i++) {
+        _threads.emplace_back(&steal_pool::worker, this, i);
+      }
+    }
+
+    ~steal_pool() {
+      {
+        std::lock_guard<std::mutex> hold(_lock);
+        _quit = true;
+      }
+      _wake.notify_all();
+      for (std::thread &t : _threads) {
+        t.join();
+      }
+    }
+
+    // run work(0..count-1) across the pool, back when every one is done
+    void run(uint32_t count, std::function<void(uint32_t)> work) {
+      _work = work;
+      for (uint32_t i = 0; i < count; i++) {
+        _queues[i % _queues.size()].jobs.push_back(i);
+      }
+
+      std::unique_lock<std::mutex> hold(_lock);
+      _working = _threads.size();
+      _round++;
+      _wake.notify_all();
+      _done.wait(hold, [&]() { return _working == 0; });
+    }
+
+    uint64_t steals(void) const { return _steals; }
+    double busy(void) const {
+      double total = 0;
+      for (double b : _busy) total += b;
+      return total;
+    }
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*    runs                                                                    */
+/*----------------------------------------------------------------------------*/
+
+static std::vector<sim_robot_config> robots;
+
+static void make_robots(void) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> u(0, 1);
+
+  // the first one is the default robot, the rest wander around it
+  for (uint32_t i = 0; i < ROBOTS; i++) {
+    sim_robot_config c = sim_robot_defaults();
+    if (i != 0) {
+      c.mass *= 0.9 + 0.2 * u(rng);
+      c.friction = 0.6 + 0.4 * u(rng);
+      c.flywheel_inertia *= 0.8 + 0.4 * u(rng);
+      c.flywheel_drag *= 0.5 + u(rng);
+    }
+    robots.push_back(c);
+  }
+}
+
+// mean |heading error| (degrees) plus chatter
+static double heading_run(const sim_robot_config &c, const double *gains) {
+  heading_gains k = { gains[0], gains[1], gains[2] };
+  sim_field_setup(c, 0, 0, 0);
+
+  drivetrain dt(c.left[0], c.left[1], c.right[0], c.right[1], DRIVETRAIN_SPEED);
+  heading_hold heading(c.imu);
+  heading.set_gains(&k);
+  heading.hold(0);
+
+  double target = 0, error = 0, chatter = 0, last_turn = 0;
+  uint32_t ticks = 0;
+  for (uint32_t ms = 0; ms < HEADING_LENGTH * 1000; ms++) {
+    if (ms == BUMP_AT * 1000) {
+      sim_field_bump(0, BUMP_RATE);
+    }
+    if (ms == STEP_AT * 1000) {
+      target = STEP;
+      heading.retarget(target);
+    }
+
+    if (ms % DRIVE_PERIOD == 0) {
+      heading.drive(dt, DRIVETRAIN_SPEED);
+      double turn = sim_motor_get(c.left[0])->target_rpm - sim_motor_get(c.right[0])->target_rpm;
+      chatter += fabs(turn - last_turn);
+      last_turn = turn;
+
+      // scored on where it really points, not on what the imu says
+      double truth = -sim_field_state()->theta * 180 / M_PI;
+      error += fabs(heading_wrap(target - truth));
+      ticks++;
+    }
+    sim_field_step(0.001);
+    sim_time_advance(1000);
+  }
+
+  return (error + HEADING_CHATTER * chatter) / ticks;
+}
+
+// mean |rpm error| while shooting, plus chatter and spin up time
+static double flywheel_run(const sim_robot_config &c, const double *gains) {
+  flywheel_gains k = { gains[0], gains[1], gains[2] };
+  sim_field_setup(c, 0, 0, 0);
+
+  velocity_estimator speed(MOTOR_COUNTS_6, VELOCITY_KALMAN);
+  flywheel_control control;
+  control.set_gains(&k);
+
+  double error = 0, chatter = 0, spin_up = FIRST_SHOT;
+  int32_t last_mv = 0;
+  uint32_t ticks = 0, shots = 0;
+  for (uint32_t ms = 0; ms < FLYWHEEL_LENGTH * 1000; ms++) {
+    if (shots < SHOTS && ms == (FIRST_SHOT + shots * SHOT_GAP) * 1000) {
+      sim_field_launch();
+      shots++;
+    }
+
+    if (ms % DRIVE_PERIOD == 0) {
+      uint32_t stamp;
+      int32_t counts = vexMotorPositionRawGet(c.flywheel, &stamp);
+      speed.update((uint64_t)stamp * 1000, counts);
+
+      int32_t mv = control.update(TUNE_RPM, speed.rpm());
+      vexMotorVoltageSet(c.flywheel, mv);
+      chatter += fabs(mv - last_mv) / 1000.0;
+      last_mv = mv;
+
+      double off = fabs(TUNE_RPM - sim_field_state()->flywheel_rpm);
+      if (ms >= FIRST_SHOT * 1000) {
+        error += off;
+        ticks++;
+      } else if (off < FLYWHEEL_READY_BAND && spin_up == FIRST_SHOT) {
+        spin_up = ms / 1000.0;
+      }
+    }
+    sim_field_step(0.001);
+    sim_time_advance(1000);
+  }
+
+  return (error + FLYWHEEL_CHATTER * chatter) / ticks + SPIN_UP_COST * spin_up;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    cma-es                                                                  */
+/*----------------------------------------------------------------------------*/
+
+// one controller's search, x is log(gain)
+struct problem {
+  const char *name;
+  const char *params[DIM];
+  double start[DIM];
+  double min[DIM];
+  double max[DIM];
+  double (*run)(const sim_robot_config &c, const double *gains);
+};
+
+static const problem problems[] = {
+  { "heading", { "heading_kp", "heading_ki", "heading_kd" },
+    { HEADING_KP, HEADING_KI, HEADING_KD }, { 0.1, 0.01, 0.001 }, { 50, 50, 10 }, heading_run },
+  { "flywheel", { "flywheel_kf", "flywheel_kp", "flywheel_ki" },
+    { FLYWHEEL_KF, FLYWHEEL_KP, FLYWHEEL_KI }, { 1, 0.1, 0.1 }, { 100, 500, 500 }, flywheel_run },
+};
+#define PROBLEM_COUNT (sizeof(problems) / sizeof(problems[0]))
+
+// the gains a point in the search stands for (clamped to the parameter's
+// range) and how far outside the range it was
+static double to_gains(const problem &p, const double *x, double *gains) {
+  double outside = 0;
+  for (int i = 0; i < DIM; i++) {
+    double lo = log(p.min[i]), hi = log(p.max[i]);
+    double clamped = fmax(lo, fmin(hi, x[i]));
+    outside += (x[i] - clamped) * (x[i] - clamped);
+    gains[i] = exp(clamped);
+  }
+  return outside;
+}
+
+// eigen decomposition of a symmetric matrix (jacobi), c = b diag(d) b'
+static void eigen(const double c[DIM][DIM], double b[DIM][DIM], double d[DIM]) {
+  double a[DIM][DIM];
+  memcpy(a, c, sizeof(a));
+  for (int i = 0; i < DIM; i++)
+    for (int j = 0; j < DIM; j++)
+      b[i][j] = i == j;
+
+  for (int sweep = 0; sweep < 50; sweep++) {
+    double off = 0;
+    for (int i = 0; i < DIM; i++)
+      for (int j = i + 1; j < DIM; j++)
+        off += a[i][j] * a[i][j];
+    if (off < 1e-20) {
+      break;
+    }
+
+    for (int p = 0; p < DIM; p++) {
+      for (int q = p + 1; q < DIM; q++) {
+        if (fabs(a[p][q]) < 1e-30) {
+          continue;
+        }
+        double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        double t = copysign(1.0, theta) / (fabs(theta) + sqrt(theta * theta + 1));
+        double cs = 1 / sqrt(t * t + 1), sn = t * cs;
+
+        for (int k = 0; k < DIM; k++) {
+          double akp = a[k][p], akq = a[k][q];
+          a[k][p] = cs * akp - sn * akq;
+          a[k][q] = sn * akp + cs * akq;
+        }
+        for (int k = 0; k < DIM; k++) {
+          double apk = a[p][k], aqk = a[q][k];
+          a[p][k] = cs * apk - sn * aqk;
+          a[q][k] = sn * apk + cs * aqk;
+        }
+        for (int k = 0; k < DIM; k++) {
+          double bkp = b[k][p], bkq = b[k][q];
+          b[k][p] = cs * bkp - sn * bkq;
+          b[k][q] = sn * bkp + cs * bkq;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < DIM; i++) {
+    d[i] = sqrt(fmax(a[i][i], 1e-20));   // as standard deviations
+  }
+}
+
+struct search_result {
+  double gains[DIM];
+  double score;
+  double start_score;
+  uint32_t runs;
+};
+
+static search_result search(steal_pool &pool, const problem &p, uint32_t generations) {
+  const int n = DIM, lambda = POPULATION, mu = POPULATION / 2;
+
+  // the usual cma-es constants
+  double w[mu], wsum = 0, w2 = 0;
+  for (int i = 0; i < mu; i++) {
+    w[i] = log(mu + 0.5) - log(i + 1.0);
+    wsum += w[i];
+  }
+  for (int i = 0; i < mu; i++) {
+    w[i] /= wsum;
+    w2 += w[i] * w[i];
+  }
+  double mueff = 1 / w2;
+  double cc = (4 + mueff / n) / (n + 4 + 2 * mueff / n);
+  double cs = (mueff + 2) / (n + mueff + 5);
+  double c1 = 2 / ((n + 1.3) * (n + 1.3) + mueff);
+  double cmu = fmin(1 - c1, 2 * (mueff - 2 + 1 / mueff) / ((n + 2) * (n + 2) + mueff));
+  double damps = 1 + 2 * fmax(0, sqrt((mueff - 1) / (n + 1)) - 1) + cs;
+  double chin = sqrt(n) * (1 - 1.0 / (4 * n) + 1.0 / (21 * n * n));
+
+  double mean[DIM], sigma = 0.5, ps[DIM] = {0}, pc[DIM] = {0};
+  double c[DIM][DIM], b[DIM][DIM], d[DIM];
+  for (int i = 0; i < n; i++) {
+    mean[i] = log(p.start[i]);
+    for (int j = 0; j < n; j++) {
+      c[i][j] = i == j;
+    }
+  }
+  eigen(c, b, d);
+
+  std::mt19937 rng(2);
+  std::normal_distribution<double> normal(0, 1);
+
+  search_result r;
+  r.runs = 0;
+  r.score = INFINITY;
+
+  // the starting gains first, on the same robots, to have something to beat
+  std::vector<double> scores(ROBOTS);
+  pool.run(ROBOTS, [&](uint32_t job) { scores[job] = p.run(robots[job], p.start); });
+  r.start_score = 0;
+  for (double s : scores) r.start_score += s / ROBOTS;
+  r.runs += ROBOTS;
+  memcpy(r.gains, p.start, sizeof(r.gains));
+  r.score = r.start_score;
+
+  double x[POPULATION][DIM], y[POPULATION][DIM];
+  double fitness[POPULATION];
+  scores.resize(POPULATION * ROBOTS);
+
+  for (uint32_t gen = 0; gen < generations; gen++) {
+    for (int k = 0; k < lambda; k++) {
+      double z[DIM], bdz[DIM];
+      for (int i = 0; i < n; i++) z[i] = normal(rng);
+      for (int i = 0; i < n; i++) {
+        bdz[i] = 0;
+        for (int j = 0; j < n; j++) bdz[i] += b[i][j] * d[j] * z[j];
+        y[k][i] = bdz[i];
+        x[k][i] = mean[i] + sigma * bdz[i];
+      }
+    }
+
+    // every candidate on every robot, one job each
+    pool.run(POPULATION * ROBOTS, [&](uint32_t job) {
+      double gains[DIM];
+      to_gains(p, x[job / ROBOTS], gains);
+      scores[job] = p.run(robots[job % ROBOTS], gains);
+    });
+    r.runs += POPULATION * ROBOTS;
+
+    int order[POPULATION];
+    for (int k = 0; k < lambda; k++) {
+      double gains[DIM];
+      double outside = to_gains(p, x[k], gains);
+      fitness[k] = 0;
+      for (int j = 0; j < ROBOTS; j++) fitness[k] += scores[k * ROBOTS + j] / ROBOTS;
+      if (fitness[k] < r.score && outside == 0) {
+        r.score = fitness[k];
+        memcpy(r.gains, gains, sizeof(r.gains));
+      }
+      fitness[k] += outside * r.start_score;
+      order[k] = k;
+    }
+    std::sort(order, order + lambda, [&](int a, int b) { return fitness[a] < fitness[b]; });
+
+    // move the mean to the weighted best half
+    double yw[DIM] = {0};
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < mu; k++) yw[i] += w[k] * y[order[k]][i];
+      mean[i] += sigma * yw[i];
+    }
+
+    // step size path, through c^-1/2 = b d^-1 b'
+    double bt[DIM] = {0}, cinv[DIM] = {0}, psnorm = 0;
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        bt[i] += b[j][i] * yw[j];
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        cinv[i] += b[i][j] * bt[j] / d[j];
+    for (int i = 0; i < n; i++) {
+      ps[i] = (1 - cs) * ps[i] + sqrt(cs * (2 - cs) * mueff) * cinv[i];
+      psnorm += ps[i] * ps[i];
+    }
+    psnorm = sqrt(psnorm);
+    bool hsig = psnorm / sqrt(1 - pow(1 - cs, 2.0 * (gen + 1))) / chin < 1.4 + 2.0 / (n + 1);
+
+    // covariance: rank one from the evolution path, rank mu from the best
+    for (int i = 0; i < n; i++) {
+      pc[i] = (1 - cc) * pc[i] + (hsig ? sqrt(cc * (2 - cc) * mueff) : 0) * yw[i];
+    }
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        double rank_mu = 0;
+        for (int k = 0; k < mu; k++) rank_mu += w[k] * y[order[k]][i] * y[order[k]][j];
+        c[i][j] = (1 - c1 - cmu) * c[i][j]
+          + c1 * (pc[i] * pc[j] + (hsig ? 0 : cc * (2 - cc) * c[i][j]))
+          + cmu * rank_mu;
+      }
+    }
+    sigma *= exp((cs / damps) * (psnorm / chin - 1));
+    eigen(c, b, d);
+
+    printf("%-8s gen %2u: best %8.3f  this gen %8.3f  step %.3f\n", p.name, gen, r.score,
+           fitness[order[0]], sigma);
+  }
+
+  return r;
+}
+
+
+static double host_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  uint32_t generations = argc >= 2 ? atoi(argv[1]) : GENERATIONS;
+  uint32_t threads = argc >= 3 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+  const char *file = argc >= 4 ? argv[3] : PARAMS_FILE;
+  if (threads < 1) threads = 1;
+
+  // the sd card stand in works relative to a root directory
+  char root[256] = ".";
+  const char *slash = strrchr(file, '/');
+  if (slash != NULL) {
+    snprintf(root, sizeof(root), "%.*s", (int)(slash - file), file);
+    if (slash == file) strcpy(root, "/");
+    file = slash + 1;
+  }
+  sim_sd_root(root);
+
+  make_robots();
+  steal_pool pool(threads);
+  double start = host_seconds();
+
+  search_result results[PROBLEM_COUNT];
+  uint32_t runs = 0;
+  for (uint32_t i = 0; i < PROBLEM_COUNT; i++) {
+    results[i] = search(pool, problems[i], generations);
+    runs += results[i].runs;
+  }
+  double wall = host_seconds() - start;
+
+  // keep whatever else the file already has
+  params_load(file);
+
+  bool ok = true;
+  for (uint32_t i = 0; i < PROBLEM_COUNT; i++) {
+    const problem &p = problems[i];
+    const search_result &r = results[i];
+    printf("%-8s score %.3f -> %.3f:", p.name, r.start_score, r.score);
+    for (int j = 0; j < DIM; j++) {
+      char value[32];
+      snprintf(value, sizeof(value), "%.4g", r.gains[j]);
+      ok = params_set(p.params[j], value) && ok;
+      printf(" %s %s", p.params[j], value);
+    }
+    printf("\n");
+  }
+
+  int32_t saved = params_save(file);
+  printf("%u runs on %u threads in %.2f s (%.0f runs/s, %.0f%% busy, %llu steals)\n", runs, threads,
+         wall, runs / wall, 100 * pool.busy() / (wall * threads), (unsigned long long)pool.steals());
+  printf("wrote %s/%s\n", root, file);
+
+  ok = ok && saved > 0;
+  printf("%s\n", ok ? "ok" : "FAIL: could not write the parameter file");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,357 @@
+
+/*
+ * bench.cpp
+ * host benchmarks of the code that runs every tick on the robot
+ *
+ * each case is one tick's worth of a hot path against the sim stand ins:
+ * the drive motor commands and the motor cache pass, reading the
+ * controller the way driver control does and updating its screen, the
+ * pose filter step, an auton tick (heading hold following the plan), a
+ * vision frame through the vision service, building a telemetry frame,
+ * and the cpu profiler marking one task run. times are per call on this
+ * host, so only compare runs from the same machine
+ *
+ * usage:
+ *   bench [results.json] [baseline.json]
+ *
+ * results are one json object per line. with a baseline, any case whose
+ * median is more than BENCH_TOLERANCE times the baseline's fails the run
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "heading.h"
+#include "motor_cache.h"
+#include "controller_display.h"
+#include "pose.h"
+#include "auton.h"
+#include "vision_service.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "v5_sim.h"
+
+
+// batches per case, and calls per batch
+#define BATCHES 200
+#define BATCH_CALLS 1000
+
+// how much slower than the baseline a median may get
+#define BENCH_TOLERANCE 1.25
+
+// ports as wired in main.cpp
+#define LEFT_A 10
+#define LEFT_B 19
+#define RIGHT_A 0
+#define RIGHT_B 9
+#define FLYWHEEL 1
+#define IMU 2
+#define VISION 3
+
+
+struct bench_case {
+  const char *name;
+  void (*setup)(void);
+  void (*call)(uint32_t i);
+};
+
+struct bench_result {
+  const char *name;
+  double min;     // ns per call, fastest batch
+  double p50;
+  double p99;
+  double mean;
+};
+
+
+static double host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// keeps the compiler from dropping a result nobody reads
+static volatile double sink;
+
+
+/*----------------------------------------------------------------------------*/
+/*    cases                                                                   */
+/*----------------------------------------------------------------------------*/
+
+static drivetrain Drive(LEFT_A, LEFT_B, RIGHT_A, RIGHT_B, DRIVETRAIN_SPEED);
+static heading_hold Heading(IMU);
+
+// motor command dispatch: one tank command, four velocity sets
+static void motor_dispatch(uint32_t i) {
+  double forward = (i & 63) * 2.0;
+  Drive.tank(forward, -forward);
+}
+
+// the motor cache pass main does at the top of every tick, the same
+// reads as its MotorReads (17 device calls), change both together
+static const motor_read reads[] = {
+  { LEFT_A, MOTOR_POSITION | MOTOR_VELOCITY | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { LEFT_B, MOTOR_POSITION | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { RIGHT_A, MOTOR_POSITION | MOTOR_VELOCITY | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { RIGHT_B, MOTOR_POSITION | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+  { FLYWHEEL, MOTOR_RAW | MOTOR_CURRENT | MOTOR_TEMPERATURE },
+};
+static motor_cache Motors(reads, sizeof(reads) / sizeof(reads[0]));
+
+static void motor_refresh(uint32_t i) {
+  Motors.refresh();
+}
+
+// controller polling: every stick and button driver control reads, then
+// the screen (a new row every 50 ms, like update_controller)
+static controller_display Screen(kControllerMaster);
+
+static void controller_setup(void) {
+  sim_controller *c = sim_controller_get(kControllerMaster);
+  c->values[Axis3] = 80;
+  c->values[Axis1] = -20;
+  c->values[ButtonL1] = 1;
+}
+
+static void controller_poll(uint32_t i) {
+  int32_t forward = vexControllerGet(kControllerMaster, Axis3);
+  int32_t turn = vexControllerGet(kControllerMaster, Axis1);
+  int32_t left = vexControllerGet(kControllerMaster, ButtonL1) - vexControllerGet(kControllerMaster, ButtonL2);
+  int32_t right = vexControllerGet(kControllerMaster, ButtonR1) - vexControllerGet(kControllerMaster, ButtonR2);
+  sink = forward + turn + left + right;
+
+  sim_time_advance(DRIVE_PERIOD * 1000);
+  if (i % 5 == 0) {
+    Screen.print(0, "FW %4u/600 rpm", i % 600);
+  }
+  Screen.service(vexSystemTimeGet());
+}
+
+// odometry: one pose filter step (wheels, imu, and a bearing every
+// other tick)
+static const landmark landmarks[] = {
+  { 1, 0.0, 1.83 },
+  { 2, 3.66, 1.83 },
+};
+static pose_filter Pose(landmarks, 2);
+
+static void odometry_setup(void) {
+  Pose.reset({ 0.6, 0.6, 0 });
+}
+
+static void odometry(uint32_t i) {
+  pose_sample sample;
+  sample.time = i * DRIVE_PERIOD;
+  sample.left = (i % 1000) * 3.0f;
+  sample.right = (i % 1000) * 3.1f;
+  sample.heading = (i % 1000) * -0.1f;
+  sample.signature = i & 1 ? 1 : 0;
+  sample.x_center = 120 + (i % 40);
+  Pose.step(sample);
+}
+
+// path follower: one auton tick, heading hold on the prepared plan
+static const auton_step steps[] = {
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 }, { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+};
+static const auton_routine routine = { "bench", { 0.6, 0.6, 0 }, steps, 4 };
+static auton_plan Plan;
+
+static void follower_setup(void) {
+  Plan.prepare(&routine, DRIVETRAIN_SPEED);
+  Heading.hold(0);
+}
+
+static void follower(uint32_t i) {
+  const auton_tick &t = Plan.tick(i % Plan.count());
+  sim_imu_set(IMU, t.heading + (i % 7) * 0.1);
+  sim_time_advance(DRIVE_PERIOD * 1000);
+  Heading.retarget(t.heading);
+  Heading.drive(Drive, t.forward);
+}
+
+// vision tracking: a new frame (something moved), the full read, then
+// the biggest object of the signature we track
+static vision_service Vision(VISION);
+
+static void vision_setup(void) {
+  sim_vision *v = sim_vision_get(VISION);
+  v->object_count = 6;
+  for (int32_t i = 0; i < v->object_count; i++) {
+    V5_DeviceVisionObject &o = v->objects[i];
+    memset(&o, 0, sizeof(o));
+    o.signature = 1 + i % 3;
+    o.type = kVisionTypeNormal;
+    o.width = 60 - i * 8;
+    o.height = 40 - i * 5;
+    o.xoffset = 20 + i * 40;
+    o.yoffset = 100;
+  }
+}
+
+static void vision(uint32_t i) {
+  sim_vision *v = sim_vision_get(VISION);
+  v->objects[0].xoffset = 20 + i % 50;
+  sim_time_advance(VISION_FRAME_PERIOD * 1000);
+
+  Vision.poll();
+  const V5_DeviceVisionObject *object = Vision.latest().largest(2);
+  sink = object != NULL ? vision_bearing(object->xoffset + object->width / 2) : 0;
+}
+
+// telemetry encoding: a drive record into a finished frame (crc and cobs)
+static void telemetry(uint32_t i) {
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  uint8_t encoded[TELEMETRY_MAX_ENCODED];
+  telemetry_drive d = { (int16_t)(i & 255), (int16_t)-(i & 255), (int16_t)i };
+
+  uint32_t stamp = i * 10000;
+  frame[0] = TELEM_DRIVE;
+  frame[1] = (uint8_t)i;
+  memcpy(&frame[2], &stamp, sizeof(stamp));
+  memcpy(&frame[TELEMETRY_HEADER_SIZE], &d, sizeof(d));
+  uint32_t len = TELEMETRY_HEADER_SIZE + sizeof(d);
+  frame[len] = telemetry_crc8(frame, len);
+  sink = telemetry_cobs_encode(frame, len + 1, encoded);
+}
+
+// cpu profiler: what marking one run of a task costs (every task pays
+// this each time it wakes)
+static profile_task *profiled = NULL;
+
+static void profile_setup(void) {
+  profiled = profile_register("bench");
+}
+
+static void profile_mark(uint32_t i) {
+  profile_enter(profiled);
+  profile_leave(profiled);
+}
+
+static const bench_case cases[] = {
+  { "motor_dispatch", NULL, motor_dispatch },
+  { "motor_refresh", NULL, motor_refresh },
+  { "controller_poll", controller_setup, controller_poll },
+  { "odometry", odometry_setup, odometry },
+  { "path_follower", follower_setup, follower },
+  { "vision_track", vision_setup, vision },
+  { "telemetry_encode", NULL, telemetry },
+  { "profile_mark", profile_setup, profile_mark },
+};
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+
+/*----------------------------------------------------------------------------*/
+/*    running and reporting                                                   */
+/*----------------------------------------------------------------------------*/
+
+static bench_result run(const bench_case &c) {
+  if (c.setup != NULL) {
+    c.setup();
+  }
+
+  // one batch to warm the caches, then the ones that count
+  uint32_t i = 0;
+  for (uint32_t n = 0; n < BATCH_CALLS; n++) {
+    c.call(i++);
+  }
+
+  std::vector<double> batch(BATCHES);
+  double total = 0;
+  for (uint32_t b = 0; b < BATCHES; b++) {
+    double start = host_ns();
+    for (uint32_t n = 0; n < BATCH_CALLS; n++) {
+      c.call(i++);
+    }
+    batch[b] = (host_ns() - start) / BATCH_CALLS;
+    total += batch[b];
+  }
+  std::sort(batch.begin(), batch.end());
+
+  bench_result r;
+  r.name = c.name;
+  r.min = batch[0];
+  r.p50 = batch[BATCHES / 2];
+  r.p99 = batch[BATCHES * 99 / 100];
+  r.mean = total / BATCHES;
+  return r;
+}
+
+// the median of a case in a results file, 0 if it isnt there
+static double baseline_p50(FILE *f, const char *name) {
+  char line[256], want[64];
+  snprintf(want, sizeof(want), "\"name\": \"%s\"", name);
+
+  rewind(f);
+  while (fgets(line, sizeof(line), f) != NULL) {
+    const char *p50 = strstr(line, "\"p50_ns\": ");
+    if (strstr(line, want) != NULL && p50 != NULL) {
+      return atof(p50 + strlen("\"p50_ns\": "));
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *out = argc >= 2 ? argv[1] : NULL;
+  FILE *baseline = NULL;
+  if (argc >= 3) {
+    baseline = fopen(argv[2], "r");
+    if (baseline == NULL) {
+      printf("FAIL: cant read baseline %s\n", argv[2]);
+      return 1;
+    }
+  }
+
+  bench_result results[CASE_COUNT];
+  for (uint32_t i = 0; i < CASE_COUNT; i++) {
+    results[i] = run(cases[i]);
+  }
+
+  bool ok = true;
+  printf("%-18s %9s %9s %9s %9s %9s\n", "ns per call", "min", "p50", "p99", "mean", "baseline");
+  for (uint32_t i = 0; i < CASE_COUNT; i++) {
+    const bench_result &r = results[i];
+    printf("%-18s %9.1f %9.1f %9.1f %9.1f", r.name, r.min, r.p50, r.p99, r.mean);
+
+    double base = baseline != NULL ? baseline_p50(baseline, r.name) : 0;
+    if (base > 0) {
+      bool slower = r.p50 > base * BENCH_TOLERANCE;
+      printf(" %9.1f%s", base, slower ? "  SLOWER" : "");
+      ok = ok && !slower;
+    }
+    printf("\n");
+  }
+
+  if (out != NULL) {
+    FILE *f = fopen(out, "w");
+    if (f == NULL) {
+      printf("FAIL: cant write %s\n", out);
+      return 1;
+    }
+    for (uint32_t i = 0; i < CASE_COUNT; i++) {
+      const bench_result &r = results[i];
+      fprintf(f, "{\"name\": \"%s\", \"calls\": %u, \"min_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"mean_ns\": %.1f}\n",
+              r.name, BATCHES * BATCH_CALLS, r.min, r.p50, r.p99, r.mean);
+    }
+    fclose(f);
+    printf("wrote %s\n", out);
+  }
+
+  if (baseline != NULL) {
+    fclose(baseline);
+  }
+  printf("%s\n", ok ? "ok" : "FAIL: slower than the baseline");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+
+/*
+ * competition_sim.cpp
+ * host check that each mode's first command follows the field enable
+ *
+ * plays a run of matches (disabled, auton, disabled, driver, disabled)
+ * through the competition manager, with the status changes landing at a
+ * random point inside the control tick like they do from a real field.
+ * the hooks are the same shape as main.cpp's: auton plays back a
+ * prepared plan, driver drives the sticks (held forward here)
+ *
+ * usage:
+ *   competition_sim [matches]
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "heading.h"
+#include "auton.h"
+#include "competition_manager.h"
+#include "v5_sim.h"
+
+
+// ports as wired in main.cpp
+#define LEFT_A 10
+#define LEFT_B 19
+#define RIGHT_A 0
+#define RIGHT_B 9
+#define IMU 2
+
+// match timing (ms), driver is cut short, nothing changes after the start
+#define AUTON_LENGTH 15000
+#define DRIVER_LENGTH 3000
+#define GAP_MIN 200
+#define GAP_MAX 3000
+
+
+static drivetrain Drivetrain(LEFT_A, LEFT_B, RIGHT_A, RIGHT_B, DRIVETRAIN_SPEED);
+static heading_hold Heading(IMU);
+
+static const auton_step square_steps[] = {
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+};
+static const auton_routine square = { "square", { 0.6, 0.6, 0 }, square_steps, 4 };
+static auton_plan Plan;
+static uint32_t plan_version = 0;
+static uint32_t prepares = 0;
+static double prepare_us = 0;
+static uint32_t tick_index = 0;
+
+// the control tick that started a mode, timed on the host clock (ns), the
+// manager's own response histogram is on the sim clock and that stands
+// still inside a step
+static latency_hist start_ns;
+
+static double host_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+// hooks
+static void autonomous_prepare(void) {
+  if (Plan.routine() != NULL && params_version() == plan_version) {
+    return;
+  }
+  plan_version = params_version();
+
+  double start = host_us();
+  Plan.prepare(&square, param_drivetrain_speed.get());
+  prepare_us = host_us() - start;
+  prepares++;
+}
+
+static void autonomous_start(void) {
+  Drivetrain.set_max_rpm(Plan.max_rpm());
+  Heading.hold(0);
+  tick_index = 0;
+}
+
+static void autonomous_tick(void) {
+  if (tick_index >= Plan.count()) {
+    Drivetrain.stop(kV5MotorBrakeModeBrake);
+    return;
+  }
+  const auton_tick &tick = Plan.tick(tick_index++);
+  Heading.retarget(tick.heading);
+  Heading.drive(Drivetrain, tick.forward);
+}
+
+static void stop(void) {
+  Heading.release();
+  Drivetrain.stop(kV5MotorBrakeModeBrake);
+}
+
+static void driver_tick(void) {
+  Drivetrain.tank(DRIVETRAIN_SPEED, DRIVETRAIN_SPEED);
+}
+
+
+// one segment of a match, returns ms from the status change to the first
+// nonzero drive command (-1 if there wasnt one, or it wasnt expected)
+static int32_t segment(competition_manager &match, uint32_t status, uint32_t length, uint32_t &ms) {
+  sim_competition_set(status);
+  bool enabled = !(status & V5_COMP_BIT_EBL);
+
+  // drive motors start this segment at rest
+  if (enabled) {
+    sim_motor_get(LEFT_A)->target_rpm = 0;
+  }
+
+  int32_t response = -1;
+  for (uint32_t end = ms + length; ms < end; ms++) {
+    if (ms % DRIVE_PERIOD == 0) {
+      uint32_t transitions = match.transitions();
+      double start = host_us();
+      match.step();
+      if (enabled && match.transitions() != transitions) {
+        latency_record(&start_ns, (uint32_t)((host_us() - start) * 1000));
+      }
+    }
+    if (enabled && response < 0 && sim_motor_get(LEFT_A)->target_rpm != 0) {
+      response = length - (end - ms);
+    }
+    sim_motor_step(0.001);
+    sim_time_advance(1000);
+  }
+  return response;
+}
+
+
+int main(int argc, char **argv) {
+  int matches = argc >= 2 ? atoi(argv[1]) : 200;
+
+  srand(1);
+  sim_motor_reset();
+
+  competition_manager match;
+  match.on(COMP_AUTON, { autonomous_prepare, autonomous_start, autonomous_tick, stop });
+  match.on(COMP_DRIVER, { NULL, NULL, driver_tick, stop });
+
+  // start the clock somewhere other than a tick boundary
+  uint32_t ms = 0;
+  uint32_t worst[COMP_STATES] = { 0, 0, 0 };
+  double total[COMP_STATES] = { 0, 0, 0 };
+  int missing = 0;
+
+  for (int i = 0; i < matches; i++) {
+    uint32_t gap = GAP_MIN + rand() % (GAP_MAX - GAP_MIN);
+    segment(match, V5_COMP_BIT_EBL | V5_COMP_BIT_COMP | V5_COMP_BIT_MODE, gap, ms);
+
+    int32_t auton = segment(match, V5_COMP_BIT_COMP | V5_COMP_BIT_MODE, AUTON_LENGTH, ms);
+
+    gap = GAP_MIN + rand() % (GAP_MAX - GAP_MIN);
+    segment(match, V5_COMP_BIT_EBL | V5_COMP_BIT_COMP, gap, ms);
+
+    int32_t driver = segment(match, V5_COMP_BIT_COMP, DRIVER_LENGTH, ms);
+
+    if (auton < 0 || driver < 0) {
+      missing++;
+      continue;
+    }
+    worst[COMP_AUTON] = fmax(worst[COMP_AUTON], auton);
+    worst[COMP_DRIVER] = fmax(worst[COMP_DRIVER], driver);
+    total[COMP_AUTON] += auton;
+    total[COMP_DRIVER] += driver;
+
+    // and a random offset so the next edges land elsewhere in the tick
+    segment(match, V5_COMP_BIT_EBL | V5_COMP_BIT_COMP, 1 + rand() % DRIVE_PERIOD, ms);
+  }
+
+  printf("%d matches, %u transitions\n", matches, match.transitions());
+  printf("enable to first drive command (ms): auton mean %.1f max %u, driver mean %.1f max %u\n",
+         total[COMP_AUTON] / matches, worst[COMP_AUTON], total[COMP_DRIVER] / matches, worst[COMP_DRIVER]);
+  printf("auton plan prepared %u times while disabled (%.0f us on this host, %u ticks)\n",
+         prepares, prepare_us, Plan.count());
+  printf("start + first tick (ns on this host): p50 %u max %u\n",
+         latency_percentile(&start_ns, 50), start_ns.max.load());
+
+  bool ok = missing == 0 && worst[COMP_AUTON] <= DRIVE_PERIOD && worst[COMP_DRIVER] <= DRIVE_PERIOD;
+  printf("%s\n", ok ? "ok: every mode moved within one control tick" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+
+/*
+ * crash_decode.cpp
+ * prints a crash dump from the sd card (include/crash_recorder.h)
+ *
+ * the header first (why and when it was written, the motor ports), then
+ * where every timed task was, then the drive ticks oldest first. the self
+ * test fills a recorder on the host, dumps it the way the robot does (a
+ * checkpoint, kept over a restart, then abort() and an uncaught exception
+ * in a child each) and checks everything reads back
+ *
+ * usage:
+ *   crash_decode <crash.bin> [last ticks]
+ *   crash_decode --selftest
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <stdexcept>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "latency.h"
+#include "motor_cache.h"
+#include "crash_recorder.h"
+#include "v5_sim.h"
+
+
+#define SELFTEST_TICKS 750    // more than the ring holds, so it wraps
+#define SELFTEST_PORTS 3
+
+
+struct crash_dump {
+  crash_header header;
+  crash_task tasks[LATENCY_MAX_TASKS];
+  crash_record records[CRASH_RING_TICKS];
+};
+
+static const char *reason_name(uint8_t reason) {
+  switch (reason) {
+    case CRASH_ABORT: return "abort";
+    case CRASH_TERMINATE: return "uncaught exception";
+    case CRASH_ESTOP: return "e-stop";
+    case CRASH_CHECKPOINT: return "checkpoint";
+    default: return "unknown";
+  }
+}
+
+static const char *mode_name(uint8_t mode) {
+  static const char *names[] = { "disabled", "auton", "driver" };
+  return mode < 3 ? names[mode] : "?";
+}
+
+
+// read a whole dump, false (and why on stderr) if it isnt one we can read
+static bool load(const char *path, crash_dump *dump) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    perror(path);
+    return false;
+  }
+
+  crash_header &h = dump->header;
+  bool ok = fread(&h, sizeof(h), 1, file) == 1;
+  if (ok && (h.magic != CRASH_MAGIC || h.version != CRASH_VERSION || h.record_size != sizeof(crash_record))) {
+    fprintf(stderr, "%s: not a version %d crash dump\n", path, CRASH_VERSION);
+    ok = false;
+  } else if (ok && (h.tasks > LATENCY_MAX_TASKS || h.records > CRASH_RING_TICKS || h.motors > CRASH_MOTORS)) {
+    fprintf(stderr, "%s: header is out of range\n", path);
+    ok = false;
+  } else if (ok) {
+    ok = fread(dump->tasks, sizeof(crash_task), h.tasks, file) == h.tasks &&
+         fread(dump->records, sizeof(crash_record), h.records, file) == h.records;
+    if (!ok) {
+      fprintf(stderr, "%s: cut short\n", path);
+    }
+  } else {
+    fprintf(stderr, "%s: no header\n", path);
+  }
+
+  fclose(file);
+  return ok;
+}
+
+static void print(const crash_dump &dump, uint32_t last) {
+  const crash_header &h = dump.header;
+  double span = h.records > 1 ? (dump.records[h.records - 1].time - dump.records[0].time) / 1000.0 : 0;
+  printf("%s at %.3f s, %u ticks over %.2f s\n", reason_name(h.reason), h.time / 1000.0, h.records, span);
+
+  printf("\ntask     period   since     run p99/max  late max (us)\n");
+  for (uint32_t i = 0; i < h.tasks; i++) {
+    const crash_task &t = dump.tasks[i];
+    printf("%-8.*s %6u %8u %7u/%-7u %8u\n", CRASH_TASK_NAME, t.name, t.period_us, t.since_us,
+           t.run_p99, t.run_max, t.late_max);
+  }
+
+  printf("\n  time_ms mode     flags  left right     x_mm     y_mm  theta  fw_set  fw_rpm fw_mv  batt  tick");
+  for (uint32_t m = 0; m < h.motors; m++) {
+    printf("  p%-2u mA/C", h.ports[m] + 1);
+  }
+  printf("\n");
+
+  uint32_t first = last > 0 && last < h.records ? h.records - last : 0;
+  for (uint32_t i = first; i < h.records; i++) {
+    const crash_record &r = dump.records[i];
+    printf("%9u %-8s %c%c%c   %5d %5d %8d %8d %6.1f %7d %7.1f %5d %5u %5u",
+           r.time, mode_name(r.mode),
+           r.flags & CRASH_FLAG_ESTOP ? 'E' : '-',
+           r.flags & CRASH_FLAG_FLYWHEEL ? 'F' : '-',
+           r.flags & CRASH_FLAG_HEADING ? 'H' : '-',
+           r.left, r.right, r.x, r.y, r.theta / 10.0,
+           r.flywheel_target, r.flywheel_rpm / 10.0, r.flywheel_mv, r.battery, r.tick_us);
+    for (uint32_t m = 0; m < h.motors; m++) {
+      printf("  %4d/%-3u", r.current[m], r.temperature[m]);
+    }
+    printf("\n");
+  }
+}
+
+
+// self test
+static double host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static crash_record tick_record(uint32_t tick) {
+  crash_record r;
+  memset(&r, 0, sizeof(r));
+  r.time = vexSystemTimeGet();
+  r.mode = tick < SELFTEST_TICKS / 2 ? 1 : 2;
+  r.flags = CRASH_FLAG_FLYWHEEL;
+  r.left = tick % 600;
+  r.right = -(int16_t)(tick % 600);
+  r.x = tick;
+  r.theta = tick % 3600;
+  r.flywheel_target = 500;
+  r.battery = 12600;
+  return r;
+}
+
+// dump from a child process that then goes down with what(), and read
+// back what it left
+static bool crash_child(const crash_recorder &recorder, const char *root, const char *file,
+                        void (*what)(void), uint8_t reason, crash_dump *dump) {
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0) {
+    crash_install(&recorder, file);
+    what();
+    _exit(0);
+  }
+
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGABRT) {
+    printf("%s: child didnt abort\n", file);
+    return false;
+  }
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", root, file);
+  return load(path, dump) && dump->header.reason == reason;
+}
+
+static void go_abort(void) {
+  abort();
+}
+
+static void go_throw(void) {
+  throw std::runtime_error("nobody catches this");
+}
+
+// a checkpoint's pauses, where the control task gets back in and keeps
+// adding to the ring
+static crash_recorder *paused_recorder = NULL;
+static uint32_t pauses = 0;
+
+static void checkpoint_pause(void) {
+  crash_record r = tick_record(SELFTEST_TICKS + pauses);
+  paused_recorder->add(r);
+  pauses++;
+}
+
+static int selftest(void) {
+  char root[] = "/tmp/crash_decode_XXXXXX";
+  if (mkdtemp(root) == NULL) {
+    perror("mkdtemp");
+    return 1;
+  }
+  sim_sd_root(root);
+
+  // the drive's first motors and the flywheel (PORT11, PORT1, PORT2)
+  const int32_t ports[SELFTEST_PORTS] = { 10, 0, 1 };
+  motor_read reads[SELFTEST_PORTS];
+  for (uint32_t m = 0; m < SELFTEST_PORTS; m++) {
+    reads[m] = { ports[m], MOTOR_CURRENT | MOTOR_TEMPERATURE };
+  }
+  motor_cache motors(reads, SELFTEST_PORTS);
+  static crash_recorder recorder(&motors);
+
+  // one task that keeps ticking and one that stops early on
+  latency_task *drive = latency_register("drive", DRIVE_PERIOD);
+  latency_task *stuck = latency_register("stuck", DRIVE_PERIOD);
+  latency_tick_end(stuck, latency_tick_begin(stuck));
+
+  double add_total = 0;
+  for (uint32_t tick = 0; tick < SELFTEST_TICKS; tick++) {
+    sim_time_advance(DRIVE_PERIOD * 1000);
+    uint64_t start = latency_tick_begin(drive);
+    for (uint32_t m = 0; m < SELFTEST_PORTS; m++) {
+      sim_motor_get(ports[m])->current = tick + m;
+      sim_motor_get(ports[m])->temperature = 30 + m;
+    }
+    motors.refresh();
+
+    crash_record r = tick_record(tick);
+    double t0 = host_ns();
+    recorder.add(r);
+    add_total += host_ns() - t0;
+    latency_tick_end(drive, start);
+  }
+
+  // what was in the ring when the checkpoint started, whatever came in
+  // during its pauses
+  static crash_dump dump;
+  paused_recorder = &recorder;
+  bool ok = recorder.checkpoint(CRASH_CHECKPOINT_FILE, checkpoint_pause) == CRASH_RING_TICKS &&
+            pauses == CRASH_RING_TICKS / CRASH_WRITE_CHUNK;
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", root, CRASH_CHECKPOINT_FILE);
+  ok = ok && load(path, &dump);
+  if (ok) {
+    print(dump, 3);
+    printf("\n");
+
+    // the newest ticks, oldest first, motor columns in the cache's order
+    uint32_t first = SELFTEST_TICKS - CRASH_RING_TICKS;
+    for (uint32_t i = 0; i < CRASH_RING_TICKS && ok; i++) {
+      const crash_record &r = dump.records[i];
+      crash_record want = tick_record(first + i);
+      ok = r.x == want.x && r.left == want.left && r.mode == want.mode &&
+           r.current[0] == (int16_t)(first + i) && r.current[2] == (int16_t)(first + i + 2) &&
+           r.temperature[1] == 31 && r.current[SELFTEST_PORTS] == 0;
+      if (!ok) {
+        printf("tick %u read back wrong\n", i);
+      }
+    }
+
+    // the task that stopped has been quiet the whole run
+    const crash_task &s = dump.tasks[1];
+    ok = ok && dump.header.tasks == 2 && dump.header.motors == SELFTEST_PORTS &&
+         dump.header.ports[2] == ports[2] && strcmp(s.name, "stuck") == 0 &&
+         s.since_us >= (SELFTEST_TICKS - 1) * DRIVE_PERIOD * 1000 &&
+         dump.tasks[0].since_us <= DRIVE_PERIOD * 1000;
+  }
+
+  printf("checkpoint: %s in %u pieces\n", ok ? "read back" : "wrong", pauses);
+
+  // a restart keeps the last run's checkpoint before writing its own
+  static crash_dump kept;
+  snprintf(path, sizeof(path), "%s/%s", root, CRASH_PREVIOUS_FILE);
+  bool got_keep = crash_keep(CRASH_CHECKPOINT_FILE, CRASH_PREVIOUS_FILE) > 0 && load(path, &kept) &&
+                  kept.header.records == CRASH_RING_TICKS && kept.records[0].x == dump.records[0].x;
+  printf("kept over a restart: %s\n", got_keep ? "yes" : "no");
+
+  static crash_dump aborted;
+  bool got_abort = crash_child(recorder, root, "abort.bin", go_abort, CRASH_ABORT, &aborted) &&
+                   aborted.header.records == CRASH_RING_TICKS;
+  printf("abort(): %s\n", got_abort ? "dumped" : "no dump");
+
+  static crash_dump thrown;
+  bool got_throw = crash_child(recorder, root, "terminate.bin", go_throw, CRASH_TERMINATE, &thrown) &&
+                   thrown.header.records == CRASH_RING_TICKS;
+  printf("uncaught exception: %s\n", got_throw ? "dumped" : "no dump");
+
+  printf("%.0f ns per record, %u bytes a dump\n", add_total / SELFTEST_TICKS,
+         (unsigned)(sizeof(crash_header) + 2 * sizeof(crash_task) + CRASH_RING_TICKS * sizeof(crash_record)));
+
+  ok = ok && got_keep && got_abort && got_throw;
+  printf("%s\n", ok ? "ok" : "FAIL: the dump didnt come back the way it went out");
+  return ok ? 0 : 1;
+}
+
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "--selftest") == 0) {
+    return selftest();
+  }
+
+  if (argc >= 2) {
+    static crash_dump dump;
+    if (!load(argv[1], &dump)) {
+      return 1;
+    }
+    print(dump, argc >= 3 ? atoi(argv[2]) : 0);
+    return 0;
+  }
+
+  fprintf(stderr, "usage: %s <crash.bin> [last ticks]\n       %s --selftest\n", argv[0], argv[0]);
+  return 2;
+}
@@ -0,0 +1,245 @@
+
+/*
+ * field_sim.cpp
+ * whole matches on the field model, one per thread
+ *
+ * each match plays the square auton through the drivetrain, heading hold
+ * and the pose filter, then spins the flywheel up and launches discs
+ * whenever the velocity estimator says it is back at speed. the robot
+ * code runs as it would on the brain, against the model in sim/field_sim
+ *
+ * usage:
+ *   field_sim [matches] [threads]
+ *
+ * every match after the first gets a slightly different robot (mass and
+ * tile friction), so a run is also a small sweep. a defender pushes on
+ * the square for a second, which only the robots with grip to spare
+ * shrug off (the flywheel columns dont depend on the drive). prints one
+ * line per match and how many times real time each thread ran, and fails
+ * if a robot that cant hold the defender was not pushed off course
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "heading.h"
+#include "auton.h"
+#include "pose.h"
+#include "velocity.h"
+#include "v5_sim.h"
+#include "field_sim.h"
+
+
+// match timing (s)
+#define AUTON_LENGTH 15.0
+#define SHOOT_LENGTH 10.0
+
+// a defender meets the square head on partway up its first side (s into
+// auton, N), harder than the lightest, slickest robot's wheels can hold
+// on the tiles but not the heaviest, grippiest one's
+#define DEFENDER_START 1.0
+#define DEFENDER_LENGTH 1.0
+#define DEFENDER_FORCE 45.0
+#define GRAVITY 9.81
+
+// flywheel target (rpm), the 6:1 cartridge tops out at 600 with no load
+#define SHOOT_RPM 500
+#define DISCS 6
+
+// slowest a thread may run and still be useful for sweeps
+#define MIN_REALTIME 100.0
+
+
+struct match_result {
+  double mass;
+  double friction;
+  double end_error;       // m, true end of the square from its start
+  double pose_error;      // m, pose filter vs the truth at the end of auton
+  double slip;            // s
+  double spin_up;         // s from the flywheel command to ready
+  double recovery;        // s, mean launch to ready again
+  double range;           // m, mean
+  uint32_t launches;
+  double sim_seconds;
+  double host_seconds;
+};
+
+static const auton_step square_steps[] = {
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+  { AUTON_DRIVE, 1.2 }, { AUTON_TURN, -90 },
+};
+static const auton_routine square = { "square", { 0.6, 0.6, 0 }, square_steps, 8 };
+
+
+static double host_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static match_result play(uint32_t seed) {
+  match_result r = {};
+  double start = host_seconds();
+
+  // the first match is the default robot, the rest wander around it
+  sim_robot_config config = sim_robot_defaults();
+  // (a generator of its own, the matches run on several threads)
+  if (seed != 0) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> u(0, 1);
+    config.mass *= 0.9 + 0.2 * u(rng);
+    config.friction = 0.6 + 0.4 * u(rng);
+  }
+  r.mass = config.mass;
+  r.friction = config.friction;
+
+  const pose &at = square.start;
+  sim_field_setup(config, at.x, at.y, at.theta);
+
+  drivetrain dt(config.left[0], config.left[1], config.right[0], config.right[1], DRIVETRAIN_SPEED);
+  heading_hold heading(config.imu);
+  velocity_estimator flywheel(MOTOR_COUNTS_6, VELOCITY_KALMAN);
+  pose_filter filter(NULL, 0);
+  filter.reset(at);
+
+  // the plan is worked out before the match, like it is while disabled
+  static thread_local auton_plan plan;
+  plan.prepare(&square, DRIVETRAIN_SPEED);
+  heading.hold(0);
+
+  uint32_t tick = 0;
+  uint32_t ms = 0;
+  for (; ms < AUTON_LENGTH * 1000; ms++) {
+    if (ms == DEFENDER_START * 1000) {
+      sim_field_push(DEFENDER_FORCE);
+    } else if (ms == (DEFENDER_START + DEFENDER_LENGTH) * 1000) {
+      sim_field_push(0);
+    }
+    if (ms % DRIVE_PERIOD == 0) {
+      if (tick < plan.count()) {
+        const auton_tick &t = plan.tick(tick++);
+        heading.retarget(t.heading);
+        heading.drive(dt, t.forward);
+      } else {
+        dt.stop(kV5MotorBrakeModeBrake);
+      }
+      filter.predict(vexMotorPositionGet(config.left[0]), vexMotorPositionGet(config.right[0]));
+      filter.update_heading(vexImuHeadingGet(config.imu));
+    }
+    sim_field_step(0.001);
+    sim_time_advance(1000);
+  }
+
+  const sim_robot_state *truth = sim_field_state();
+  pose est = filter.get();
+  r.end_error = hypot(truth->x - at.x, truth->y - at.y);
+  r.pose_error = hypot(est.x - truth->x, est.y - truth->y);
+  r.slip = truth->slip_time;
+
+  // shooting: spin up, launch every time the estimate says we are there
+  heading.release();
+  vexMotorVelocitySet(config.flywheel, SHOOT_RPM);
+  double commanded = ms / 1000.0, last_launch = -1, recovering = 0;
+  uint32_t ready_ticks = 0;
+
+  for (uint32_t end = ms + SHOOT_LENGTH * 1000; ms < end; ms++) {
+    if (ms % DRIVE_PERIOD == 0) {
+      uint32_t stamp;
+      int32_t counts = vexMotorPositionRawGet(config.flywheel, &stamp);
+      flywheel.update((uint64_t)stamp * 1000, counts);
+      ready_ticks = fabs(flywheel.rpm() - SHOOT_RPM) < FLYWHEEL_READY_BAND ? ready_ticks + 1 : 0;
+
+      // ready for three ticks in a row is ready
+      double now = ms / 1000.0;
+      if (ready_ticks >= 3 && r.launches < DISCS) {
+        if (last_launch < 0) {
+          r.spin_up = now - commanded;
+        } else {
+          recovering += now - last_launch;
+        }
+        sim_field_launch();
+        r.range += truth->launch[r.launches].range;
+        r.launches++;
+        last_launch = now;
+        ready_ticks = 0;
+      }
+    }
+    sim_field_step(0.001);
+    sim_time_advance(1000);
+  }
+
+  r.recovery = r.launches > 1 ? recovering / (r.launches - 1) : NAN;
+  r.range = r.launches ? r.range / r.launches : NAN;
+  r.sim_seconds = ms / 1000.0;
+  r.host_seconds = host_seconds() - start;
+  return r;
+}
+
+
+int main(int argc, char **argv) {
+  uint32_t matches = argc >= 2 ? atoi(argv[1]) : 1;
+  uint32_t threads = argc >= 3 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+  if (threads < 1) threads = 1;
+  if (threads > matches) threads = matches;
+
+  std::vector<match_result> results(matches);
+  std::atomic<uint32_t> next(0);
+  double start = host_seconds();
+
+  // each thread is its own world (the sim is per thread), matches are
+  // handed out one at a time so a slow one doesnt hold the rest up
+  std::vector<std::thread> pool;
+  for (uint32_t t = 0; t < threads; t++) {
+    pool.emplace_back([&]() {
+      uint32_t i;
+      while ((i = next++) < matches) {
+        results[i] = play(i);
+      }
+    });
+  }
+  for (std::thread &t : pool) {
+    t.join();
+  }
+  double wall = host_seconds() - start;
+
+  printf("%5s %6s %6s %8s %8s %7s %8s %8s %7s %8s %9s\n", "match", "kg", "mu", "end m", "pose m",
+         "slip s", "spin s", "recov s", "range", "discs", "x real");
+  double sim = 0, slowest = INFINITY;
+  uint32_t unmoved = 0;
+  for (uint32_t i = 0; i < matches; i++) {
+    const match_result &r = results[i];
+    double realtime = r.sim_seconds / r.host_seconds;
+    printf("%5u %6.2f %6.2f %8.3f %8.3f %7.2f %8.2f %8.2f %7.2f %8u %9.0f\n", i, r.mass, r.friction,
+           r.end_error, r.pose_error, r.slip, r.spin_up, r.recovery, r.range, r.launches, realtime);
+    sim += r.sim_seconds;
+    slowest = fmin(slowest, realtime);
+
+    // a robot whose wheels cant hold the defender has to be pushed off
+    // the square further than the default one, or the sweep means nothing
+    bool outpushed = r.friction * r.mass * GRAVITY < DEFENDER_FORCE;
+    if (outpushed && !(r.slip > 0 && r.end_error > results[0].end_error)) {
+      unmoved++;
+    }
+  }
+  printf("%u matches on %u threads: %.1f s simulated in %.2f s (%.0fx real time overall, slowest thread %.0fx)\n",
+         matches, threads, sim, wall, sim / wall, slowest);
+
+  bool ok = slowest >= MIN_REALTIME && unmoved == 0;
+  printf("%s\n", ok ? "ok" : unmoved ? "FAIL: outpushed robots that held their ground"
+                                    : "FAIL: slower than 100x real time");
+  return ok ? 0 : 1;
+}
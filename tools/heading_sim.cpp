@@ -0,0 +1,162 @@
+
+/*
+ * heading_sim.cpp
+ * host simulation of heading hold on a straight drive
+ *
+ * the right side of the drive is modeled a few percent weak (the usual
+ * reason we drift) and halfway through the robot takes a yaw hit, like
+ * clipping a game object. we drive once open loop and once with heading
+ * hold and report drift, steady state error and recovery time
+ *
+ * usage:
+ *   heading_sim [seconds]
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "heading.h"
+#include "v5_sim.h"
+
+
+// drive geometry (4in wheels, 12in track) and ports as wired in main.cpp
+#define WHEEL_DIAMETER 0.1016
+#define TRACK_WIDTH 0.305
+#define LEFT_A 10
+#define LEFT_B 19
+#define RIGHT_A 0
+#define RIGHT_B 9
+#define IMU 2
+
+// disturbance model
+#define WEAK_SIDE_GAIN 0.93   // right side output vs commanded
+#define HIT_AT 2.0            // seconds
+#define HIT_LENGTH 0.2        // seconds
+#define HIT_RATE 40.0         // extra yaw rate during the hit (deg/s)
+#define IMU_NOISE 0.05        // degrees, uniform
+
+// pass/fail
+#define MAX_STEADY_ERROR 0.5  // degrees
+#define MAX_RECOVERY 1.0      // seconds
+
+
+struct result {
+  double final_heading;
+  double steady_error; // mean |error| over the last second
+  double worst_error;
+  double recovery;     // seconds from the hit until |error| stays under 0.5
+  double tick_ns;      // mean host time per heading hold tick
+};
+
+
+static double host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double side_speed(int32_t a, int32_t b) {
+  double rpm = (sim_motor_get(a)->rpm + sim_motor_get(b)->rpm) / 2;
+  return rpm / 60.0 * M_PI * WHEEL_DIAMETER;
+}
+
+static result run(double seconds, bool hold) {
+  result r = {0, 0, 0, 0, 0};
+
+  sim_motor_reset();
+  sim_motor_get(RIGHT_A)->gain = WEAK_SIDE_GAIN;
+  sim_motor_get(RIGHT_B)->gain = WEAK_SIDE_GAIN;
+
+  drivetrain dt(LEFT_A, LEFT_B, RIGHT_A, RIGHT_B, DRIVETRAIN_SPEED);
+  heading_hold heading(IMU);
+
+  double yaw = 0;
+  sim_imu_set(IMU, yaw);
+  if (hold) {
+    heading.hold(0);
+  }
+
+  double settled_since = -1;
+  double steady_sum = 0;
+  int steady_count = 0;
+  double tick_total = 0;
+  int ticks = 0;
+
+  uint32_t steps = (uint32_t)(seconds * 1000);
+  for (uint32_t ms = 0; ms < steps; ms++) {
+    double t = ms / 1000.0;
+
+    // drive tick
+    if (ms % DRIVE_PERIOD == 0) {
+      double noise = ((rand() / (double)RAND_MAX) * 2 - 1) * IMU_NOISE;
+      sim_imu_set(IMU, yaw + noise);
+
+      double start = host_ns();
+      heading.drive(dt, DRIVETRAIN_SPEED);
+      tick_total += host_ns() - start;
+      ticks++;
+    }
+
+    // physics at 1 khz
+    sim_motor_step(0.001);
+    sim_time_advance(1000);
+
+    double rate = (side_speed(LEFT_A, LEFT_B) - side_speed(RIGHT_A, RIGHT_B)) / TRACK_WIDTH;
+    yaw += rate * 180.0 / M_PI * 0.001;
+    if (t >= HIT_AT && t < HIT_AT + HIT_LENGTH) {
+      yaw += HIT_RATE * 0.001;
+    }
+
+    double error = fabs(heading_wrap(yaw));
+    if (t >= HIT_AT) {
+      r.worst_error = fmax(r.worst_error, error);
+      if (error < MAX_STEADY_ERROR) {
+        if (settled_since < 0) settled_since = t;
+      }
+      else {
+        settled_since = -1;
+      }
+    }
+
+    if (t >= seconds - 1.0) {
+      steady_sum += error;
+      steady_count++;
+    }
+  }
+
+  r.final_heading = yaw;
+  r.steady_error = steady_sum / steady_count;
+  r.recovery = settled_since < 0 ? seconds : settled_since - HIT_AT;
+  r.tick_ns = tick_total / ticks;
+  return r;
+}
+
+
+int main(int argc, char **argv) {
+  double seconds = argc >= 2 ? atof(argv[1]) : 5.0;
+  if (seconds < HIT_AT + 2) {
+    seconds = HIT_AT + 2;
+  }
+
+  srand(1);
+  result open = run(seconds, false);
+  result held = run(seconds, true);
+
+  printf("open loop:    final heading %7.2f deg\n", open.final_heading);
+  printf("heading hold: final heading %7.2f deg\n", held.final_heading);
+  printf("heading hold: steady state error %.3f deg, worst %.2f deg\n", held.steady_error, held.worst_error);
+  printf("heading hold: recovery after hit %.0f ms\n", held.recovery * 1000);
+  printf("heading hold: %.0f ns per tick on this host\n", held.tick_ns);
+
+  bool ok = held.steady_error < MAX_STEADY_ERROR && held.recovery < MAX_RECOVERY;
+  printf("heading hold: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
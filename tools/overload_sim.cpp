@@ -0,0 +1,196 @@
+
+/*
+ * overload_sim.cpp
+ * the robot's periodic tasks through an overload, with and without
+ * shedding the best effort ones
+ *
+ * the drive tick, telemetry, the controller screen and the crash
+ * checkpoint run on a model of the brain's scheduler: cooperative, the
+ * highest priority task that is due goes next and runs until it is done
+ * or yields.
+ * partway through, everything gets slower than the cpu can keep up with
+ * (the serial link backs up, the radio stalls, the drive tick has more to
+ * do) and then goes back to normal. run once with the best effort tasks
+ * treated like control (nothing ever shed) and once as declared. reports
+ * how the drive tick held its deadline and what the rest gave up
+ *
+ * usage:
+ *   overload_sim [load x]
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "periodic.h"
+#include "controller_display.h"
+#include "crash_recorder.h"
+#include "v5_sim.h"
+
+
+#define RUN_LENGTH 10.0       // s
+#define OVERLOAD_START 3.0    // s
+#define OVERLOAD_END 6.0      // s
+
+// how much longer everything takes while overloaded
+#define OVERLOAD_FACTOR 4.0
+
+// the tasks main.cpp runs, most important first, what one piece of a run
+// costs on the brain normally (us) and how many pieces it yields between
+// (the checkpoint gives the cpu up before each chunk of the file)
+struct sim_task {
+  const char *name;
+  uint32_t period;
+  uint32_t deadline;
+  periodic_kind kind;
+  double cost;
+  uint32_t pieces;
+};
+static const sim_task sim_tasks[] = {
+  { "drive", DRIVE_PERIOD, DRIVE_DEADLINE, PERIODIC_CONTROL, 1200, 1 },
+  { "telemetry", TELEMETRY_PERIOD, TELEMETRY_PERIOD, PERIODIC_BEST_EFFORT, 1500, 1 },
+  { "screen", CONTROLLER_TEXT_PERIOD, CONTROLLER_TEXT_PERIOD, PERIODIC_BEST_EFFORT, 2500, 1 },
+  { "crash", CRASH_CHECKPOINT_PERIOD, CRASH_CHECKPOINT_PERIOD, PERIODIC_BEST_EFFORT, 800,
+    CRASH_RING_TICKS / CRASH_WRITE_CHUNK },
+};
+#define TASK_COUNT (sizeof(sim_tasks) / sizeof(sim_tasks[0]))
+
+struct run_result {
+  uint32_t runs[TASK_COUNT];
+  uint32_t overruns[TASK_COUNT];
+  uint32_t shed[TASK_COUNT];
+  uint32_t skipped[TASK_COUNT];
+  uint32_t overload_overruns;   // drive, while overloaded
+  uint32_t late_max;            // us, drive
+  uint32_t stretch_max;
+  uint32_t stretch_end;
+};
+
+
+static void nothing(void) {
+}
+
+// one run in a child of its own, the task tables only ever fill up
+static run_result simulate(bool shedding, double load) {
+  run_result r = {};
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    exit(1);
+  }
+
+  fflush(stdout);
+  pid_t child = fork();
+  if (child != 0) {
+    close(fds[1]);
+    if (read(fds[0], &r, sizeof(r)) != sizeof(r)) {
+      fprintf(stderr, "run didnt finish\n");
+      exit(1);
+    }
+    close(fds[0]);
+    waitpid(child, NULL, 0);
+    return r;
+  }
+
+  close(fds[0]);
+  sim_time_advance(1000000);
+
+  periodic_task *tasks[TASK_COUNT];
+  uint32_t left[TASK_COUNT] = {};   // pieces to go in a run that yielded
+  for (uint32_t i = 0; i < TASK_COUNT; i++) {
+    const sim_task &t = sim_tasks[i];
+    tasks[i] = new periodic_task(t.name, t.period, t.deadline, shedding ? t.kind : PERIODIC_CONTROL, nothing);
+    tasks[i]->start();
+  }
+
+  uint64_t begin = sim_time_now();
+  uint64_t end = begin + (uint64_t)(RUN_LENGTH * 1e6);
+  while (sim_time_now() < end) {
+    double t = (sim_time_now() - begin) / 1e6;
+    bool overloaded = t >= OVERLOAD_START && t < OVERLOAD_END;
+
+    // the first task that is due or partway through a run, in priority
+    // order, or sleep to the next
+    int32_t next = -1;
+    uint32_t soonest = UINT32_MAX;
+    for (uint32_t i = 0; i < TASK_COUNT && next < 0; i++) {
+      uint32_t release = tasks[i]->release();
+      if (left[i] > 0 || (uint64_t)release * 1000 <= sim_time_now()) {
+        next = i;
+      }
+      soonest = release < soonest ? release : soonest;
+    }
+    if (next < 0) {
+      sim_time_advance((uint64_t)soonest * 1000 - sim_time_now());
+      continue;
+    }
+
+    // one piece, then back to the scheduler
+    periodic_task *task = tasks[next];
+    if (left[next] == 0) {
+      if (!task->begin()) {
+        continue;
+      }
+      left[next] = sim_tasks[next].pieces;
+    }
+    double cost = sim_tasks[next].cost * (overloaded ? load : 1.0);
+    sim_time_advance((uint64_t)cost);
+    if (--left[next] == 0) {
+      uint32_t overruns = task->overruns();
+      task->end();
+      if (next == 0 && overloaded) {
+        r.overload_overruns += task->overruns() - overruns;
+      }
+    }
+    r.stretch_max = periodic_stretch() > r.stretch_max ? periodic_stretch() : r.stretch_max;
+  }
+
+  for (uint32_t i = 0; i < TASK_COUNT; i++) {
+    r.runs[i] = tasks[i]->runs();
+    r.overruns[i] = tasks[i]->overruns();
+    r.shed[i] = tasks[i]->shed();
+    r.skipped[i] = tasks[i]->skipped();
+  }
+  r.late_max = tasks[0]->timing()->late.max.load();
+  r.stretch_end = periodic_stretch();
+
+  if (write(fds[1], &r, sizeof(r)) != sizeof(r)) {
+    _exit(1);
+  }
+  _exit(0);
+}
+
+static void print(const char *name, const run_result &r, bool shedding) {
+  printf("%s: drive late max %u us, %u overruns while overloaded", name, r.late_max, r.overload_overruns);
+  if (shedding) {
+    printf(", best effort every %u at most", r.stretch_max);
+  }
+  printf("\n");
+  for (uint32_t i = 0; i < TASK_COUNT; i++) {
+    printf("  %-10s runs %5u  over %4u  shed %4u  skipped %4u\n", sim_tasks[i].name,
+           r.runs[i], r.overruns[i], r.shed[i], r.skipped[i]);
+  }
+}
+
+
+int main(int argc, char **argv) {
+  double load = argc >= 2 ? atof(argv[1]) : OVERLOAD_FACTOR;
+
+  printf("%.0f s, everything %.1fx slower from %.0f to %.0f s\n", RUN_LENGTH, load, OVERLOAD_START, OVERLOAD_END);
+  run_result all = simulate(false, load);
+  run_result shed = simulate(true, load);
+  print("nothing shed", all, false);
+  print("best effort shed", shed, true);
+
+  // the drive tick keeps its deadline better and never gives up a run,
+  // and everything is back to every release once the load is gone
+  bool ok = shed.overload_overruns < all.overload_overruns && shed.shed[0] == 0 &&
+            shed.skipped[0] <= all.skipped[0] && shed.stretch_end == 1;
+  printf("%s\n", ok ? "ok" : "FAIL: shedding didnt protect the drive tick");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+
+/*
+ * pose_replay.cpp
+ * replay recorded drive ticks through the pose filter
+ *
+ * usage:
+ *   pose_replay                                 replay a built in synthetic run
+ *   pose_replay <pose.csv>                      replay a log saved by the robot
+ *   pose_replay --synthetic <out.csv> [seconds] write the synthetic run as a log
+ *
+ * the log is what pose_log::save writes, optionally with the true pose as
+ * three extra columns (true_x,true_y,true_theta). with the truth we score
+ * odometry alone, odometry + imu and the full filter against it, without
+ * it we just report where each one thinks the robot ended up
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "pose.h"
+
+
+struct tick {
+  pose_sample sample;
+  bool has_truth;
+  pose truth;
+};
+
+struct run_log {
+  pose start;
+  std::vector<landmark> landmarks;
+  std::vector<tick> ticks;
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*    synthetic run                                                           */
+/*----------------------------------------------------------------------------*/
+
+// what the real robot does that odometry doesnt know about
+#define SYN_SCALE_LEFT 1.01       // encoder reads this much more than the ground moved
+#define SYN_SCALE_RIGHT 0.99
+#define SYN_TRACK_SCRUB 1.08      // effective track width vs the measured one
+#define SYN_SLIP 0.02             // fraction of wheel travel lost driving straight
+#define SYN_IMU_DRIFT 1.0         // degrees per minute
+#define SYN_IMU_NOISE 0.05        // degrees
+#define SYN_BEARING_NOISE 0.7     // degrees
+#define SYN_FALSE_RATE 0.03       // fraction of frames that see something that isnt a landmark
+#define SYN_RANGE 4.0             // m, farther than this is too small to see
+
+static double gaussian(void) {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double wrap(double radians) {
+  return atan2(sin(radians), cos(radians));
+}
+
+// laps of a 2.4 m square, straights on time, turns until the true heading
+// is round (like a gyro turn would)
+static run_log synthetic(double seconds) {
+  run_log log;
+  log.start = { 0.6, 0.6, 0 };
+  log.landmarks = {
+    { 1, 0.0, 1.83 },    // red goal
+    { 2, 3.66, 1.83 },   // blue goal
+    { 3, 1.83, 3.66 },   // two yellow posts, same signature
+    { 3, 1.83, 0.0 },
+  };
+
+  srand(1);
+  double x = log.start.x, y = log.start.y, theta = log.start.theta;
+  double left = 0, right = 0;          // encoder degrees
+  double target = 0;                   // heading the current leg ends on
+  bool turning = false;
+  double leg_start = 0;
+
+  double half = VISION_WIDTH / 2.0;
+  double focal = half / tan(VISION_FOV * M_PI / 360);
+  double wheel = M_PI * DRIVE_WHEEL_DIAMETER;
+
+  const double dt = 0.001;
+  for (int ms = 0; ms < seconds * 1000; ms++) {
+    double t = ms / 1000.0;
+
+    // wheel surface speeds (m/s)
+    double vl, vr;
+    if (!turning) {
+      vl = vr = 150 / 60.0 * wheel;
+      if (t - leg_start > 3.0) {
+        turning = true;
+        target = wrap(target + M_PI / 2);
+      }
+    } else {
+      vl = -60 / 60.0 * wheel;
+      vr = -vl;
+      if (fabs(wrap(target - theta)) < 0.02) {
+        turning = false;
+        leg_start = t;
+      }
+    }
+
+    // ground moves a bit less than the wheels, and turns a lot less
+    double gl = vl * (1 - SYN_SLIP) * dt, gr = vr * (1 - SYN_SLIP) * dt;
+    double ds = (gl + gr) / 2;
+    double dth = (gr - gl) / (DRIVE_TRACK_WIDTH * SYN_TRACK_SCRUB);
+    x += ds * cos(theta + dth / 2);
+    y += ds * sin(theta + dth / 2);
+    theta = wrap(theta + dth);
+
+    left += vl * dt / wheel * 360 * SYN_SCALE_LEFT;
+    right += vr * dt / wheel * 360 * SYN_SCALE_RIGHT;
+
+    if (ms % DRIVE_PERIOD != 0) {
+      continue;
+    }
+
+    tick k;
+    memset(&k, 0, sizeof(k));
+    k.sample.time = ms;
+    k.sample.left = left;
+    k.sample.right = right;
+    double turned = (theta - log.start.theta) * 180 / M_PI;
+    k.sample.heading = -turned + SYN_IMU_DRIFT * t / 60 + gaussian() * SYN_IMU_NOISE;
+
+    // a new frame every 20 ms, biggest (closest) landmark in view
+    if (ms % 20 == 0) {
+      double best = SYN_RANGE;
+      for (const landmark &l : log.landmarks) {
+        double range = hypot(l.x - x, l.y - y);
+        double bearing = wrap(atan2(l.y - y, l.x - x) - theta);
+        if (range < best && fabs(bearing) < VISION_FOV * M_PI / 360) {
+          best = range;
+          k.sample.signature = l.signature;
+          double seen = bearing + gaussian() * SYN_BEARING_NOISE * M_PI / 180;
+          k.sample.x_center = (int16_t)lround(half - focal * tan(seen));
+        }
+      }
+
+      if (rand() < SYN_FALSE_RATE * RAND_MAX) {
+        k.sample.signature = 1 + rand() % 3;
+        k.sample.x_center = rand() % VISION_WIDTH;
+      }
+    }
+
+    k.has_truth = true;
+    k.truth = { x, y, theta };
+    log.ticks.push_back(k);
+  }
+
+  return log;
+}
+
+static void write_log(const run_log &log, const char *path) {
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    perror(path);
+    exit(1);
+  }
+
+  fprintf(out, "# start %.3f %.3f %.4f\n", log.start.x, log.start.y, log.start.theta);
+  for (const landmark &l : log.landmarks) {
+    fprintf(out, "# landmark %u %.3f %.3f\n", l.signature, l.x, l.y);
+  }
+  fprintf(out, "time_ms,left_deg,right_deg,heading_deg,signature,x_center,true_x,true_y,true_theta\n");
+  for (const tick &k : log.ticks) {
+    const pose_sample &s = k.sample;
+    fprintf(out, "%u,%.2f,%.2f,%.3f,%u,%d,%.4f,%.4f,%.5f\n", s.time, s.left, s.right, s.heading,
+            s.signature, s.x_center, k.truth.x, k.truth.y, k.truth.theta);
+  }
+  fclose(out);
+}
+
+static run_log load(const char *path) {
+  run_log log;
+  log.start = { 0, 0, 0 };
+
+  FILE *in = fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    exit(1);
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    landmark l;
+    unsigned sig;
+    if (sscanf(line, "# start %lf %lf %lf", &log.start.x, &log.start.y, &log.start.theta) == 3) {
+      continue;
+    }
+    if (sscanf(line, "# landmark %u %lf %lf", &sig, &l.x, &l.y) == 3) {
+      l.signature = sig;
+      log.landmarks.push_back(l);
+      continue;
+    }
+
+    tick k;
+    unsigned time;
+    int x_center;
+    if (sscanf(line, "%u,%f,%f,%f,%u,%d", &time, &k.sample.left, &k.sample.right,
+               &k.sample.heading, &sig, &x_center) != 6) {
+      continue;
+    }
+    k.sample.time = time;
+    k.sample.signature = sig;
+    k.sample.x_center = x_center;
+
+    // truth is the last three columns if there are nine
+    const char *p = line;
+    for (int comma = 0; comma < 6 && p != NULL; comma++) {
+      p = strchr(p, ',');
+      if (p) p++;
+    }
+    k.has_truth = p != NULL && sscanf(p, "%lf,%lf,%lf", &k.truth.x, &k.truth.y, &k.truth.theta) == 3;
+    log.ticks.push_back(k);
+  }
+
+  fclose(in);
+  return log;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*    replay                                                                  */
+/*----------------------------------------------------------------------------*/
+
+enum sources { ODOMETRY = 0, IMU = 1, VISION = 2 };
+
+struct score {
+  double rms;          // m
+  double final;        // m
+  double heading;      // degrees rms
+  pose end;
+  uint32_t accepted;
+  uint32_t rejected;
+  double mean_us;
+  double max_us;
+};
+
+static double host_us(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static score replay(const run_log &log, int use) {
+  pose_filter filter(log.landmarks.data(), log.landmarks.size());
+  filter.reset(log.start);
+
+  score s;
+  memset(&s, 0, sizeof(s));
+  double sum = 0, heading = 0, total_us = 0;
+  uint32_t truths = 0;
+
+  for (const tick &k : log.ticks) {
+    double start = host_us();
+    if (use == VISION) {
+      filter.step(k.sample);
+    } else {
+      filter.predict(k.sample.left, k.sample.right);
+      if (use == IMU) {
+        filter.update_heading(k.sample.heading);
+      }
+    }
+    double us = host_us() - start;
+    total_us += us;
+    s.max_us = fmax(s.max_us, us);
+
+    if (k.has_truth) {
+      pose p = filter.get();
+      double e = hypot(p.x - k.truth.x, p.y - k.truth.y);
+      double h = wrap(p.theta - k.truth.theta) * 180 / M_PI;
+      sum += e * e;
+      heading += h * h;
+      s.final = e;
+      truths++;
+    }
+  }
+
+  s.rms = truths ? sqrt(sum / truths) : NAN;
+  s.heading = truths ? sqrt(heading / truths) : NAN;
+  if (!truths) s.final = NAN;
+  s.end = filter.get();
+  s.accepted = filter.accepted();
+  s.rejected = filter.rejected();
+  s.mean_us = total_us / log.ticks.size();
+  return s;
+}
+
+
+int main(int argc, char **argv) {
+  run_log log;
+
+  if (argc >= 3 && strcmp(argv[1], "--synthetic") == 0) {
+    log = synthetic(argc >= 4 ? atof(argv[3]) : 60);
+    write_log(log, argv[2]);
+    printf("wrote %zu ticks to %s\n", log.ticks.size(), argv[2]);
+    return 0;
+  }
+  log = argc >= 2 ? load(argv[1]) : synthetic(60);
+
+  if (log.ticks.size() < 2) {
+    fprintf(stderr, "log is too short\n");
+    return 1;
+  }
+
+  printf("%zu ticks (%.1f s), %zu landmarks\n", log.ticks.size(),
+         (log.ticks.back().sample.time - log.ticks.front().sample.time) / 1000.0, log.landmarks.size());
+  printf("%-14s %8s %8s %10s %22s %9s %9s %8s %8s\n", "sources", "rms m", "final m", "heading",
+         "end x y theta", "accepted", "rejected", "mean us", "max us");
+
+  static const char *names[] = { "odometry", "+ imu", "+ vision" };
+  score scores[3];
+  for (int use = ODOMETRY; use <= VISION; use++) {
+    score s = scores[use] = replay(log, use);
+    printf("%-14s %8.3f %8.3f %10.2f %8.2f %6.2f %6.1f %9u %9u %8.2f %8.2f\n", names[use],
+           s.rms, s.final, s.heading, s.end.x, s.end.y, s.end.theta * 180 / M_PI,
+           s.accepted, s.rejected, s.mean_us, s.max_us);
+  }
+
+  printf("budget on the brain is %d us per tick\n", POSE_BUDGET_US);
+
+  // with the truth there, fusing the landmarks has to be worth it
+  if (!isnan(scores[VISION].rms) && scores[VISION].rms >= scores[IMU].rms) {
+    printf("FAIL: vision made the pose worse\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,178 @@
+
+/*
+ * push_sim.cpp
+ * a pushing match on the field model, fixed current limits against the
+ * current arbiter
+ *
+ * the match goes back and forth: the robot drives flat out into a
+ * defender that pushes back, then the defender backs off and the robot
+ * stops and shoots, a disc going through the flywheel whenever it is in
+ * the ready band (no faster than the indexer can feed). the flywheel is
+ * on the whole time. the motors share a budget too small for all of them
+ * at once: one run splits it evenly across the motors up front, the way
+ * each motor gets set up on its own, the other lets the arbiter move it
+ * every tick. reports the ground the robot won, the discs it got off and
+ * what an arbiter tick costs
+ *
+ * usage:
+ *   push_sim [budget mA] [defender N]
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "flywheel.h"
+#include "velocity.h"
+#include "motor_cache.h"
+#include "current_arbiter.h"
+#include "v5_sim.h"
+#include "field_sim.h"
+
+
+#define MATCH_LENGTH 30.0     // s
+#define PUSH_TIME 3.0         // s of pushing, then
+#define SHOOT_TIME 2.0        // s of shooting, over and over
+#define TUNE_RPM 500          // flywheel, a 6:1 has no load headroom at 600
+#define FEED_PERIOD 0.2       // s, fastest the indexer puts a disc in
+
+// what every motor together may draw (mA), well under the five motors'
+// 12.5 A so there is something to share
+#define PUSH_BUDGET 3000
+
+// how hard the defender pushes (N), a bit under what the robot's wheels
+// hold on the tiles
+#define DEFENDER_FORCE 40.0
+
+enum push_mode {
+  PUSH_UNLIMITED = 0,
+  PUSH_STATIC = 1,
+  PUSH_ARBITER = 2
+};
+
+struct match_result {
+  double ground;          // m the robot moved forward
+  uint32_t discs;
+  double ready;           // fraction of the match the flywheel was ready
+  double update_ns;       // host time per arbiter tick
+};
+
+
+static double host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static match_result match(push_mode mode, int32_t budget, double defender) {
+  match_result r = { 0, 0, 0, 0 };
+  sim_robot_config c = sim_robot_defaults();
+  sim_field_setup(c, 0, 0, 0);
+
+  // the reads and groups main.cpp has
+  const motor_read reads[] = {
+    { c.left[0], MOTOR_VELOCITY | MOTOR_CURRENT }, { c.left[1], MOTOR_CURRENT },
+    { c.right[0], MOTOR_VELOCITY | MOTOR_CURRENT }, { c.right[1], MOTOR_CURRENT },
+    { c.flywheel, MOTOR_RAW | MOTOR_CURRENT },
+  };
+  motor_cache motors(reads, 5);
+
+  const int32_t drive_ports[] = { c.left[0], c.left[1], c.right[0], c.right[1] };
+  const int32_t flywheel_ports[] = { c.flywheel };
+  const arbiter_group groups[] = {
+    { "drive", drive_ports, 4, 1 },
+    { "flywheel", flywheel_ports, 1, 0 },
+  };
+  current_arbiter arbiter(groups, 2, budget);
+
+  if (mode == PUSH_STATIC) {
+    for (int i = 0; i < 5; i++) {
+      vexMotorCurrentLimitSet(reads[i].port, budget / 5);
+    }
+  }
+
+  drivetrain dt(c.left[0], c.left[1], c.right[0], c.right[1], DRIVETRAIN_SPEED);
+  velocity_estimator speed(MOTOR_COUNTS_6, VELOCITY_KALMAN);
+  flywheel_control flywheel;
+  double last_feed = -FEED_PERIOD;
+  double update_total = 0;
+  uint32_t updates = 0;
+  uint32_t ready_ticks = 0, ticks = 0;
+
+  for (uint32_t ms = 0; ms < MATCH_LENGTH * 1000; ms++) {
+    double t = ms / 1000.0;
+    if (ms % DRIVE_PERIOD == 0) {
+      motors.refresh();
+      speed.update((uint64_t)motors.raw_time(c.flywheel) * 1000, motors.raw(c.flywheel));
+
+      bool pushing = fmod(t, PUSH_TIME + SHOOT_TIME) < PUSH_TIME;
+      sim_field_push(pushing ? defender : 0);
+      if (pushing) {
+        dt.tank(DRIVETRAIN_SPEED, DRIVETRAIN_SPEED);
+      } else {
+        dt.stop(kV5MotorBrakeModeHold);
+      }
+      vexMotorVoltageSet(c.flywheel, flywheel.update(TUNE_RPM, speed.rpm()));
+
+      // the indexer only feeds a flywheel that is up to speed
+      bool ready = fabs(sim_field_state()->flywheel_rpm - TUNE_RPM) < FLYWHEEL_READY_BAND;
+      ready_ticks += ready;
+      ticks++;
+      if (!pushing && ready && t - last_feed >= FEED_PERIOD) {
+        sim_field_launch();
+        last_feed = t;
+      }
+
+      if (mode == PUSH_ARBITER) {
+        double start = host_ns();
+        arbiter.update(motors);
+        update_total += host_ns() - start;
+        updates++;
+      }
+    }
+    sim_field_step(0.001);
+    sim_time_advance(1000);
+  }
+
+  r.ground = sim_field_state()->x;
+  r.discs = sim_field_state()->launches;
+  r.ready = (double)ready_ticks / ticks;
+  r.update_ns = updates > 0 ? update_total / updates : 0;
+  return r;
+}
+
+static void print(const char *name, const match_result &r) {
+  printf("%-12s %+6.2f m  %3u discs  ready %3.0f%%", name, r.ground, r.discs, r.ready * 100);
+  if (r.update_ns > 0) {
+    printf("  %4.0f ns per arbiter tick", r.update_ns);
+  }
+  printf("\n");
+}
+
+
+int main(int argc, char **argv) {
+  int32_t budget = argc >= 2 ? atoi(argv[1]) : PUSH_BUDGET;
+  double defender = argc >= 3 ? atof(argv[2]) : DEFENDER_FORCE;
+
+  match_result unlimited = match(PUSH_UNLIMITED, budget, defender);
+  match_result fixed = match(PUSH_STATIC, budget, defender);
+  match_result arbitrated = match(PUSH_ARBITER, budget, defender);
+
+  printf("%d mA between 5 motors, defender %.0f N, %.0f s\n", budget, defender, MATCH_LENGTH);
+  print("no budget", unlimited);
+  print("fixed split", fixed);
+  print("arbiter", arbitrated);
+
+  // more of one without giving up any of the other
+  bool ok = arbitrated.ground >= fixed.ground && arbitrated.discs >= fixed.discs &&
+            (arbitrated.ground > fixed.ground || arbitrated.discs > fixed.discs);
+  printf("%s\n", ok ? "ok" : "FAIL: the arbiter didnt beat a fixed split");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+
+/*
+ * slew_sim.cpp
+ * current draw of a standing start with and without output shaping
+ *
+ * the drive goes from rest to full driver speed and the flywheel from
+ * stop to its target in the same tick, on the field model. run once with
+ * the commands going straight out, once through the acceleration and
+ * jerk limits, and once more with a current budget small enough to
+ * matter. reports the peak total current, how long each took to get to
+ * speed and what a shaped step costs
+ *
+ * usage:
+ *   slew_sim [budget mA]
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "params.h"
+#include "drivetrain.h"
+#include "flywheel.h"
+#include "velocity.h"
+#include "slew.h"
+#include "v5_sim.h"
+#include "field_sim.h"
+
+
+#define RUN_LENGTH 3.0        // s
+#define TUNE_RPM 500          // flywheel, a 6:1 has no load headroom at 600
+
+// budget for the last run (mA), under what the shaped start draws so the
+// drive and flywheel have to share it
+#define TIGHT_BUDGET 2000
+
+// the model's real current may run over the estimate by this much
+#define BUDGET_SLACK 1.1
+
+
+struct run_result {
+  double peak;            // mA, all motors
+  double peak_drive;
+  double drive_time;      // s to 95% of the drive target
+  double flywheel_time;   // s to within the ready band
+  double step_ns;         // host time per shaped step
+};
+
+
+static double host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static run_result run(bool shaped, double budget) {
+  run_result r = { 0, 0, RUN_LENGTH, RUN_LENGTH, 0 };
+  sim_robot_config c = sim_robot_defaults();
+  sim_field_setup(c, 0, 0, 0);
+
+  // the drive reads one velocity per side, like main.cpp
+  const motor_read reads[] = {
+    { c.left[0], MOTOR_VELOCITY }, { c.right[0], MOTOR_VELOCITY },
+  };
+  motor_cache motors(reads, 2);
+  current_budget current(budget);
+
+  drivetrain dt(c.left[0], c.left[1], c.right[0], c.right[1], DRIVETRAIN_SPEED);
+  velocity_estimator speed(MOTOR_COUNTS_6, VELOCITY_KALMAN);
+  flywheel_control flywheel;
+  if (shaped) {
+    dt.shape({ DRIVE_SLEW_ACCEL, DRIVE_SLEW_JERK }, &current, &motors);
+    flywheel.shape({ FLYWHEEL_SLEW_ACCEL, FLYWHEEL_SLEW_JERK }, &current);
+  }
+
+  const int32_t ports[] = { c.left[0], c.left[1], c.right[0], c.right[1], c.flywheel };
+  double step_total = 0;
+  uint32_t steps = 0;
+
+  for (uint32_t ms = 0; ms < RUN_LENGTH * 1000; ms++) {
+    double t = ms / 1000.0;
+    if (ms % DRIVE_PERIOD == 0) {
+      motors.refresh();
+      uint32_t stamp;
+      int32_t counts = vexMotorPositionRawGet(c.flywheel, &stamp);
+      speed.update((uint64_t)stamp * 1000, counts);
+
+      double start = host_ns();
+      dt.tank(DRIVETRAIN_SPEED, DRIVETRAIN_SPEED);
+      int32_t mv = flywheel.update(TUNE_RPM, speed.rpm());
+      step_total += host_ns() - start;
+      steps++;
+      vexMotorVoltageSet(c.flywheel, mv);
+    }
+    sim_field_step(0.001);
+    sim_time_advance(1000);
+
+    double total = 0;
+    for (int i = 0; i < 5; i++) {
+      total += sim_motor_get(ports[i])->current;
+    }
+    r.peak = fmax(r.peak, total);
+    r.peak_drive = fmax(r.peak_drive, total - sim_motor_get(c.flywheel)->current);
+
+    if (r.drive_time == RUN_LENGTH && sim_motor_get(c.left[0])->rpm >= 0.95 * DRIVETRAIN_SPEED) {
+      r.drive_time = t;
+    }
+    if (r.flywheel_time == RUN_LENGTH && fabs(sim_field_state()->flywheel_rpm - TUNE_RPM) < FLYWHEEL_READY_BAND) {
+      r.flywheel_time = t;
+    }
+  }
+
+  r.step_ns = step_total / steps;
+  return r;
+}
+
+static void print(const char *name, const run_result &r) {
+  printf("%-16s peak %6.0f mA (drive %6.0f)  drive up %.2f s  flywheel up %.2f s  %4.0f ns per step\n",
+         name, r.peak, r.peak_drive, r.drive_time, r.flywheel_time, r.step_ns);
+}
+
+
+int main(int argc, char **argv) {
+  double tight = argc >= 2 ? atof(argv[1]) : TIGHT_BUDGET;
+
+  run_result straight = run(false, CURRENT_BUDGET);
+  run_result shaped = run(true, CURRENT_BUDGET);
+  run_result budgeted = run(true, tight);
+
+  print("straight", straight);
+  print("shaped", shaped);
+  print("tight budget", budgeted);
+
+  bool ok = shaped.peak < straight.peak && budgeted.peak <= tight * BUDGET_SLACK;
+  printf("%s\n", ok ? "ok" : "FAIL: shaping didnt keep the current down");
+  return ok ? 0 : 1;
+}
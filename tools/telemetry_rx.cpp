@@ -0,0 +1,325 @@
+
+/*
+ * telemetry_rx.cpp
+ * host side receiver for the robot telemetry stream
+ *
+ * usage:
+ *   telemetry_rx <device>         decode a live stream (e.g. /dev/ttyACM1)
+ *   telemetry_rx --loopback [n]   push n records through a pseudo tty and check them
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "telemetry.h"
+#include "v5_sim.h"
+
+
+// the loopback puts a console line in every this many records
+#define TEXT_EVERY 64
+
+// stream state
+struct receiver {
+  uint8_t buffer[TELEMETRY_MAX_ENCODED * 2];
+  uint32_t length;
+  bool have_seq;
+  uint8_t last_seq;
+  uint32_t frames;
+  uint32_t bad;
+  uint32_t lost;
+  uint32_t text;
+  bool verbose;
+  telemetry_stats last_stats;
+  bool got_stats;
+};
+
+
+// put a tty into raw 8 bit mode so nothing gets translated
+static int make_raw(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    return -1;
+  }
+  cfmakeraw(&tio);
+  return tcsetattr(fd, TCSANOW, &tio);
+}
+
+static void print_record(uint8_t type, uint32_t stamp, const uint8_t *payload, uint32_t len) {
+  printf("%10u ", stamp);
+
+  switch (type) {
+    case TELEM_STATS: {
+      telemetry_stats s;
+      if (len != sizeof(s)) break;
+      memcpy(&s, payload, sizeof(s));
+      printf("stats sent=%u dropped=%u decimated=%u\n", s.sent, s.dropped, s.decimated);
+      return;
+    }
+
+    case TELEM_MOTOR: {
+      telemetry_motor m;
+      if (len != sizeof(m)) break;
+      memcpy(&m, payload, sizeof(m));
+      printf("motor port=%u rpm=%.1f current=%dmA voltage=%dmV temp=%.1fC\n",
+        m.port + 1, m.velocity / 10.0, m.current, m.voltage, m.temperature / 10.0);
+      return;
+    }
+
+    case TELEM_DRIVE: {
+      telemetry_drive d;
+      if (len != sizeof(d)) break;
+      memcpy(&d, payload, sizeof(d));
+      printf("drive left=%d right=%d heading=%.2f\n", d.left, d.right, d.heading / 100.0);
+      return;
+    }
+
+    case TELEM_FLYWHEEL: {
+      telemetry_flywheel f;
+      if (len != sizeof(f)) break;
+      memcpy(&f, payload, sizeof(f));
+      printf("flywheel target=%d actual=%.1f\n", f.target, f.actual / 10.0);
+      return;
+    }
+
+    case TELEM_LATENCY: {
+      telemetry_latency l;
+      if (len != sizeof(l)) break;
+      memcpy(&l, payload, sizeof(l));
+      printf("latency task=%u run p50=%uus p99=%uus late p99=%uus\n",
+        l.task, l.run_p50, l.run_p99, l.late_p99);
+      return;
+    }
+
+    case TELEM_ESTOP: {
+      telemetry_estop e;
+      if (len != sizeof(e)) break;
+      memcpy(&e, payload, sizeof(e));
+      printf("estop at=%ums motors=%u stopped in %uus\n", e.edge_ms, e.motors, e.stop_us);
+      return;
+    }
+
+    case TELEM_CURRENT: {
+      telemetry_current c;
+      if (len != sizeof(c)) break;
+      memcpy(&c, payload, sizeof(c));
+      printf("current group=%u limit=%dmA demand=%dmA drawn=%dmA\n", c.group, c.limit, c.demand, c.drawn);
+      return;
+    }
+
+    case TELEM_CPU: {
+      telemetry_cpu c;
+      if (len != sizeof(c)) break;
+      memcpy(&c, payload, sizeof(c));
+      if (c.task == TELEMETRY_CPU_OTHER) {
+        printf("cpu other %.1f%% profiling %.2f%%\n", c.share / 10.0, c.longest / 100.0);
+      } else {
+        printf("cpu task=%u %.1f%% longest=%uus\n", c.task, c.share / 10.0, c.longest);
+      }
+      return;
+    }
+
+    case TELEM_TEXT:
+      // the robot's console, a line can come in several frames
+      fwrite(payload, 1, len, stdout);
+      return;
+  }
+
+  printf("type %u (%u bytes)\n", type, len);
+}
+
+// handle one complete cobs frame (without the trailing zero)
+static void handle_frame(receiver *rx, const uint8_t *data, uint32_t len) {
+  uint8_t frame[TELEMETRY_MAX_ENCODED];
+
+  // empty frames are just back to back zeros, skip them
+  if (len == 0) {
+    return;
+  }
+
+  int32_t size = len <= sizeof(frame) ? telemetry_cobs_decode(data, len, frame) : -1;
+  if (size < TELEMETRY_HEADER_SIZE + 1 || size > TELEMETRY_MAX_FRAME
+      || telemetry_crc8(frame, size - 1) != frame[size - 1]) {
+    rx->bad++;
+    return;
+  }
+
+  uint8_t type = frame[0];
+  uint8_t seq = frame[1];
+  uint32_t stamp;
+  memcpy(&stamp, &frame[2], sizeof(stamp));
+
+  // the robot bumps seq on every frame it hands to the usb stack,
+  // so a gap here means bytes were lost after that point
+  if (rx->have_seq) {
+    rx->lost += (uint8_t)(seq - rx->last_seq - 1);
+  }
+  rx->have_seq = true;
+  rx->last_seq = seq;
+  rx->frames++;
+
+  const uint8_t *payload = &frame[TELEMETRY_HEADER_SIZE];
+  uint32_t payload_len = size - TELEMETRY_HEADER_SIZE - 1;
+
+  if (type == TELEM_TEXT) {
+    rx->text++;
+  }
+  if (type == TELEM_STATS && payload_len == sizeof(telemetry_stats)) {
+    memcpy(&rx->last_stats, payload, sizeof(telemetry_stats));
+    rx->got_stats = true;
+  }
+
+  if (rx->verbose) {
+    print_record(type, stamp, payload, payload_len);
+  }
+}
+
+// feed raw bytes from the port
+static void feed(receiver *rx, const uint8_t *data, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    if (data[i] == 0) {
+      handle_frame(rx, rx->buffer, rx->length);
+      rx->length = 0;
+      continue;
+    }
+
+    // oversized junk (line noise, stray text), drop it and wait for a zero
+    if (rx->length >= sizeof(rx->buffer)) {
+      rx->bad++;
+      rx->length = 0;
+    }
+    rx->buffer[rx->length++] = data[i];
+  }
+}
+
+
+// decode a live stream until the port closes
+static int run_live(const char *path) {
+  int fd = open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0) {
+    perror(path);
+    return 1;
+  }
+  make_raw(fd);
+
+  static receiver rx;
+  rx.verbose = true;
+
+  uint8_t chunk[512];
+  ssize_t n;
+  while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+    feed(&rx, chunk, n);
+    fflush(stdout);
+  }
+
+  fprintf(stderr, "frames=%u bad=%u lost=%u\n", rx.frames, rx.bad, rx.lost);
+  close(fd);
+  return 0;
+}
+
+
+// loopback, a child process plays the robot and writes through the
+// pseudo tty master (our stand in for the cdc channel), we read the slave
+static void robot_side(int master, uint32_t records) {
+  sim_time_real(true);
+
+  // a deliberately slow link so the sender has to drop and decimate
+  sim_serial_attach(master, 1024, 12000);
+
+  for (uint32_t i = 0; i < records; i++) {
+    // console text in among the records, it shouldnt cost any of them
+    if (i % TEXT_EVERY == 0) {
+      telemetry_printf("loopback line %u\n", (unsigned)i);
+    }
+
+    telemetry_motor m;
+    m.port = i % 21;
+    m.velocity = (int16_t)(i % 6000);
+    m.current = (int16_t)(i % 2500);
+    m.voltage = 12000;
+    m.temperature = 350;
+    telemetry_send(TELEM_MOTOR, &m, sizeof(m));
+
+    // 1 khz, faster than the modeled link can carry
+    usleep(1000);
+  }
+
+  // let the buffer empty so the final stats record always fits
+  while (vexSerialWriteFree(TELEMETRY_CHANNEL) < 1024) {
+    usleep(1000);
+  }
+  telemetry_send_stats();
+  usleep(50000);
+}
+
+static int run_loopback(uint32_t records) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+
+  int slave = open(ptsname(master), O_RDONLY | O_NOCTTY);
+  if (slave < 0 || make_raw(slave) != 0) {
+    perror(ptsname(master));
+    return 1;
+  }
+
+  pid_t child = fork();
+  if (child == 0) {
+    close(slave);
+    robot_side(master, records);
+    _exit(0);
+  }
+  close(master);
+
+  static receiver rx;
+  rx.verbose = false;
+
+  uint8_t chunk[512];
+  while (!rx.got_stats) {
+    ssize_t n = read(slave, chunk, sizeof(chunk));
+    if (n <= 0) {
+      break;
+    }
+    feed(&rx, chunk, n);
+  }
+
+  waitpid(child, NULL, 0);
+  close(slave);
+
+  // the stats snapshot is taken before its own frame goes out
+  telemetry_stats s = rx.last_stats;
+  printf("loopback: records=%u sent=%u dropped=%u decimated=%u\n", records, s.sent, s.dropped, s.decimated);
+  printf("loopback: frames=%u bad=%u lost=%u\n", rx.frames, rx.bad, rx.lost);
+
+  uint32_t lines = (records + TEXT_EVERY - 1) / TEXT_EVERY;
+  printf("loopback: text frames=%u of %u lines\n", rx.text, lines);
+  bool ok = rx.got_stats && rx.bad == 0 && rx.lost == 0 && rx.frames == s.sent + 1
+    && rx.text > 0 && s.sent + s.dropped + s.decimated == records + lines;
+  printf("loopback: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "--loopback") == 0) {
+    uint32_t records = argc >= 3 ? (uint32_t)atoi(argv[2]) : 2000;
+    return run_loopback(records);
+  }
+
+  if (argc == 2) {
+    return run_live(argv[1]);
+  }
+
+  fprintf(stderr, "usage: %s <device>\n       %s --loopback [records]\n", argv[0], argv[0]);
+  return 2;
+}
@@ -0,0 +1,142 @@
+
+/*
+ * timer_bench.cpp
+ * host check and cost of the timer wheel
+ *
+ * usage:
+ *   timer_bench [timers] [seconds]
+ *
+ * keeps [timers] timers scheduled (half periodic, half one shot that get
+ * replaced when they fire, some cancelled along the way), advances the
+ * wheel a ms at a time and checks every callback runs on the ms it was due.
+ * then times add, cancel and advance on this host
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+// robot code
+#include "timer_wheel.h"
+
+
+struct expect {
+  timer_handle handle;
+  uint32_t due;       // ms the next call should come on
+  uint32_t period;    // 0 for one shot
+  bool live;
+};
+
+static timer_wheel Wheel;
+static std::vector<expect> Timers;
+static uint32_t wrong = 0;
+static uint32_t calls = 0;
+
+static double host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// mostly short, a few out past the first and second levels
+static uint32_t random_delay(void) {
+  switch (rand() % 8) {
+    case 0: return 1 + rand() % 64;
+    case 1: return 4000 + rand() % 300000;
+    default: return 20 + rand() % 2000;
+  }
+}
+
+static void fired(void *arg);
+
+static void schedule(uint32_t i) {
+  expect &e = Timers[i];
+  uint32_t delay = random_delay();
+  e.period = i % 2 ? delay : 0;
+  e.due = Wheel.now() + delay;
+  e.handle = e.period ? Wheel.every(delay, fired, &e) : Wheel.after(delay, fired, &e);
+  e.live = e.handle != 0;
+}
+
+static void fired(void *arg) {
+  expect &e = *(expect *)arg;
+  calls++;
+  if (!e.live || Wheel.now() != e.due) {
+    wrong++;
+  }
+
+  if (e.period) {
+    e.due += e.period;
+    return;
+  }
+
+  // one shots get replaced, so the count stays up
+  e.live = false;
+  schedule(&e - Timers.data());
+}
+
+
+int main(int argc, char **argv) {
+  uint32_t count = argc >= 2 ? atoi(argv[1]) : 1500;
+  uint32_t seconds = argc >= 3 ? atoi(argv[2]) : 600;
+  if (count > TIMER_WHEEL_MAX) {
+    count = TIMER_WHEEL_MAX;
+  }
+
+  srand(1);
+  Wheel.start(0xFFFF0000);  // wraps the ms clock partway through
+  Timers.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    schedule(i);
+  }
+
+  // run, cancelling and rescheduling now and then
+  uint32_t cancels = 0, max_ran = 0;
+  std::vector<double> advance_ns;
+  for (uint32_t ms = 0; ms < seconds * 1000; ms++) {
+    if (rand() % 4 == 0) {
+      uint32_t i = rand() % count;
+      if (Wheel.cancel(Timers[i].handle)) {
+        cancels++;
+      }
+      schedule(i);
+    }
+
+    double start = host_ns();
+    uint32_t ran = Wheel.advance(Wheel.now() + 1);
+    advance_ns.push_back(host_ns() - start);
+    if (ran > max_ran) max_ran = ran;
+  }
+
+  printf("%u timers for %u s: %u calls, %u cancels, %u on the wrong ms, latest %u ms\n",
+         count, seconds, calls, cancels, wrong, Wheel.max_late());
+  // max is mostly the host scheduler, p99.9 is the wheel
+  std::sort(advance_ns.begin(), advance_ns.end());
+  printf("advance: p50 %.0f ns, p99.9 %.0f ns, max %.0f ns, most callbacks in one ms %u\n",
+         advance_ns[advance_ns.size() / 2], advance_ns[advance_ns.size() * 999 / 1000],
+         advance_ns.back(), max_ran);
+
+  // add and cancel cost, on a full wheel
+  for (uint32_t i = 0; i < count; i++) {
+    Wheel.cancel(Timers[i].handle);
+  }
+  std::vector<timer_handle> handles(TIMER_WHEEL_MAX);
+  double start = host_ns();
+  for (uint32_t i = 0; i < TIMER_WHEEL_MAX; i++) {
+    handles[i] = Wheel.after(random_delay(), fired, NULL);
+  }
+  double add_ns = (host_ns() - start) / TIMER_WHEEL_MAX;
+  start = host_ns();
+  for (uint32_t i = 0; i < TIMER_WHEEL_MAX; i++) {
+    Wheel.cancel(handles[TIMER_WHEEL_MAX - 1 - i]);
+  }
+  double cancel_ns = (host_ns() - start) / TIMER_WHEEL_MAX;
+  printf("add %.0f ns, cancel %.0f ns (%d timers, includes rand)\n", add_ns, cancel_ns, TIMER_WHEEL_MAX);
+
+  bool ok = wrong == 0 && Wheel.pending() == 0 && calls > 0;
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+
+/*
+ * velocity_bench.cpp
+ * accuracy and cost of the velocity estimators on encoder traces
+ *
+ * usage:
+ *   velocity_bench                          run on a built in flywheel trace
+ *   velocity_bench <trace.csv> [counts/rev] run on a recorded trace
+ *
+ * a trace is one sample per line: time_us,counts[,true_rpm]
+ * without a true_rpm column there is nothing to score against, so the
+ * estimators are compared to a centered difference over +-50 ms instead
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+// robot code
+#include "vex.h"
+#include "macros.h"
+#include "velocity.h"
+
+
+struct sample {
+  uint64_t time;
+  int32_t counts;
+  double truth;
+};
+
+
+// flywheel spin up to 600 rpm, a shot at 3.5s, then a slow crawl at 15 rpm
+// the motor reports every 10 ms with a ms timestamp, we poll every 5 ms
+static std::vector<sample> synthetic(double counts_per_rev) {
+  std::vector<sample> trace;
+  double position = 0;
+  double rpm = 0;
+  uint64_t reported = 0;
+  int32_t reported_counts = 0;
+
+  srand(1);
+  for (uint32_t us = 0; us < 8000000; us += 100) {
+    double t = us / 1e6;
+    double target = t < 5.0 ? 600 : 15;
+
+    // first order spin up, the shot steals 20% of the speed in 30 ms
+    rpm += (target - rpm) * (1 - exp(-0.0001 / 0.4));
+    if (t >= 3.5 && t < 3.53) {
+      rpm -= 600 * 0.2 * 0.0001 / 0.03;
+    }
+    position += rpm / 60.0 * counts_per_rev * 0.0001;
+
+    // device sample every 10 ms (+-0.5 ms), stamped to the ms
+    if (us - reported >= (uint64_t)(9500 + rand() % 1000)) {
+      reported = us;
+      reported_counts = (int32_t)floor(position);
+    }
+
+    if (us % 5000 == 0) {
+      trace.push_back({ reported / 1000 * 1000, reported_counts, rpm });
+    }
+  }
+
+  return trace;
+}
+
+static std::vector<sample> load(const char *path) {
+  std::vector<sample> trace;
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    exit(1);
+  }
+
+  char line[128];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    unsigned long long time;
+    int counts;
+    double truth = NAN;
+    if (sscanf(line, "%llu,%d,%lf", &time, &counts, &truth) >= 2) {
+      trace.push_back({ time, counts, truth });
+    }
+  }
+
+  fclose(file);
+  return trace;
+}
+
+// centered difference over +-50 ms, the best we can do with hindsight
+static void fill_reference(std::vector<sample> &trace, double counts_per_rev) {
+  for (size_t i = 0; i < trace.size(); i++) {
+    size_t lo = i, hi = i;
+    while (lo > 0 && trace[i].time - trace[lo].time < 50000) lo--;
+    while (hi + 1 < trace.size() && trace[hi].time - trace[i].time < 50000) hi++;
+    double span = (trace[hi].time - trace[lo].time) / 1e6;
+    trace[i].truth = span > 0 ? (trace[hi].counts - trace[lo].counts) / span * 60 / counts_per_rev : 0;
+  }
+}
+
+
+struct score {
+  double rms;      // rpm
+  double low_rms;  // rpm, while under 50 rpm
+  double lag;      // ms, delay that best lines the estimate up with the truth
+  double ns;       // per sample on this host
+};
+
+static score run(const std::vector<sample> &trace, double counts_per_rev, velocity_method method) {
+  velocity_estimator est(counts_per_rev, method);
+  std::vector<double> out(trace.size());
+
+  struct timespec a, b;
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  for (size_t i = 0; i < trace.size(); i++) {
+    est.update(trace[i].time, trace[i].counts);
+    out[i] = est.rpm();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &b);
+
+  score s = {0, 0, 0, 0};
+  s.ns = ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec)) / trace.size();
+
+  double sum = 0, low = 0;
+  int count = 0, low_count = 0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    double e = out[i] - trace[i].truth;
+    sum += e * e;
+    count++;
+    if (fabs(trace[i].truth) < 50) {
+      low += e * e;
+      low_count++;
+    }
+  }
+  s.rms = sqrt(sum / count);
+  s.low_rms = low_count ? sqrt(low / low_count) : 0;
+
+  // try shifting the truth later until it matches best (5 ms poll steps)
+  double best = INFINITY;
+  for (int shift = 0; shift < 40; shift++) {
+    double err = 0;
+    for (size_t i = shift; i < trace.size(); i++) {
+      double e = out[i] - trace[i - shift].truth;
+      err += e * e;
+    }
+    if (err < best) {
+      best = err;
+      s.lag = shift * 5.0;
+    }
+  }
+
+  return s;
+}
+
+
+int main(int argc, char **argv) {
+  double counts_per_rev = argc >= 3 ? atof(argv[2]) : MOTOR_COUNTS_6;
+  std::vector<sample> trace = argc >= 2 ? load(argv[1]) : synthetic(counts_per_rev);
+
+  if (trace.size() < 2) {
+    fprintf(stderr, "trace is too short\n");
+    return 1;
+  }
+  if (isnan(trace[0].truth)) {
+    fill_reference(trace, counts_per_rev);
+  }
+
+  static const char *names[] = { "adaptive", "kalman", "difference" };
+  printf("%zu samples, %.0f counts/rev\n", trace.size(), counts_per_rev);
+  printf("%-11s %10s %14s %8s %10s\n", "method", "rms rpm", "rms <50rpm", "lag ms", "ns/sample");
+
+  for (int m = 0; m < 3; m++) {
+    score s = run(trace, counts_per_rev, (velocity_method)m);
+    printf("%-11s %10.2f %14.2f %8.1f %10.1f\n", names[m], s.rms, s.low_rms, s.lag, s.ns);
+  }
+
+  return 0;
+}
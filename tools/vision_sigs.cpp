@@ -0,0 +1,300 @@
+
+/*
+ * vision_sigs.cpp
+ * turn a vision utility export into constant signature tables
+ *
+ * usage:
+ *   vision_sigs <export.txt> [out.h]   header goes to stdout without out.h
+ *
+ * the export is what the vision utility "copy code" button gives, e.g.
+ *   vex::vision::signature SIG_RED = vex::vision::signature (1, 8099, 8893, 8496, -1505, -949, -1227, 3, 0);
+ *   vex::vision::code CODE_RB = vex::vision::code (SIG_RED, SIG_BLUE);
+ *   vex::vision Vision1 = vex::vision (vex::PORT4, 50, SIG_RED, SIG_BLUE);
+ * anything else in the file is ignored
+*/
+
+// standard libs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// robot code
+#include "vex.h"
+#include "vision_sigs.h"
+
+// code members, same limit as vision::code
+#define CODE_MAX_MEMBERS 5
+#define CODE_COUNT_MAX 16
+#define NAME_MAX_LEN 48
+
+
+struct named_sig {
+  char name[NAME_MAX_LEN];
+  vision_sig sig;
+  int line;
+};
+
+struct named_code {
+  char name[NAME_MAX_LEN];
+  int members[CODE_MAX_MEMBERS];   // index into the signature list
+  int count;
+};
+
+static named_sig sigs[VISION_SIG_COUNT];
+static int sig_count = 0;
+static named_code codes[CODE_COUNT_MAX];
+static int code_count = 0;
+static int brightness = -1;
+
+
+static void fail(int line, const char *what, const char *detail) {
+  fprintf(stderr, "line %d: %s %s\n", line, what, detail ? detail : "");
+  exit(1);
+}
+
+// identifier right before the '=', false if there isnt one
+static bool lhs_name(const char *text, char *name) {
+  const char *eq = strchr(text, '=');
+  if (eq == NULL) {
+    return false;
+  }
+
+  const char *end = eq;
+  while (end > text && isspace((unsigned char)end[-1])) end--;
+  const char *start = end;
+  while (start > text && (isalnum((unsigned char)start[-1]) || start[-1] == '_')) start--;
+
+  size_t len = end - start;
+  if (len == 0 || len >= NAME_MAX_LEN) {
+    return false;
+  }
+  memcpy(name, start, len);
+  name[len] = 0;
+  return true;
+}
+
+// the text inside the constructor parentheses after the '='
+static bool rhs_args(const char *text, char *args, size_t size) {
+  const char *open = strchr(strchr(text, '='), '(');
+  const char *close = open ? strrchr(open, ')') : NULL;
+  if (open == NULL || close == NULL || (size_t)(close - open) >= size) {
+    return false;
+  }
+  memcpy(args, open + 1, close - open - 1);
+  args[close - open - 1] = 0;
+  return true;
+}
+
+static int find_sig(const char *name) {
+  for (int i = 0; i < sig_count; i++) {
+    if (strcmp(sigs[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// next comma separated identifier (namespace stripped), false at the end
+static bool next_name(char **cursor, char *name) {
+  char *p = *cursor;
+  while (*p == ' ' || *p == '\t' || *p == ',') p++;
+  if (*p == 0) {
+    return false;
+  }
+
+  char *start = p;
+  while (*p && *p != ',') p++;
+  char *end = p;
+  while (end > start && isspace((unsigned char)end[-1])) end--;
+
+  // vex::PORT4 -> PORT4
+  for (char *c = start; c < end; c++) {
+    if (*c == ':') start = c + 1;
+  }
+
+  size_t len = end - start;
+  if (len >= NAME_MAX_LEN) len = NAME_MAX_LEN - 1;
+  memcpy(name, start, len);
+  name[len] = 0;
+  *cursor = p;
+  return true;
+}
+
+
+static void parse_signature(int line, const char *text) {
+  named_sig s;
+  char args[256];
+  if (!lhs_name(text, s.name) || !rhs_args(text, args, sizeof(args))) {
+    fail(line, "cant read signature", NULL);
+  }
+
+  int id, type;
+  s.line = line;
+  if (sscanf(args, "%d ,%d ,%d ,%d ,%d ,%d ,%d ,%f ,%d", &id,
+             &s.sig.u_min, &s.sig.u_max, &s.sig.u_mean,
+             &s.sig.v_min, &s.sig.v_max, &s.sig.v_mean, &s.sig.range, &type) != 9) {
+    fail(line, "signature needs 9 values:", s.name);
+  }
+
+  if (id < 1 || id > VISION_SIG_COUNT) {
+    fail(line, "signature id must be 1..7:", s.name);
+  }
+  if (s.sig.u_min > s.sig.u_max || s.sig.v_min > s.sig.v_max) {
+    fail(line, "signature min is above max:", s.name);
+  }
+  for (int i = 0; i < sig_count; i++) {
+    if (sigs[i].sig.id == id) {
+      fail(line, "signature id used twice:", s.name);
+    }
+  }
+  if (find_sig(s.name) >= 0) {
+    fail(line, "signature name used twice:", s.name);
+  }
+
+  s.sig.id = (uint8_t)id;
+  s.sig.type = type ? kVisionTypeColorCode : kVisionTypeNormal;
+  sigs[sig_count++] = s;
+}
+
+static void parse_code(int line, const char *text) {
+  named_code c;
+  char args[256];
+  if (code_count >= CODE_COUNT_MAX) {
+    fail(line, "too many codes", NULL);
+  }
+  if (!lhs_name(text, c.name) || !rhs_args(text, args, sizeof(args))) {
+    fail(line, "cant read code", NULL);
+  }
+
+  c.count = 0;
+  char name[NAME_MAX_LEN];
+  char *cursor = args;
+  while (next_name(&cursor, name)) {
+    int i = find_sig(name);
+    if (i < 0) {
+      fail(line, "code uses an unknown signature:", name);
+    }
+    if (c.count >= CODE_MAX_MEMBERS) {
+      fail(line, "code has more than 5 signatures:", c.name);
+    }
+    c.members[c.count++] = i;
+
+    // members have to be sent as color code signatures
+    sigs[i].sig.type = kVisionTypeColorCode;
+  }
+
+  if (c.count < 2) {
+    fail(line, "code needs at least 2 signatures:", c.name);
+  }
+  codes[code_count++] = c;
+}
+
+static void parse_sensor(int line, const char *text) {
+  char args[512];
+  if (!rhs_args(text, args, sizeof(args))) {
+    return;
+  }
+
+  // port, brightness, signatures... (the port is ours to pick in main.cpp)
+  char port[NAME_MAX_LEN], value[NAME_MAX_LEN];
+  char *cursor = args;
+  if (next_name(&cursor, port) && next_name(&cursor, value)) {
+    brightness = atoi(value);
+    if (brightness < 0 || brightness > 255) {
+      fail(line, "brightness must be 0..255", NULL);
+    }
+  }
+}
+
+
+static void write_header(FILE *out, const char *source) {
+  fprintf(out, "\n/*\n * vision_table.h\n * generated by tools/vision_sigs from %s\n", source);
+  fprintf(out, " * NOTE: do not edit, change the export and run make vision\n*/\n\n");
+  fprintf(out, "#ifndef VISION_TABLE_H\n#define VISION_TABLE_H\n\n");
+  fprintf(out, "#include \"vision_sigs.h\"\n\n");
+
+  fprintf(out, "constexpr uint8_t VISION_BRIGHTNESS = %d;\n\n", brightness < 0 ? 50 : brightness);
+
+  for (int i = 0; i < sig_count; i++) {
+    const vision_sig &s = sigs[i].sig;
+    fprintf(out, "constexpr vision_sig %s = { %u, %d, %d, %d, %d, %d, %d, %.3ff, %s };\n",
+            sigs[i].name, s.id, s.u_min, s.u_max, s.u_mean, s.v_min, s.v_max, s.v_mean, s.range,
+            s.type == kVisionTypeColorCode ? "kVisionTypeColorCode" : "kVisionTypeNormal");
+  }
+
+  fprintf(out, "\nconstexpr vision_sig VISION_TABLE[] = {");
+  for (int i = 0; i < sig_count; i++) {
+    fprintf(out, "%s %s", i ? "," : "", sigs[i].name);
+  }
+  fprintf(out, " };\n");
+  fprintf(out, "constexpr uint32_t VISION_TABLE_COUNT = %d;\n", sig_count);
+
+  if (code_count > 0) {
+    fprintf(out, "\n");
+  }
+  for (int i = 0; i < code_count; i++) {
+    fprintf(out, "constexpr uint32_t %s = vision_code(", codes[i].name);
+    for (int k = 0; k < codes[i].count; k++) {
+      fprintf(out, "%s%s.id", k ? ", " : "", sigs[codes[i].members[k]].name);
+    }
+    fprintf(out, ");\n");
+  }
+
+  fprintf(out, "\n#endif // VISION_TABLE_H\n");
+}
+
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <export.txt> [out.h]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "r");
+  if (in == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  char text[512];
+  int line = 0;
+  while (fgets(text, sizeof(text), in) != NULL) {
+    line++;
+    const char *comment = strstr(text, "//");
+    const char *eq = strchr(text, '=');
+    if (eq == NULL || (comment != NULL && comment < eq)) {
+      continue;
+    }
+
+    if (strstr(text, "signature") != NULL && strstr(eq, "signature") != NULL) {
+      if (sig_count >= VISION_SIG_COUNT) {
+        fail(line, "more than 7 signatures", NULL);
+      }
+      parse_signature(line, text);
+    } else if (strstr(eq, "::code") != NULL) {
+      parse_code(line, text);
+    } else if (strstr(eq, "vision") != NULL) {
+      parse_sensor(line, text);
+    }
+  }
+  fclose(in);
+
+  if (sig_count == 0) {
+    fprintf(stderr, "%s: no signatures found\n", argv[1]);
+    return 1;
+  }
+
+  FILE *out = argc >= 3 ? fopen(argv[2], "w") : stdout;
+  if (out == NULL) {
+    perror(argv[2]);
+    return 1;
+  }
+  write_header(out, argv[1]);
+  if (out != stdout) {
+    fclose(out);
+    printf("%d signatures, %d codes\n", sig_count, code_count);
+  }
+
+  return 0;
+}